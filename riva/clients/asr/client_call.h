@@ -12,6 +12,7 @@
 #include <atomic>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <csignal>
 #include <fstream>
 #include <iomanip>
@@ -19,11 +20,13 @@
 #include <iterator>
 #include <mutex>
 #include <numeric>
+#include <optional>
 #include <queue>
 #include <sstream>
 #include <string>
 #include <thread>
 
+#include "riva/clients/utils/grpc.h"
 #include "riva/proto/riva_asr.grpc.pb.h"
 #include "riva/utils/wav/wav_reader.h"
 #include "riva_asr_client_helper.h"
@@ -59,6 +62,10 @@ class ClientCall {
   std::chrono::time_point<std::chrono::steady_clock> send_time;
 
   uint32_t corr_id_;
+  // Index of the server the stream was sent to, when balancing over several endpoints
+  size_t endpoint = 0;
+  // Stream slot on one of the endpoint's connections, held until the stream finishes
+  riva::clients::ChannelPool::Lease lease;
   bool word_time_offsets_;
   bool speaker_diarization_;
 
@@ -68,6 +75,14 @@ class ClientCall {
   std::vector<bool> recv_final_flags;
 
   grpc::Status finish_status;
+
+  // Finalization SLA bookkeeping: when the last audio was sent, whether the stream finished and
+  // whether it was cancelled for missing the SLA. Guarded by finish_mutex.
+  std::mutex finish_mutex;
+  std::condition_variable finish_cv;
+  std::optional<std::chrono::steady_clock::time_point> writes_done_time;
+  bool finished = false;
+  bool cancelled_late = false;
   std::ofstream pipeline_states_logs_;
 
 };  // ClientCall
@@ -9,6 +9,7 @@
 #include <grpcpp/grpcpp.h>
 #include <strings.h>
 
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <csignal>
@@ -22,10 +23,18 @@
 #include <string>
 #include <thread>
 
+#include "riva/clients/utils/capacity_search.h"
+#include "riva/clients/utils/compression_stats.h"
+#include "riva/clients/utils/endpoint_balancer.h"
 #include "riva/clients/utils/grpc.h"
+#include "riva/clients/utils/hedging.h"
+#include "riva/clients/utils/sla.h"
 #include "riva/proto/riva_asr.grpc.pb.h"
 #include "riva/utils/files/files.h"
+#include "riva/utils/scheduling/scheduling.h"
+#include "riva/utils/semaphore.h"
 #include "riva/utils/stamping.h"
+#include "riva/utils/wav/segmentation.h"
 #include "riva/utils/wav/wav_reader.h"
 #include "riva_asr_client_helper.h"
 
@@ -46,9 +55,66 @@ DEFINE_bool(
     profanity_filter, false, "Flag to control profanity filtering for the generated transcripts");
 DEFINE_bool(automatic_punctuation, true, "Flag that controls if transcript should be punctuated");
 DEFINE_bool(word_time_offsets, true, "Flag that controls if word time stamps are requested");
-DEFINE_string(riva_uri, "localhost:50051", "URI to access riva-server");
+DEFINE_string(
+    riva_uri, "localhost:50051",
+    "URI to access riva-server, or comma separated URIs of several servers to balance over");
+DEFINE_string(
+    balance_policy, "least_outstanding",
+    "How requests are spread over several servers: round_robin, least_outstanding or "
+    "latency_weighted");
+DEFINE_int32(
+    max_endpoint_failures, 3, "Number of consecutive failures after which a server is ejected");
+DEFINE_int32(endpoint_ejection_ms, 10000, "Time during which an ejected server gets no requests");
+DEFINE_int32(num_connections, 1, "Number of connections opened to each server");
+DEFINE_string(compression, "none", "Compression of the requests: none, gzip or deflate");
+DEFINE_int32(
+    compression_min_bytes, 0, "Requests smaller than this many bytes are sent uncompressed");
+DEFINE_bool(
+    compression_report, false,
+    "Report estimated wire bytes and client CPU time (adds the cost of compressing every message "
+    "once more, excluded from the reported CPU time)");
+DEFINE_int32(
+    max_streams_per_connection, 0,
+    "Maximum number of requests in flight per connection, 0 for no limit");
+DEFINE_int32(
+    max_attempts, 1, "Maximum number of attempts per request, counting hedges and retries");
+DEFINE_double(
+    hedge_delay_ms, 0.,
+    "Delay after which another attempt is sent if a request got no answer, 0 to only retry");
+DEFINE_double(
+    hedge_percentile, 0.,
+    "Percentile of the observed latencies used as hedge delay, hedge_delay_ms being used until "
+    "enough requests completed");
+DEFINE_double(
+    retry_budget, 0.1, "Maximum ratio of hedges and retries to requests, on top of a few extra");
+DEFINE_double(
+    sla_ms, 0.,
+    "Latency SLA of a request: requests get it as deadline, are cancelled past it and the goodput "
+    "within it is reported. 0 for no deadline");
 DEFINE_int32(num_iterations, 1, "Number of times to loop over audio files");
+DEFINE_double(
+    capacity_slo_ms, 0.,
+    "Search the highest number of parallel requests at which the capacity_percentile latency "
+    "stays under this SLO, instead of running at num_parallel_requests. 0 to disable");
+DEFINE_double(capacity_percentile, 99., "Latency percentile the capacity search holds to the SLO");
+DEFINE_int32(max_concurrency, 256, "Highest number of parallel requests the capacity search tries");
+DEFINE_int32(
+    capacity_warmup_runs, 1, "Unmeasured runs at each level of the capacity search before it");
 DEFINE_int32(num_parallel_requests, 10, "Number of parallel requests to keep in flight");
+DEFINE_int32(
+    num_completion_threads, 1,
+    "Number of threads, each with its own completion queue, processing the responses");
+DEFINE_double(
+    max_segment_sec, 0.,
+    "Split LINEAR_PCM files longer than this at their quietest points and recognize the segments "
+    "in parallel. 0 disables the segmentation");
+DEFINE_string(
+    schedule, "file_order",
+    "Order in which audio files are dispatched: file_order, longest_first, shortest_first, "
+    "round_robin or bin_pack");
+DEFINE_int32(shard_index, 0, "Index of the corpus shard loaded by this process");
+DEFINE_int32(num_shards, 1, "Number of shards the corpus is split into across client processes");
+DEFINE_string(shard_mode, "stride", "How the corpus is sharded: stride or hash of the file path");
 DEFINE_bool(print_transcripts, true, "Print final transcripts");
 DEFINE_string(output_filename, "", "Filename to write output transcripts");
 DEFINE_string(model_name, "", "Name of the TRTIS model to use");
@@ -72,7 +138,10 @@ DEFINE_bool(speaker_diarization, false, "Flag that controls if speaker diarizati
 DEFINE_int32(
     diarization_max_speakers, 3,
     "Max number of speakers to detect when performing speaker diarization");
-DEFINE_string(metadata, "", "Comma separated key-value pair(s) of metadata to be sent to server");
+DEFINE_string(
+    metadata, "",
+    "Comma separated key-value pair(s) of metadata to be sent to server, or @<file> to read them "
+    "from a file that is reloaded when it changes");
 DEFINE_int32(start_history, -1, "Value to detect and initiate start of speech utterance");
 DEFINE_double(
     start_threshold, -1.,
@@ -91,9 +160,12 @@ DEFINE_uint64(timeout_ms, 10000, "Timeout for GRPC channel creation");
 DEFINE_uint64(max_grpc_message_size, MAX_GRPC_MESSAGE_SIZE, "Max GRPC message size");
 
 class RecognizeClient {
+  struct SegmentedFile;
+
  public:
   RecognizeClient(
-      std::shared_ptr<grpc::Channel> channel, const std::string& language_code,
+      const std::vector<std::shared_ptr<riva::clients::ChannelPool>>& channel_pools,
+      std::unique_ptr<riva::clients::EndpointBalancer> balancer, const std::string& language_code,
       int32_t max_alternatives, bool profanity_filter, bool word_time_offsets,
       bool automatic_punctuation, bool separate_recognition_per_channel, bool print_transcripts,
       std::string output_filename, std::string model_name, bool ctm, bool verbatim_transcripts,
@@ -101,14 +173,15 @@ class RecognizeClient {
       bool speaker_diarization, int32_t diarization_max_speakers, int32_t start_history,
       float start_threshold, int32_t stop_history, int32_t stop_history_eou, float stop_threshold,
       float stop_threshold_eou, std::string custom_configuration)
-      : stub_(nr_asr::RivaSpeechRecognition::NewStub(channel)), language_code_(language_code),
-        max_alternatives_(max_alternatives), profanity_filter_(profanity_filter),
-        word_time_offsets_(word_time_offsets), automatic_punctuation_(automatic_punctuation),
+      : channel_pools_(channel_pools), balancer_(std::move(balancer)),
+        language_code_(language_code), max_alternatives_(max_alternatives),
+        profanity_filter_(profanity_filter), word_time_offsets_(word_time_offsets),
+        automatic_punctuation_(automatic_punctuation),
         separate_recognition_per_channel_(separate_recognition_per_channel),
         speaker_diarization_(speaker_diarization),
         diarization_max_speakers_(diarization_max_speakers), print_transcripts_(print_transcripts),
-        done_sending_(false), num_requests_(0), num_responses_(0), num_failed_requests_(0),
-        total_audio_processed_(0.), model_name_(model_name), output_filename_(output_filename),
+        num_requests_(0), num_responses_(0), num_failed_requests_(0), total_audio_processed_(0.),
+        model_name_(model_name), output_filename_(output_filename),
         verbatim_transcripts_(verbatim_transcripts), boosted_phrases_score_(boosted_phrases_score),
         start_history_(start_history), start_threshold_(start_threshold),
         stop_history_(stop_history), stop_history_eou_(stop_history_eou),
@@ -125,25 +198,94 @@ class RecognizeClient {
     }
 
     boosted_phrases_ = ReadPhrasesFromFile(boosted_phrases_file);
+    BuildConfigPrototype();
   }
 
   ~RecognizeClient()
   {
+    StopCompletionThreads();
     if (output_file_.is_open()) {
       output_file_.close();
     }
   }
 
-  uint32_t NumActiveTasks()
+  // Starts the threads processing the responses, each draining a completion queue of its own.
+  // Recognize then blocks while `max_in_flight` requests are in flight.
+  void Start(int32_t num_completion_threads, int32_t max_in_flight)
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return curr_tasks_.size();
+    max_in_flight_ = max_in_flight;
+    in_flight_ = std::make_unique<riva::utils::Semaphore>(max_in_flight);
+    for (int32_t i = 0; i < num_completion_threads; ++i) {
+      cqs_.push_back(std::make_unique<grpc::CompletionQueue>());
+    }
+    for (auto& cq : cqs_) {
+      completion_threads_.emplace_back(&RecognizeClient::AsyncCompleteRpc, this, cq.get());
+    }
+  }
+
+  // Waits for the responses of all the requests sent, then stops the completion threads
+  void WaitForCompletion()
+  {
+    for (int32_t i = 0; i < max_in_flight_; ++i) {
+      in_flight_->Acquire();
+    }
+    StopCompletionThreads();
+    std::cout << "Done processing " << num_responses_ << " responses" << std::endl;
   }
 
   uint32_t NumFailedRequests() { return num_failed_requests_; }
 
   float TotalAudioProcessed() { return total_audio_processed_; }
 
+  // Latencies of the files recognized, in ms. Complete after WaitForCompletion
+  const std::vector<double>& Latencies() { return latencies_; }
+
+  riva::clients::EndpointBalancer& Balancer() { return *balancer_; }
+
+  riva::clients::HedgingPolicy& Hedging() { return *hedging_; }
+
+  void SetHedgingOptions(const riva::clients::HedgingPolicy::Options& options)
+  {
+    hedging_ = std::make_unique<riva::clients::HedgingPolicy>(options);
+  }
+
+  riva::clients::SlaTracker& Sla() { return *sla_; }
+
+  // Files longer than `max_segment_sec` are split and their segments recognized concurrently.
+  // 0 disables the segmentation.
+  void SetSegmentation(double max_segment_sec) { max_segment_sec_ = max_segment_sec; }
+
+  uint32_t NumSegmentedFiles() { return num_segmented_files_; }
+
+  void SetSla(double sla_ms) { sla_ = std::make_unique<riva::clients::SlaTracker>(sla_ms); }
+
+  const std::vector<std::shared_ptr<riva::clients::ChannelPool>>& ChannelPools()
+  {
+    return channel_pools_;
+  }
+
+  // Per-request override of the channel compression, see riva::clients::SetCallCompression.
+  // Requests and responses are recorded in `stats` if not null
+  void SetCompression(
+      grpc_compression_algorithm compression, size_t min_bytes,
+      riva::clients::CompressionStats* stats)
+  {
+    compression_ = compression;
+    compression_min_bytes_ = min_bytes;
+    compression_stats_ = stats;
+  }
+
+  // Completion time of every request, in seconds since start_time
+  std::vector<double> CompletionTimes(std::chrono::steady_clock::time_point start_time)
+  {
+    std::vector<double> completion_times;
+    completion_times.reserve(completion_times_.size());
+    for (auto& t : completion_times_) {
+      completion_times.push_back(std::chrono::duration<double>(t - start_time).count());
+    }
+    return completion_times;
+  }
+
   void WriteCTM(const Results& result, const std::string& filename)
   {
     std::string bname(basename(filename.c_str()));
@@ -182,6 +324,10 @@ class RecognizeClient {
 
   void PrintStats()
   {
+    if (latencies_.empty()) {
+      // Every request was late
+      return;
+    }
     std::sort(latencies_.begin(), latencies_.end());
     double nresultsf = static_cast<double>(latencies_.size());
     size_t per50i = static_cast<size_t>(std::floor(50. * nresultsf / 100.));
@@ -203,35 +349,137 @@ class RecognizeClient {
               << "\t\t" << avg << std::endl;
   }
 
-  void DoneSending()
+  // Sends the file of `stream` to the server, as one request per segment if it is split. Blocks,
+  // without using CPU, while the maximum number of requests is in flight.
+  void Recognize(std::unique_ptr<Stream> stream)
   {
-    done_sending_ = true;
-    return;
+    std::shared_ptr<WaveData> wav = stream->wav;
+    std::vector<riva::utils::wav::Segment> segments;
+    const int16_t* samples = nullptr;
+    if (max_segment_sec_ > 0. && wav->encoding == nr::LINEAR_PCM &&
+        wav->data.size() > static_cast<size_t>(wav->data_offset)) {
+      samples = reinterpret_cast<const int16_t*>(wav->data.data() + wav->data_offset);
+      size_t num_frames =
+          (wav->data.size() - wav->data_offset) / (sizeof(int16_t) * wav->channels);
+      segments = riva::utils::wav::SplitAtSilence(
+          samples, num_frames, wav->channels, wav->sample_rate, max_segment_sec_);
+    }
+    if (segments.size() <= 1) {
+      SendRequest(std::move(stream), nullptr, 0);
+      return;
+    }
+
+    num_segmented_files_++;
+    auto file = std::make_shared<SegmentedFile>();
+    file->stream = std::move(stream);
+    file->start = std::chrono::steady_clock::now();
+    file->responses.resize(segments.size());
+    file->remaining = segments.size();
+    for (auto& segment : segments) {
+      file->offsets_sec.push_back(static_cast<double>(segment.begin) / wav->sample_rate);
+    }
+    for (size_t i = 0; i < segments.size(); ++i) {
+      auto segment_wav = std::make_shared<WaveData>();
+      segment_wav->data = riva::utils::wav::MakeWavFile(
+          samples + segments[i].begin * wav->channels, segments[i].end - segments[i].begin,
+          wav->channels, wav->sample_rate);
+      segment_wav->filename = wav->filename;
+      segment_wav->sample_rate = wav->sample_rate;
+      segment_wav->channels = wav->channels;
+      segment_wav->encoding = wav->encoding;
+      segment_wav->data_offset = 44;
+      segment_wav->duration =
+          static_cast<double>(segments[i].end - segments[i].begin) / wav->sample_rate;
+      SendRequest(std::make_unique<Stream>(segment_wav, file->stream->corr_id), file, i);
+    }
   }
 
-  // Assembles the client's payload and sends it to the server.
-  void Recognize(std::unique_ptr<Stream> stream)
+  // Assembles the client's payload and sends it to the server
+  void SendRequest(
+      std::unique_ptr<Stream> stream, std::shared_ptr<SegmentedFile> file, size_t segment)
   {
+    in_flight_->Acquire();
+
     // Data we are sending to the server.
     nr_asr::RecognizeRequest request;
 
     std::shared_ptr<WaveData> wav = stream->wav;
 
+    // Only the audio format differs from the prototype
     auto config = request.mutable_config();
+    *config = config_prototype_;
     config->set_sample_rate_hertz(wav->sample_rate);
     config->set_encoding(wav->encoding);
+    config->set_audio_channel_count(wav->channels);
+
+    request.set_audio(&wav->data[0], wav->data.size());
+
+    num_requests_++;
+
+    // Call object to store rpc data
+    AsyncClientCall* call = new AsyncClientCall;
+
+    call->stream = std::move(stream);
+    call->file = std::move(file);
+    call->segment = segment;
+    if (compression_stats_) {
+      compression_stats_->RecordRequest(request);
+    }
+    call->request = std::move(request);
+    // Hedges and retries share the deadline of the first attempt
+    call->deadline = sla_->Deadline();
+
+    // Every attempt of the call goes to the endpoint and connection picked for it. Only the first
+    // attempt blocks while every connection of the endpoint is at its stream limit, hedges and
+    // retries are started from the completion queue thread.
+    auto prepare = [this, call](
+                       grpc::ClientContext* context, grpc::CompletionQueue* cq, int32_t attempt) {
+      riva::clients::SetCallCompression(
+          *context, compression_, call->request.ByteSizeLong(), compression_min_bytes_);
+      if (sla_->Enabled()) {
+        context->set_deadline(call->deadline);
+      }
+      size_t endpoint = balancer_->Acquire();
+      call->attempt_slots.push_back({endpoint, channel_pools_[endpoint]->Acquire(attempt == 0)});
+      return nr_asr::RivaSpeechRecognition::NewStub(call->attempt_slots.back().lease.Channel())
+          ->PrepareAsyncRecognize(context, call->request, cq);
+    };
+    auto attempt_done = [this, call](
+                            int32_t attempt, const grpc::Status& status, double latency_ms,
+                            bool used) {
+      auto& slot = call->attempt_slots[attempt];
+      slot.lease.Reset();
+      if (!used && status.error_code() == grpc::StatusCode::CANCELLED) {
+        // Cancelled because another attempt answered, says nothing about the endpoint
+        balancer_->Abandon(slot.endpoint);
+        return;
+      }
+      float audio_processed = 0.;
+      if (used && status.ok() && call->response.results_size()) {
+        audio_processed =
+            call->response.results(call->response.results_size() - 1).audio_processed();
+      }
+      balancer_->Release(slot.endpoint, status.ok(), latency_ms, audio_processed);
+    };
+    // Spread the calls over the completion queues, all the attempts of a call use the same one
+    auto* cq = cqs_[next_cq_++ % cqs_.size()].get();
+    call->Start(hedging_.get(), cq, prepare, attempt_done);
+  }
+
+  // Builds the part of the RecognitionConfig shared by every request, which each request copies.
+  // The custom configuration is parsed once per run rather than once per request.
+  void BuildConfigPrototype()
+  {
+    auto* config = &config_prototype_;
     config->set_language_code(language_code_);
     config->set_max_alternatives(max_alternatives_);
     config->set_profanity_filter(profanity_filter_);
-    config->set_audio_channel_count(wav->channels);
     config->set_enable_word_time_offsets(word_time_offsets_);
     config->set_enable_automatic_punctuation(automatic_punctuation_);
     config->set_verbatim_transcripts(verbatim_transcripts_);
     config->set_enable_separate_recognition_per_channel(separate_recognition_per_channel_);
     auto custom_config = config->mutable_custom_configuration();
-    std::unordered_map<std::string, std::string> custom_configuration_map =
-        ReadCustomConfiguration(custom_configuration_);
-    for (auto& it : custom_configuration_map) {
+    for (auto& it : ReadCustomConfiguration(custom_configuration_)) {
       (*custom_config)[it.first] = it.second;
     }
 
@@ -247,36 +495,8 @@ class RecognizeClient {
     *(speech_context->mutable_phrases()) = {boosted_phrases_.begin(), boosted_phrases_.end()};
     speech_context->set_boost(boosted_phrases_score_);
 
-    request.set_audio(&wav->data[0], wav->data.size());
-
     // Set the endpoint parameters
     UpdateEndpointingConfig(config);
-
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      curr_tasks_.emplace(stream->corr_id);
-      num_requests_++;
-    }
-
-    // Call object to store rpc data
-    AsyncClientCall* call = new AsyncClientCall;
-
-    call->stream = std::move(stream);
-
-    // stub_->PrepareAsyncSayHello() creates an RPC object, returning
-    // an instance to store in "call" but does not actually start the RPC
-    // Because we are using the asynchronous API, we need to hold on to
-    // the "call" instance in order to get updates on the ongoing RPC.
-    call->response_reader = stub_->PrepareAsyncRecognize(&call->context, request, &cq_);
-
-    call->start_time = std::chrono::steady_clock::now();
-    // StartCall initiates the RPC call
-    call->response_reader->StartCall();
-
-    // Request that, upon completion of the RPC, "reply" be updated with the
-    // server's response; "status" with the indication of whether the operation
-    // was successful. Tag the request with the memory address of the call object.
-    call->response_reader->Finish(&call->response, &call->status, (void*)call);
   }
 
   // Set the endpoint parameters
@@ -309,98 +529,179 @@ class RecognizeClient {
       endpointing_config->set_stop_threshold_eou(stop_threshold_eou_);
     }
   }
-  // Loop while listening for completed responses.
+  // Loop while listening for completed responses, until the completion queue is shut down.
   // Prints out the response from the server.
-  void AsyncCompleteRpc()
+  void AsyncCompleteRpc(grpc::CompletionQueue* cq)
   {
     void* got_tag;
     bool ok = false;
 
     // Block until the next result is available in the completion queue "cq".
-    bool stop_flag = false;
-    while (!stop_flag && cq_.Next(&got_tag, &ok)) {
-      // The tag in this example is the memory location of the call object
-      AsyncClientCall* call = static_cast<AsyncClientCall*>(got_tag);
-
-      // Verify that the request was completed successfully. Note that "ok"
-      // corresponds solely to the request for updates introduced by Finish().
-      GPR_ASSERT(ok);
-
-      if (call->status.ok()) {
-        auto end_time = std::chrono::steady_clock::now();
-        double lat = std::chrono::duration<double, std::milli>(end_time - call->start_time).count();
-        latencies_.push_back(lat);
-
-        Results output_result;
-        if (call->response.results_size()) {
-          const auto& last_result = call->response.results(call->response.results_size() - 1);
-          total_audio_processed_ += last_result.audio_processed();
-
-          for (int r = 0; r < call->response.results_size(); ++r) {
-            AppendResult(
-                output_result, call->response.results(r), word_time_offsets_, speaker_diarization_);
-          }
-        }
+    while (cq->Next(&got_tag, &ok)) {
+      // Tags are attempts and hedging alarms of the calls, a call is complete once all of them
+      // came back
+      auto* tag = static_cast<riva::clients::HedgedCallTag*>(got_tag);
+      if (!tag->call->Proceed(tag, ok)) {
+        continue;
+      }
+      AsyncClientCall* call = static_cast<AsyncClientCall*>(tag->call);
 
-        if (print_transcripts_) {
-          PrintResult(
-              output_result, call->stream->wav->filename, word_time_offsets_, speaker_diarization_);
-        }
-        if (!output_filename_.empty()) {
-          (this->*write_fn_)(output_result, call->stream->wav->filename);
-        }
-      } else {
-        std::cout << "RPC failed: " << call->status.error_message() << std::endl;
-        // This means that receiving thread will never finish
-        num_failed_requests_++;
+      float audio_processed = 0.;
+      if (call->status.ok() && call->response.results_size()) {
+        audio_processed =
+            call->response.results(call->response.results_size() - 1).audio_processed();
+      }
+      sla_->Record(call->status, call->latency_ms, audio_processed);
+      if (call->status.ok() && compression_stats_) {
+        compression_stats_->RecordResponse(call->response);
       }
 
-      // Remove the element from the map
+      if (!call->file) {
+        ReportResult(
+            call->status, call->response, call->latency_ms, call->stream->wav->filename);
+      } else {
+        CompleteSegment(*call);
+      }
       {
         std::lock_guard<std::mutex> lock(mutex_);
-        curr_tasks_.erase(call->stream->corr_id);
-        num_responses_++;
+        completion_times_.push_back(std::chrono::steady_clock::now());
       }
 
       // Once we're complete, deallocate the call object.
       delete call;
-
-      if (num_responses_ == num_requests_ && done_sending_) {
-        stop_flag = true;
-        std::cout << "Done processing " << num_responses_ << " responses" << std::endl;
-      }
+      num_responses_++;
+      in_flight_->Release();
     }
   }
 
  private:
-  // struct for keeping state and data information
-  struct AsyncClientCall {
-    // Container for the data we expect from the server.
-    nr_asr::RecognizeResponse response;
+  // struct for keeping state and data information. The response and status of the RPC are the
+  // ones of the attempt that answered.
+  struct AsyncClientCall : public riva::clients::HedgedCall<nr_asr::RecognizeResponse> {
+    // Kept for the hedges and retries
+    nr_asr::RecognizeRequest request;
+    std::chrono::system_clock::time_point deadline;
 
-    // Context for the client. It could be used to convey extra information to
-    // the server and/or tweak certain RPC behaviors.
-    grpc::ClientContext context;
+    std::unique_ptr<Stream> stream;
 
-    // Storage for the status of the RPC upon completion.
-    grpc::Status status;
+    // Endpoint and connection of each attempt
+    struct AttemptSlot {
+      size_t endpoint;
+      riva::clients::ChannelPool::Lease lease;
+    };
+    std::vector<AttemptSlot> attempt_slots;
 
-    std::unique_ptr<grpc::ClientAsyncResponseReader<nr_asr::RecognizeResponse>> response_reader;
+    // File the audio is a segment of, if it was split
+    std::shared_ptr<SegmentedFile> file;
+    size_t segment = 0;
+  };
 
+  // File recognized as several segments
+  struct SegmentedFile {
     std::unique_ptr<Stream> stream;
-    std::chrono::time_point<std::chrono::steady_clock> start_time;
+    std::chrono::steady_clock::time_point start;
+    // Start time of every segment in the file
+    std::vector<double> offsets_sec;
+
+    std::mutex mutex;
+    std::vector<nr_asr::RecognizeResponse> responses;
+    // First error of a segment, reported as the error of the file
+    grpc::Status status;
+    size_t remaining = 0;
   };
 
-  // Out of the passed in Channel comes the stub, stored here, our view of the
-  // server's exposed services.
-  std::unique_ptr<nr_asr::RivaSpeechRecognition::Stub> stub_;
+  // One pool of connections per server. The balancer picks the server of each request, the pool
+  // the connection it is sent on.
+  std::vector<std::shared_ptr<riva::clients::ChannelPool>> channel_pools_;
+  grpc_compression_algorithm compression_ = GRPC_COMPRESS_NONE;
+  size_t compression_min_bytes_ = 0;
+  riva::clients::CompressionStats* compression_stats_ = nullptr;
+  std::unique_ptr<riva::clients::EndpointBalancer> balancer_;
+  std::unique_ptr<riva::clients::HedgingPolicy> hedging_ =
+      std::make_unique<riva::clients::HedgingPolicy>(riva::clients::HedgingPolicy::Options{});
+  std::unique_ptr<riva::clients::SlaTracker> sla_ = std::make_unique<riva::clients::SlaTracker>(0.);
+
+  // Records the segment response of `call`. The file is reported, stitched, with its latency
+  // from the first segment sent to the last one answered, once all the segments are back.
+  void CompleteSegment(AsyncClientCall& call)
+  {
+    auto& file = *call.file;
+    {
+      std::lock_guard<std::mutex> lock(file.mutex);
+      if (call.status.ok()) {
+        file.responses[call.segment] = std::move(call.response);
+      } else if (file.status.ok()) {
+        file.status = call.status;
+      }
+      if (--file.remaining > 0) {
+        return;
+      }
+    }
+    double latency_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - file.start)
+            .count();
+    ReportResult(
+        file.status, StitchSegmentResponses(file.responses, file.offsets_sec), latency_ms,
+        file.stream->wav->filename);
+  }
+
+  // Records the outcome of the recognition of a file, and prints or writes its transcript
+  void ReportResult(
+      const grpc::Status& status, const nr_asr::RecognizeResponse& response, double latency_ms,
+      const std::string& filename)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (status.ok()) {
+      latencies_.push_back(latency_ms);
+
+      Results output_result;
+      if (response.results_size()) {
+        total_audio_processed_ += response.results(response.results_size() - 1).audio_processed();
+
+        for (int r = 0; r < response.results_size(); ++r) {
+          AppendResult(
+              output_result, response.results(r), word_time_offsets_, speaker_diarization_);
+        }
+      }
+
+      if (print_transcripts_) {
+        PrintResult(output_result, filename, word_time_offsets_, speaker_diarization_);
+      }
+      if (!output_filename_.empty()) {
+        (this->*write_fn_)(output_result, filename);
+      }
+    } else if (!sla_->IsLate(status)) {
+      // Requests past their deadline are counted by the SLA report rather than as failures
+      std::cout << "RPC failed: " << status.error_message() << std::endl;
+      num_failed_requests_++;
+    }
+  }
+
+  void StopCompletionThreads()
+  {
+    for (auto& cq : cqs_) {
+      cq->Shutdown();
+    }
+    for (auto& thread : completion_threads_) {
+      thread.join();
+    }
+    completion_threads_.clear();
+    cqs_.clear();
+  }
 
-  // The producer-consumer queue we use to communicate asynchronously with the
-  // gRPC runtime.
-  grpc::CompletionQueue cq_;
+  // The producer-consumer queues we use to communicate asynchronously with the
+  // gRPC runtime, one per completion thread.
+  std::vector<std::unique_ptr<grpc::CompletionQueue>> cqs_;
+  std::vector<std::thread> completion_threads_;
+  std::atomic<size_t> next_cq_{0};
+  // One permit per request allowed in flight
+  std::unique_ptr<riva::utils::Semaphore> in_flight_;
+  int32_t max_in_flight_ = 0;
 
-  std::set<uint32_t> curr_tasks_;
+  // Guards the results and the outputs, written by all the completion threads
+  std::mutex mutex_;
   std::vector<double> latencies_;
+  std::vector<std::chrono::steady_clock::time_point> completion_times_;
 
   std::string language_code_;
   int32_t max_alternatives_;
@@ -414,10 +715,10 @@ class RecognizeClient {
   bool print_transcripts_;
 
 
-  std::mutex mutex_;
-  bool done_sending_;
-  uint32_t num_requests_;
-  uint32_t num_responses_;
+  std::atomic<uint32_t> num_requests_;
+  std::atomic<uint32_t> num_responses_;
+  double max_segment_sec_ = 0.;
+  std::atomic<uint32_t> num_segmented_files_{0};
   uint32_t num_failed_requests_;
 
   std::ofstream output_file_;
@@ -429,6 +730,8 @@ class RecognizeClient {
   bool verbatim_transcripts_;
 
   std::vector<std::string> boosted_phrases_;
+  // Configuration of every request, but for the audio format
+  nr_asr::RecognitionConfig config_prototype_;
   float boosted_phrases_score_;
   void (RecognizeClient::*write_fn_)(const Results& result, const std::string& filename);
 
@@ -454,9 +757,34 @@ main(int argc, char** argv)
   str_usage << "           --max_alternatives=<integer>" << std::endl;
   str_usage << "           --profanity_filter=<true|false>" << std::endl;
   str_usage << "           --word_time_offsets=<true|false>" << std::endl;
-  str_usage << "           --riva_uri=<server_name:port> " << std::endl;
+  str_usage << "           --riva_uri=<server_name:port[,server_name:port...]> " << std::endl;
+  str_usage << "           --balance_policy=<round_robin|least_outstanding|latency_weighted> "
+            << std::endl;
+  str_usage << "           --max_endpoint_failures=<integer> " << std::endl;
+  str_usage << "           --endpoint_ejection_ms=<integer> " << std::endl;
+  str_usage << "           --num_connections=<integer> " << std::endl;
+  str_usage << "           --max_streams_per_connection=<integer> " << std::endl;
+  str_usage << "           --compression=<none|gzip|deflate> " << std::endl;
+  str_usage << "           --compression_min_bytes=<integer> " << std::endl;
+  str_usage << "           --compression_report=<true|false> " << std::endl;
+  str_usage << "           --max_attempts=<integer> " << std::endl;
+  str_usage << "           --hedge_delay_ms=<float> " << std::endl;
+  str_usage << "           --hedge_percentile=<float> " << std::endl;
+  str_usage << "           --retry_budget=<float> " << std::endl;
+  str_usage << "           --sla_ms=<float> " << std::endl;
+  str_usage << "           --capacity_slo_ms=<float> " << std::endl;
+  str_usage << "           --capacity_percentile=<float> " << std::endl;
+  str_usage << "           --max_concurrency=<integer> " << std::endl;
+  str_usage << "           --capacity_warmup_runs=<integer> " << std::endl;
   str_usage << "           --num_iterations=<integer> " << std::endl;
   str_usage << "           --num_parallel_requests=<integer> " << std::endl;
+  str_usage << "           --num_completion_threads=<integer> " << std::endl;
+  str_usage << "           --max_segment_sec=<float> " << std::endl;
+  str_usage << "           --schedule=<file_order|longest_first|shortest_first|"
+            << "round_robin|bin_pack>" << std::endl;
+  str_usage << "           --shard_index=<integer> " << std::endl;
+  str_usage << "           --num_shards=<integer> " << std::endl;
+  str_usage << "           --shard_mode=<stride|hash> " << std::endl;
   str_usage << "           --print_transcripts=<true|false> " << std::endl;
   str_usage << "           --output_filename=<string>" << std::endl;
   str_usage << "           --output-ctm=<true|false>" << std::endl;
@@ -471,7 +799,7 @@ main(int argc, char** argv)
   str_usage << "           --diarization_max_speakers=<int>" << std::endl;
   str_usage << "           --model_name=<model>" << std::endl;
   str_usage << "           --list_models" << std::endl;
-  str_usage << "           --metadata=<key,value,...>" << std::endl;
+  str_usage << "           --metadata=<key,value,...|@filename>" << std::endl;
   str_usage << "           --start_history=<int>" << std::endl;
   str_usage << "           --start_threshold=<float>" << std::endl;
   str_usage << "           --stop_history=<int>" << std::endl;
@@ -501,6 +829,51 @@ main(int argc, char** argv)
     return 1;
   }
 
+  if (FLAGS_num_parallel_requests < 1 || FLAGS_num_completion_threads < 1) {
+    std::cerr << "num_parallel_requests and num_completion_threads must be greater than or equal "
+                 "to 1."
+              << std::endl;
+    return 1;
+  }
+
+  if (FLAGS_max_segment_sec < 0.) {
+    std::cerr << "max_segment_sec must be greater than or equal to 0." << std::endl;
+    return 1;
+  }
+
+  if (FLAGS_capacity_slo_ms < 0. || FLAGS_capacity_percentile < 0. ||
+      FLAGS_capacity_percentile > 100. || FLAGS_max_concurrency < 1 ||
+      FLAGS_capacity_warmup_runs < 0) {
+    std::cerr << "capacity_slo_ms must be non-negative, capacity_percentile between 0 and 100, "
+                 "max_concurrency positive and capacity_warmup_runs non-negative."
+              << std::endl;
+    return 1;
+  }
+
+  if (FLAGS_max_attempts < 1 || FLAGS_hedge_percentile < 0. || FLAGS_hedge_percentile > 100.) {
+    std::cerr << "max_attempts must be greater than or equal to 1 and hedge_percentile between 0 "
+                 "and 100."
+              << std::endl;
+    return 1;
+  }
+
+  riva::utils::scheduling::Policy schedule;
+  riva::clients::BalancePolicy balance_policy;
+  grpc_compression_algorithm compression;
+  ShardSpec shard;
+  try {
+    schedule = riva::utils::scheduling::ParsePolicy(FLAGS_schedule);
+    balance_policy = riva::clients::ParseBalancePolicy(FLAGS_balance_policy);
+    compression = riva::clients::ParseCompressionAlgorithm(FLAGS_compression);
+    shard.index = FLAGS_shard_index;
+    shard.count = FLAGS_num_shards;
+    shard.mode = ParseShardMode(FLAGS_shard_mode);
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
   bool flag_set = gflags::GetCommandLineFlagInfoOrDie("riva_uri").is_default;
   const char* riva_uri = getenv("RIVA_URI");
 
@@ -509,13 +882,14 @@ main(int argc, char** argv)
     FLAGS_riva_uri = riva_uri;
   }
 
-  std::shared_ptr<grpc::Channel> grpc_channel;
+  std::vector<std::shared_ptr<riva::clients::ChannelPool>> channel_pools;
   try {
     auto creds = riva::clients::CreateChannelCredentials(
         FLAGS_use_ssl, FLAGS_ssl_root_cert, FLAGS_ssl_client_key, FLAGS_ssl_client_cert,
         FLAGS_metadata);
-    grpc_channel = riva::clients::CreateChannelBlocking(
-        FLAGS_riva_uri, creds, FLAGS_timeout_ms, FLAGS_max_grpc_message_size);
+    channel_pools = riva::clients::CreateChannelPools(
+        FLAGS_riva_uri, creds, FLAGS_num_connections, FLAGS_max_streams_per_connection,
+        FLAGS_timeout_ms, FLAGS_max_grpc_message_size, compression);
   }
   catch (const std::exception& e) {
     std::cerr << "Error creating GRPC channel: " << e.what() << std::endl;
@@ -525,7 +899,7 @@ main(int argc, char** argv)
 
   if (FLAGS_list_models) {
     std::unique_ptr<nr_asr::RivaSpeechRecognition::Stub> asr_stub_(
-        nr_asr::RivaSpeechRecognition::NewStub(grpc_channel));
+        nr_asr::RivaSpeechRecognition::NewStub(channel_pools[0]->Channel(0)));
     grpc::ClientContext asr_context;
     nr_asr::RivaSpeechRecognitionConfigRequest asr_request;
     nr_asr::RivaSpeechRecognitionConfigResponse asr_response;
@@ -541,19 +915,44 @@ main(int argc, char** argv)
     return 0;
   }
 
-  RecognizeClient recognize_client(
-      grpc_channel, FLAGS_language_code, FLAGS_max_alternatives, FLAGS_profanity_filter,
-      FLAGS_word_time_offsets, FLAGS_automatic_punctuation,
-      /* separate_recognition_per_channel*/ false, FLAGS_print_transcripts, FLAGS_output_filename,
-      FLAGS_model_name, FLAGS_output_ctm, FLAGS_verbatim_transcripts, FLAGS_boosted_words_file,
-      (float)FLAGS_boosted_words_score, FLAGS_speaker_diarization, FLAGS_diarization_max_speakers,
-      FLAGS_start_history, FLAGS_start_threshold, FLAGS_stop_history, FLAGS_stop_history_eou,
-      FLAGS_stop_threshold, FLAGS_stop_threshold_eou, FLAGS_custom_configuration);
+  std::unique_ptr<riva::clients::CompressionStats> compression_stats;
+  if (FLAGS_compression_report) {
+    compression_stats = std::make_unique<riva::clients::CompressionStats>(compression);
+  }
+
+  riva::clients::EndpointBalancer::Options balancer_options;
+  balancer_options.max_failures = FLAGS_max_endpoint_failures;
+  balancer_options.ejection_time = std::chrono::milliseconds(FLAGS_endpoint_ejection_ms);
+  riva::clients::HedgingPolicy::Options hedging_options;
+  hedging_options.max_attempts = FLAGS_max_attempts;
+  hedging_options.hedge_delay_ms = FLAGS_hedge_delay_ms;
+  hedging_options.hedge_percentile = FLAGS_hedge_percentile;
+  hedging_options.retry_budget = FLAGS_retry_budget;
+  // A fresh client, with its own balancer and statistics, for each run
+  auto create_client = [&](bool print_transcripts, const std::string& output_filename) {
+    auto client = std::make_unique<RecognizeClient>(
+        channel_pools,
+        std::make_unique<riva::clients::EndpointBalancer>(
+            riva::clients::SplitUris(FLAGS_riva_uri), balance_policy, balancer_options),
+        FLAGS_language_code, FLAGS_max_alternatives, FLAGS_profanity_filter,
+        FLAGS_word_time_offsets, FLAGS_automatic_punctuation,
+        /* separate_recognition_per_channel*/ false, print_transcripts, output_filename,
+        FLAGS_model_name, FLAGS_output_ctm, FLAGS_verbatim_transcripts, FLAGS_boosted_words_file,
+        (float)FLAGS_boosted_words_score, FLAGS_speaker_diarization,
+        FLAGS_diarization_max_speakers, FLAGS_start_history, FLAGS_start_threshold,
+        FLAGS_stop_history, FLAGS_stop_history_eou, FLAGS_stop_threshold, FLAGS_stop_threshold_eou,
+        FLAGS_custom_configuration);
+    client->SetCompression(compression, FLAGS_compression_min_bytes, compression_stats.get());
+    client->SetHedgingOptions(hedging_options);
+    client->SetSla(FLAGS_sla_ms);
+    client->SetSegmentation(FLAGS_max_segment_sec);
+    return client;
+  };
 
-  // Preload all wav files, sort by size to reduce tail effects
+  // Preload all wav files, the dispatch order is chosen by the scheduling policy
   std::vector<std::shared_ptr<WaveData>> all_wav;
   try {
-    LoadWavData(all_wav, FLAGS_audio_file);
+    LoadWavData(all_wav, FLAGS_audio_file, shard);
   }
   catch (const std::exception& e) {
     std::cerr << "Unable to load audio file(s): " << e.what() << std::endl;
@@ -564,55 +963,112 @@ main(int argc, char** argv)
     return 1;
   }
 
-  uint32_t all_wav_max = all_wav.size() * FLAGS_num_iterations;
+  std::vector<double> weights = AudioWeights(all_wav);
+
+  if (FLAGS_capacity_slo_ms > 0.) {
+    riva::clients::CapacitySearch::Options capacity_options;
+    capacity_options.slo_ms = FLAGS_capacity_slo_ms;
+    capacity_options.percentile = FLAGS_capacity_percentile;
+    capacity_options.max_concurrency = FLAGS_max_concurrency;
+    capacity_options.warmup_runs = FLAGS_capacity_warmup_runs;
+    riva::clients::CapacitySearch search(capacity_options);
+    auto search_start = std::chrono::steady_clock::now();
+    int32_t capacity =
+        search.Run([&](int32_t concurrency, riva::clients::CapacitySample& sample) {
+          auto client = create_client(false, "");
+          auto order = riva::utils::scheduling::ScheduleWork(
+              weights, FLAGS_num_iterations, concurrency, schedule);
+          client->Start(FLAGS_num_completion_threads, concurrency);
+          auto start_time = std::chrono::steady_clock::now();
+          for (uint32_t i = 0; i < order.size(); ++i) {
+            client->Recognize(std::make_unique<Stream>(all_wav[order[i]], i));
+          }
+          client->WaitForCompletion();
+          double run_time_sec =
+              std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time)
+                  .count();
+          if (client->NumFailedRequests()) {
+            return false;
+          }
+          for (double latency_ms : client->Latencies()) {
+            sample.latencies.Record(latency_ms);
+          }
+          sample.throughput = client->TotalAudioProcessed() / run_time_sec;
+          return true;
+        });
+    search.Print(capacity, "RTFX");
+    if (compression_stats) {
+      compression_stats->Print(
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - search_start).count());
+    }
+    return capacity < 0 ? 1 : 0;
+  }
+
+  auto order = riva::utils::scheduling::ScheduleWork(
+      weights, FLAGS_num_iterations, FLAGS_num_parallel_requests, schedule);
+
+  uint32_t all_wav_max = order.size();
   std::vector<std::shared_ptr<WaveData>> all_wav_repeated;
   all_wav_repeated.reserve(all_wav_max);
-  for (uint32_t file_id = 0; file_id < all_wav.size(); file_id++) {
-    for (int iter = 0; iter < FLAGS_num_iterations; iter++) {
-      all_wav_repeated.push_back(all_wav[file_id]);
-    }
+  for (auto file_id : order) {
+    all_wav_repeated.push_back(all_wav[file_id]);
   }
 
-  // Spawn reader thread that loops indefinitely
-  std::thread thread_ = std::thread(&RecognizeClient::AsyncCompleteRpc, &recognize_client);
+  auto recognize_client = create_client(FLAGS_print_transcripts, FLAGS_output_filename);
+  recognize_client->Start(FLAGS_num_completion_threads, FLAGS_num_parallel_requests);
 
-  // Ensure there's also num_parallel_requests in flight
-  uint32_t all_wav_i = 0;
+  // Keep num_parallel_requests in flight, Recognize blocks while they all are
   auto start_time = std::chrono::steady_clock::now();
-  while (true) {
-    while (recognize_client.NumActiveTasks() < (uint32_t)FLAGS_num_parallel_requests &&
-           all_wav_i < all_wav_max) {
-      std::unique_ptr<Stream> stream(new Stream(all_wav_repeated[all_wav_i], all_wav_i));
-      recognize_client.Recognize(std::move(stream));
-      ++all_wav_i;
-    }
-
-    if (all_wav_i == all_wav_max) {
-      break;
-    }
+  for (uint32_t all_wav_i = 0; all_wav_i < all_wav_max; ++all_wav_i) {
+    std::unique_ptr<Stream> stream(new Stream(all_wav_repeated[all_wav_i], all_wav_i));
+    recognize_client->Recognize(std::move(stream));
   }
+  recognize_client->WaitForCompletion();
+  auto current_time = std::chrono::steady_clock::now();
+  double diff_time = std::chrono::duration<double, std::milli>(current_time - start_time).count();
 
-  recognize_client.DoneSending();
-  thread_.join();
-
-  if (recognize_client.NumFailedRequests()) {
+  if (recognize_client->NumFailedRequests()) {
     std::cout << "Some requests failed to complete properly, not printing performance stats"
               << std::endl;
   } else {
-    recognize_client.PrintStats();
-
-    auto current_time = std::chrono::steady_clock::now();
-    double diff_time = std::chrono::duration<double, std::milli>(current_time - start_time).count();
+    recognize_client->PrintStats();
 
     std::cout << "Run time: " << diff_time / 1000. << " sec." << std::endl;
-    std::cout << "Total audio processed: " << recognize_client.TotalAudioProcessed() << " sec."
+    if (recognize_client->NumSegmentedFiles()) {
+      std::cout << "Files split in segments: " << recognize_client->NumSegmentedFiles()
+                << std::endl;
+    }
+    std::cout << "Total audio processed: " << recognize_client->TotalAudioProcessed() << " sec."
               << std::endl;
-    std::cout << "Throughput: " << recognize_client.TotalAudioProcessed() * 1000. / diff_time
+    std::cout << "Throughput: " << recognize_client->TotalAudioProcessed() * 1000. / diff_time
               << " RTFX" << std::endl;
+    if (recognize_client->Sla().Enabled()) {
+      recognize_client->Sla().Print(diff_time / 1000., "audio sec");
+    }
+
+    double tail_idle = riva::utils::scheduling::TailIdleTime(
+        recognize_client->CompletionTimes(start_time), FLAGS_num_parallel_requests);
+    std::cout << "Tail idle slot time (" << FLAGS_schedule << "): " << tail_idle << " sec ("
+              << 100. * tail_idle / (FLAGS_num_parallel_requests * diff_time / 1000.)
+              << "% of slot capacity)" << std::endl;
     if (!FLAGS_output_filename.empty()) {
       std::cout << "Final transcripts written to " << FLAGS_output_filename << std::endl;
     }
   }
+  if (recognize_client->Balancer().NumEndpoints() > 1) {
+    recognize_client->Balancer().PrintStats(diff_time / 1000., "RTFX");
+  }
+  for (auto& pool : recognize_client->ChannelPools()) {
+    if (pool->NumConnections() > 1 || pool->MaxStreamsPerConnection() > 0) {
+      pool->PrintStats();
+    }
+  }
+  if (compression_stats) {
+    compression_stats->Print(diff_time / 1000.);
+  }
+  if (FLAGS_max_attempts > 1) {
+    recognize_client->Hedging().PrintStats();
+  }
 
   return 0;
 }
@@ -6,26 +6,18 @@
 
 #include "riva_asr_client_helper.h"
 
-#include <regex>
+#include <cmath>
+
+#include "riva/utils/phrases/phrases.h"
 
 std::vector<std::string>
 ReadPhrasesFromFile(const std::string& phrases_file)
 {
   std::vector<std::string> phrases;
   if (!phrases_file.empty()) {
-    std::ifstream infile(phrases_file);
-
-    if (infile.is_open()) {
-      std::string phrase;
-      while (getline(infile, phrase)) {
-        phrase = std::regex_replace(phrase, std::regex("^ +| +$"), "");
-        if (!phrase.empty()) {
-          phrases.push_back(phrase);
-        }
-      }
-    } else {
-      std::string err = "Could not open file " + phrases_file;
-      throw std::runtime_error(err);
+    auto file = riva::utils::phrases::Load(phrases_file, riva::utils::phrases::Format::kPhrases);
+    for (auto& entry : file->entries) {
+      phrases.push_back(entry.key);
     }
   }
   return phrases;
@@ -217,13 +209,13 @@ PrintResult(
 }
 
 std::unordered_map<std::string, std::string>
-ReadCustomConfiguration(std::string& custom_configuration)
+ReadCustomConfiguration(const std::string& custom_configuration)
 {
-  custom_configuration = absl::StrReplaceAll(custom_configuration, {{" ", ""}});
+  std::string stripped_configuration = absl::StrReplaceAll(custom_configuration, {{" ", ""}});
   std::unordered_map<std::string, std::string> custom_configuration_map;
   // Split the input string by commas to get key-value pairs
 
-  std::vector<absl::string_view> pairs = absl::StrSplit(custom_configuration, ',');
+  std::vector<absl::string_view> pairs = absl::StrSplit(stripped_configuration, ',');
   for (const auto& pair : pairs) {
     // Split each pair by colon to separate the key and value
     if (pair != "") {
@@ -244,4 +236,26 @@ ReadCustomConfiguration(std::string& custom_configuration)
     }
   }
   return custom_configuration_map;
-}
\ No newline at end of file
+}
+
+nr_asr::RecognizeResponse
+StitchSegmentResponses(
+    const std::vector<nr_asr::RecognizeResponse>& responses, const std::vector<double>& offsets_sec)
+{
+  nr_asr::RecognizeResponse stitched;
+  for (size_t s = 0; s < responses.size(); ++s) {
+    int32_t offset_ms = static_cast<int32_t>(std::lround(offsets_sec[s] * 1000.));
+    for (auto& segment_result : responses[s].results()) {
+      auto* result = stitched.add_results();
+      *result = segment_result;
+      result->set_audio_processed(segment_result.audio_processed() + offsets_sec[s]);
+      for (auto& alternative : *result->mutable_alternatives()) {
+        for (auto& word : *alternative.mutable_words()) {
+          word.set_start_time(word.start_time() + offset_ms);
+          word.set_end_time(word.end_time() + offset_ms);
+        }
+      }
+    }
+  }
+  return stitched;
+}
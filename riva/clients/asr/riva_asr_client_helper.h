@@ -55,4 +55,10 @@ void PrintResult(
     bool speaker_diarization);
 
 std::unordered_map<std::string, std::string> ReadCustomConfiguration(
-    std::string& custom_configuration);
+    const std::string& custom_configuration);
+
+/// Concatenates the responses of consecutive segments of a file. Word time offsets and audio
+/// processed of each segment are shifted by its start time in the file.
+nr_asr::RecognizeResponse StitchSegmentResponses(
+    const std::vector<nr_asr::RecognizeResponse>& responses,
+    const std::vector<double>& offsets_sec);
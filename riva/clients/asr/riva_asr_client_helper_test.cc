@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "riva_asr_client_helper.h"
+
+#include <gtest/gtest.h>
+
+// Response of a segment with one result whose single alternative has the given words, each
+// spoken for 100 ms from its start time in the segment
+static nr_asr::RecognizeResponse
+SegmentResponse(
+    const std::string& transcript, const std::vector<std::pair<std::string, int32_t>>& words,
+    float audio_processed)
+{
+  nr_asr::RecognizeResponse response;
+  auto* result = response.add_results();
+  result->set_audio_processed(audio_processed);
+  auto* alternative = result->add_alternatives();
+  alternative->set_transcript(transcript);
+  for (auto& [text, start_ms] : words) {
+    auto* word = alternative->add_words();
+    word->set_word(text);
+    word->set_start_time(start_ms);
+    word->set_end_time(start_ms + 100);
+  }
+  return response;
+}
+
+TEST(StitchSegmentResponses, ShiftsSegments)
+{
+  std::vector<nr_asr::RecognizeResponse> responses = {
+      SegmentResponse("hello world", {{"hello", 0}, {"world", 400}}, 1.f),
+      SegmentResponse("good bye", {{"good", 50}, {"bye", 300}}, 0.75f)};
+  auto stitched = StitchSegmentResponses(responses, {0., 12.5});
+
+  ASSERT_EQ(stitched.results_size(), 2);
+  EXPECT_EQ(stitched.results(0).alternatives(0).transcript(), "hello world");
+  EXPECT_EQ(stitched.results(1).alternatives(0).transcript(), "good bye");
+  EXPECT_FLOAT_EQ(stitched.results(0).audio_processed(), 1.f);
+  EXPECT_FLOAT_EQ(stitched.results(1).audio_processed(), 13.25f);
+
+  auto& first = stitched.results(0).alternatives(0).words();
+  EXPECT_EQ(first[1].start_time(), 400);
+  EXPECT_EQ(first[1].end_time(), 500);
+  auto& second = stitched.results(1).alternatives(0).words();
+  ASSERT_EQ(second.size(), 2);
+  EXPECT_EQ(second[0].word(), "good");
+  EXPECT_EQ(second[0].start_time(), 12550);
+  EXPECT_EQ(second[0].end_time(), 12650);
+  EXPECT_EQ(second[1].start_time(), 12800);
+}
+
+TEST(StitchSegmentResponses, EmptySegments)
+{
+  EXPECT_EQ(StitchSegmentResponses({}, {}).results_size(), 0);
+
+  // A silent segment without results leaves no gap in the results
+  std::vector<nr_asr::RecognizeResponse> responses = {
+      nr_asr::RecognizeResponse(), SegmentResponse("late", {{"late", 0}}, 2.f)};
+  auto stitched = StitchSegmentResponses(responses, {0., 30.});
+  ASSERT_EQ(stitched.results_size(), 1);
+  EXPECT_EQ(stitched.results(0).alternatives(0).words(0).start_time(), 30000);
+  EXPECT_FLOAT_EQ(stitched.results(0).audio_processed(), 32.f);
+}
@@ -9,6 +9,7 @@
 #include <grpcpp/grpcpp.h>
 #include <strings.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <cmath>
@@ -19,16 +20,21 @@
 #include <iterator>
 #include <mutex>
 #include <numeric>
+#include <optional>
 #include <queue>
 #include <sstream>
 #include <string>
 #include <thread>
 
 #include "client_call.h"
+#include "riva/clients/utils/capacity_search.h"
 #include "riva/clients/utils/grpc.h"
+#include "riva/clients/utils/sweep.h"
 #include "riva/proto/riva_asr.grpc.pb.h"
+#include "riva/utils/coordination/coordination.h"
 #include "riva/utils/files/files.h"
 #include "riva/utils/stamping.h"
+#include "riva/utils/stats/worker_processes.h"
 #include "riva/utils/wav/wav_reader.h"
 #include "riva_asr_client_helper.h"
 #include "streaming_recognize_client.h"
@@ -53,9 +59,56 @@ DEFINE_bool(word_time_offsets, true, "Flag that controls if word time stamps are
 DEFINE_bool(
     simulate_realtime, false, "Flag that controls if audio files should be sent in realtime");
 DEFINE_string(audio_device, "", "Name of audio device to use");
-DEFINE_string(riva_uri, "localhost:50051", "URI to access riva-server");
+DEFINE_string(
+    riva_uri, "localhost:50051",
+    "URI to access riva-server, or comma separated URIs of several servers to balance over");
+DEFINE_string(
+    balance_policy, "least_outstanding",
+    "How streams are spread over several servers: round_robin, least_outstanding or "
+    "latency_weighted");
+DEFINE_int32(
+    max_endpoint_failures, 3, "Number of consecutive failures after which a server is ejected");
+DEFINE_int32(endpoint_ejection_ms, 10000, "Time during which an ejected server gets no streams");
+DEFINE_int32(num_connections, 1, "Number of connections opened to each server");
+DEFINE_int32(
+    max_streams_per_connection, 0,
+    "Maximum number of streams in flight per connection, 0 for no limit");
 DEFINE_int32(num_iterations, 1, "Number of times to loop over audio files");
 DEFINE_int32(num_parallel_requests, 1, "Number of parallel requests to keep in flight");
+DEFINE_double(
+    sla_ms, 0.,
+    "Finalization latency SLA: streams not finished this long after their last audio chunk are "
+    "cancelled and the goodput within it is reported. 0 for no deadline");
+DEFINE_string(
+    schedule, "file_order",
+    "Order in which audio files are dispatched: file_order, longest_first, shortest_first, "
+    "round_robin or bin_pack");
+DEFINE_int32(shard_index, 0, "Index of the corpus shard loaded by this process");
+DEFINE_int32(num_shards, 1, "Number of shards the corpus is split into across client processes");
+DEFINE_string(shard_mode, "stride", "How the corpus is sharded: stride or hash of the file path");
+DEFINE_int32(
+    num_processes, 1,
+    "Number of client processes to fork, each streaming its own shard of the audio files with "
+    "num_parallel_requests requests in flight");
+DEFINE_int32(
+    controller_port, 0,
+    "Run as the controller of a multi-host test, waiting for agents on this port");
+DEFINE_int32(num_agents, 1, "Number of agents the controller waits for");
+DEFINE_int32(
+    start_delay_ms, 10000,
+    "Delay between the controller starting the agents and the first request, it must cover the "
+    "time agents need to load the audio");
+DEFINE_string(
+    controller, "",
+    "Run as an agent of a multi-host test, receiving the test from the controller at host:port");
+DEFINE_string(
+    sweep, "",
+    "Grid of chunk_duration_ms and endpointing flags to run the audio files with, e.g. "
+    "\"chunk_duration_ms=80,160;stop_history=500,800\". Every combination is run and a table of "
+    "the results is printed");
+DEFINE_int32(
+    sweep_warmup_iterations, 1,
+    "Unmeasured passes over the audio files before each point of the sweep");
 DEFINE_int32(chunk_duration_ms, 100, "Chunk duration in milliseconds");
 DEFINE_bool(print_transcripts, true, "Print final transcripts");
 DEFINE_bool(interim_results, true, "Print intermediate transcripts");
@@ -78,7 +131,10 @@ DEFINE_bool(
     use_ssl, false,
     "Whether to use SSL credentials or not. If ssl_root_cert is specified, "
     "this is assumed to be true");
-DEFINE_string(metadata, "", "Comma separated key-value pair(s) of metadata to be sent to server");
+DEFINE_string(
+    metadata, "",
+    "Comma separated key-value pair(s) of metadata to be sent to server, or @<file> to read them "
+    "from a file that is reloaded when it changes");
 DEFINE_int32(
     start_history, -1, "Value (in milliseconds) to detect and initiate start of speech utterance");
 DEFINE_double(
@@ -102,6 +158,30 @@ DEFINE_int32(
 DEFINE_uint64(timeout_ms, 10000, "Timeout for GRPC channel creation");
 DEFINE_uint64(max_grpc_message_size, MAX_GRPC_MESSAGE_SIZE, "Max GRPC message size");
 
+DEFINE_double(
+    capacity_slo_ms, 0.,
+    "Search the highest number of parallel streams at which the capacity_percentile finalization "
+    "latency stays under this SLO, instead of running at num_parallel_requests. Requires "
+    "--simulate_realtime. 0 to disable");
+DEFINE_double(capacity_percentile, 99., "Latency percentile the capacity search holds to the SLO");
+DEFINE_int32(max_concurrency, 256, "Highest number of parallel streams the capacity search tries");
+DEFINE_int32(
+    capacity_warmup_runs, 1, "Unmeasured runs at each level of the capacity search before it");
+// Flags that define the load test. The controller sends its values to every agent so that they
+// all run the same test; connection flags such as --riva_uri stay local to each agent.
+static const std::vector<std::string> kScenarioFlags = {
+    "audio_file", "num_iterations", "num_parallel_requests", "num_processes", "schedule",
+    "shard_mode", "chunk_duration_ms", "simulate_realtime", "interim_results", "print_transcripts",
+    "language_code", "model_name", "max_alternatives", "profanity_filter", "word_time_offsets",
+    "automatic_punctuation", "verbatim_transcripts", "boosted_words_score", "custom_configuration",
+    "start_history", "start_threshold", "stop_history", "stop_history_eou", "stop_threshold",
+    "stop_threshold_eou", "speaker_diarization", "diarization_max_speakers", "sla_ms"};
+
+// Flags --sweep may vary
+static const std::vector<std::string> kSweepFlags = {
+    "chunk_duration_ms", "start_history", "start_threshold", "stop_history",
+    "stop_history_eou", "stop_threshold", "stop_threshold_eou"};
+
 void
 signal_handler(int signal_num)
 {
@@ -115,6 +195,335 @@ signal_handler(int signal_num)
   count++;
 }
 
+// Creates one pool of connections per server of --riva_uri, returns an empty vector on failure
+std::vector<std::shared_ptr<riva::clients::ChannelPool>>
+CreateChannelPools()
+{
+  try {
+    auto creds = riva::clients::CreateChannelCredentials(
+        FLAGS_use_ssl, FLAGS_ssl_root_cert, FLAGS_ssl_client_key, FLAGS_ssl_client_cert,
+        FLAGS_metadata);
+    return riva::clients::CreateChannelPools(
+        FLAGS_riva_uri, creds, FLAGS_num_connections, FLAGS_max_streams_per_connection,
+        FLAGS_timeout_ms, FLAGS_max_grpc_message_size);
+  }
+  catch (const std::exception& e) {
+    std::cerr << "Error creating GRPC channel: " << e.what() << std::endl;
+    std::cerr << "Exiting." << std::endl;
+    return {};
+  }
+}
+
+std::unique_ptr<StreamingRecognizeClient>
+CreateRecognizeClient(
+    const std::vector<std::shared_ptr<riva::clients::ChannelPool>>& channel_pools,
+    const std::string& output_filename)
+{
+  auto recognize_client = std::make_unique<StreamingRecognizeClient>(
+      channel_pools[0]->Channel(0), FLAGS_num_parallel_requests, FLAGS_language_code,
+      FLAGS_max_alternatives, FLAGS_profanity_filter, FLAGS_word_time_offsets,
+      FLAGS_automatic_punctuation, /* separate_recognition_per_channel*/ false,
+      FLAGS_print_transcripts, FLAGS_chunk_duration_ms, FLAGS_interim_results, output_filename,
+      FLAGS_model_name, FLAGS_simulate_realtime, FLAGS_verbatim_transcripts,
+      FLAGS_boosted_words_file, FLAGS_boosted_words_score, FLAGS_start_history,
+      FLAGS_start_threshold, FLAGS_stop_history, FLAGS_stop_history_eou, FLAGS_stop_threshold,
+      FLAGS_stop_threshold_eou, FLAGS_custom_configuration, FLAGS_speaker_diarization,
+      FLAGS_diarization_max_speakers);
+
+  std::shared_ptr<riva::clients::EndpointBalancer> balancer;
+  if (channel_pools.size() > 1) {
+    riva::clients::EndpointBalancer::Options options;
+    options.max_failures = FLAGS_max_endpoint_failures;
+    options.ejection_time = std::chrono::milliseconds(FLAGS_endpoint_ejection_ms);
+    balancer = std::make_shared<riva::clients::EndpointBalancer>(
+        riva::clients::SplitUris(FLAGS_riva_uri),
+        riva::clients::ParseBalancePolicy(FLAGS_balance_policy), options);
+  }
+  recognize_client->SetEndpoints(channel_pools, balancer);
+  recognize_client->SetSla(FLAGS_sla_ms);
+  return recognize_client;
+}
+
+// Streams the given shard of --audio_file, forking --num_processes workers that each take a
+// part of it when more than one is requested
+int
+DoStreamingFromFileInProcesses(
+    riva::utils::scheduling::Policy schedule, const ShardSpec& shard,
+    std::optional<std::chrono::system_clock::time_point> start_time, StreamingRunStats& total)
+{
+  auto run = [&](const ShardSpec& run_shard, const std::string& output_filename,
+                 StreamingRunStats& run_stats) {
+    // The channels must only be created after fork()
+    auto channel_pools = CreateChannelPools();
+    if (channel_pools.empty()) {
+      return 1;
+    }
+    auto recognize_client = CreateRecognizeClient(channel_pools, output_filename);
+    if (start_time) {
+      recognize_client->SetStartTime(*start_time);
+    }
+    return recognize_client->DoStreamingFromFile(
+        FLAGS_audio_file, FLAGS_num_iterations, FLAGS_num_parallel_requests, schedule, run_shard,
+        &run_stats);
+  };
+
+  if (FLAGS_num_processes == 1) {
+    return run(shard, FLAGS_output_filename, total);
+  }
+
+  std::vector<StreamingRunStats> all_stats;
+  int result = riva::utils::stats::RunWorkerProcesses<StreamingRunStats>(
+      FLAGS_num_processes,
+      [&](int32_t worker, StreamingRunStats& run_stats) {
+        std::string output_filename = FLAGS_output_filename;
+        if (output_filename.size()) {
+          output_filename += "." + std::to_string(worker);
+        }
+        ShardSpec worker_shard = shard;
+        worker_shard.index = shard.index * FLAGS_num_processes + worker;
+        worker_shard.count = shard.count * FLAGS_num_processes;
+        return run(worker_shard, output_filename, run_stats);
+      },
+      all_stats);
+
+  if (result) {
+    std::cout << "Some worker processes failed, not printing aggregated performance stats"
+              << std::endl;
+    return result;
+  }
+
+  for (auto& run_stats : all_stats) {
+    MergeRunStats(total, run_stats);
+  }
+  std::cout << "Aggregated over " << FLAGS_num_processes << " processes:" << std::endl;
+  PrintRunStats(total);
+  return 0;
+}
+
+// Prints one row per point of the sweep with its throughput, chunk and finalization latencies
+void
+PrintSweepTable(
+    const std::vector<riva::clients::SweepPoint>& points,
+    const std::vector<StreamingRunStats>& results)
+{
+  constexpr int kWidth = 12;
+  std::cout << "Sweep results (latencies in ms):" << std::endl;
+  for (auto& [flag, value] : points[0]) {
+    std::cout << std::setw(flag.size() + 2) << std::left << flag;
+  }
+  for (auto* column : {"RTFX", "chunk p50", "chunk p95", "final p50", "final p95"}) {
+    std::cout << std::setw(kWidth) << std::left << column;
+  }
+  std::cout << std::endl;
+
+  for (size_t p = 0; p < points.size(); ++p) {
+    for (auto& [flag, value] : points[p]) {
+      std::cout << std::setw(flag.size() + 2) << std::left << value;
+    }
+    auto& stats = results[p];
+    std::cout << std::setw(kWidth) << std::left << stats.audio_processed_sec / stats.run_time_sec;
+    for (auto* histogram : {&stats.latencies, &stats.final_latencies}) {
+      for (double percentile : {50., 95.}) {
+        if (stats.latency_stats_valid) {
+          std::cout << std::setw(kWidth) << std::left << histogram->Percentile(percentile);
+        } else {
+          std::cout << std::setw(kWidth) << std::left << "-";
+        }
+      }
+    }
+    std::cout << std::endl;
+  }
+  if (!results.empty() && !results[0].latency_stats_valid) {
+    std::cout << "Latencies are only measured with --simulate_realtime" << std::endl;
+  }
+}
+
+// Streams --audio_file at every point of the --sweep grid over the same connections, each point
+// after --sweep_warmup_iterations unmeasured passes, and prints a table of the results
+int
+RunSweep(riva::utils::scheduling::Policy schedule, const ShardSpec& shard)
+{
+  std::vector<riva::clients::SweepPoint> points;
+  try {
+    auto axes = riva::clients::ParseSweepGrid(FLAGS_sweep);
+    for (auto& axis : axes) {
+      if (std::find(kSweepFlags.begin(), kSweepFlags.end(), axis.flag) == kSweepFlags.end()) {
+        throw std::invalid_argument("Flag " + axis.flag + " cannot be swept");
+      }
+    }
+    points = riva::clients::SweepPoints(axes);
+  }
+  catch (const std::exception& e) {
+    std::cerr << "Invalid sweep: " << e.what() << std::endl;
+    return 1;
+  }
+
+  auto channel_pools = CreateChannelPools();
+  if (channel_pools.empty()) {
+    return 1;
+  }
+
+  std::vector<StreamingRunStats> results;
+  for (size_t p = 0; p < points.size(); ++p) {
+    std::cout << "Sweep point " << p + 1 << " of " << points.size() << ":";
+    for (auto& [flag, value] : points[p]) {
+      if (gflags::SetCommandLineOption(flag.c_str(), value.c_str()).empty()) {
+        std::cerr << std::endl << "Invalid value " << value << " for " << flag << std::endl;
+        return 1;
+      }
+      std::cout << " " << flag << "=" << value;
+    }
+    std::cout << std::endl;
+
+    if (FLAGS_sweep_warmup_iterations > 0) {
+      auto warmup_client = CreateRecognizeClient(channel_pools, "");
+      if (warmup_client->DoStreamingFromFile(
+              FLAGS_audio_file, FLAGS_sweep_warmup_iterations, FLAGS_num_parallel_requests,
+              schedule, shard)) {
+        return 1;
+      }
+    }
+
+    StreamingRunStats run_stats{};
+    auto recognize_client = CreateRecognizeClient(channel_pools, FLAGS_output_filename);
+    if (recognize_client->DoStreamingFromFile(
+            FLAGS_audio_file, FLAGS_num_iterations, FLAGS_num_parallel_requests, schedule, shard,
+            &run_stats)) {
+      return 1;
+    }
+    results.push_back(run_stats);
+  }
+
+  PrintSweepTable(points, results);
+  return 0;
+}
+
+// Streams --audio_file at increasing numbers of parallel streams over the same connections to
+// find the highest one whose finalization latency meets --capacity_slo_ms
+int
+RunCapacitySearch(riva::utils::scheduling::Policy schedule, const ShardSpec& shard)
+{
+  auto channel_pools = CreateChannelPools();
+  if (channel_pools.empty()) {
+    return 1;
+  }
+
+  riva::clients::CapacitySearch::Options options;
+  options.slo_ms = FLAGS_capacity_slo_ms;
+  options.percentile = FLAGS_capacity_percentile;
+  options.max_concurrency = FLAGS_max_concurrency;
+  options.warmup_runs = FLAGS_capacity_warmup_runs;
+  riva::clients::CapacitySearch search(options);
+  int32_t capacity = search.Run([&](int32_t concurrency, riva::clients::CapacitySample& sample) {
+    // The clients size their stream slots from the flag
+    FLAGS_num_parallel_requests = concurrency;
+    StreamingRunStats run_stats{};
+    auto recognize_client = CreateRecognizeClient(channel_pools, "");
+    if (recognize_client->DoStreamingFromFile(
+            FLAGS_audio_file, FLAGS_num_iterations, concurrency, schedule, shard, &run_stats) ||
+        !run_stats.latency_stats_valid) {
+      return false;
+    }
+    sample.latencies = run_stats.final_latencies;
+    sample.throughput = run_stats.audio_processed_sec / run_stats.run_time_sec;
+    return true;
+  });
+  search.Print(capacity, "RTFX");
+  return capacity < 0 ? 1 : 0;
+}
+
+// Waits for --num_agents agents, starts them all at the same time with this process' scenario
+// flags and prints the statistics merged from all of them
+int
+RunController()
+{
+  try {
+    riva::utils::coordination::Controller controller(FLAGS_controller_port);
+    std::cout << "Waiting for " << FLAGS_num_agents << " agents on port " << controller.Port()
+              << std::endl;
+    controller.AcceptAgents(FLAGS_num_agents);
+
+    std::string scenario;
+    for (auto& name : kScenarioFlags) {
+      std::string value;
+      gflags::GetCommandLineOption(name.c_str(), &value);
+      scenario += name + "=" + value + "\n";
+    }
+    controller.StartAgents(
+        scenario,
+        std::chrono::system_clock::now() + std::chrono::milliseconds(FLAGS_start_delay_ms));
+    auto results = controller.GatherResults();
+
+    // The agents that completed are reported even if others failed
+    StreamingRunStats total{};
+    size_t num_completed = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+      StreamingRunStats run_stats;
+      if (results[i].status != 0 ||
+          !riva::utils::coordination::FromPayload(results[i].payload, run_stats)) {
+        std::cerr << "Agent " << i << " did not complete successfully" << std::endl;
+        continue;
+      }
+      MergeRunStats(total, run_stats);
+      num_completed++;
+    }
+    if (num_completed == 0) {
+      std::cout << "No agent completed, not printing aggregated performance stats" << std::endl;
+      return 1;
+    }
+    std::cout << "Aggregated over " << num_completed << " of " << results.size()
+              << " agents:" << std::endl;
+    PrintRunStats(total);
+    if (num_completed < results.size()) {
+      return 1;
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << "Controller error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Receives a shard and a scenario from the controller at --controller, runs it and reports back
+int
+RunAgent()
+{
+  try {
+    riva::utils::coordination::Agent agent(FLAGS_controller);
+    auto assignment = agent.ReceiveAssignment();
+    std::istringstream scenario(assignment.scenario);
+    std::string line;
+    while (std::getline(scenario, line)) {
+      auto separator = line.find('=');
+      if (separator == std::string::npos ||
+          gflags::SetCommandLineOption(
+              line.substr(0, separator).c_str(), line.substr(separator + 1).c_str())
+              .empty()) {
+        throw std::runtime_error("Invalid scenario flag " + line);
+      }
+    }
+
+    ShardSpec shard;
+    shard.index = assignment.agent_index;
+    shard.count = assignment.num_agents;
+    shard.mode = ParseShardMode(FLAGS_shard_mode);
+    auto schedule = riva::utils::scheduling::ParsePolicy(FLAGS_schedule);
+    std::cout << "Running as agent " << assignment.agent_index << " of "
+              << assignment.num_agents << std::endl;
+
+    StreamingRunStats run_stats{};
+    int status =
+        DoStreamingFromFileInProcesses(schedule, shard, assignment.start_time, run_stats);
+    agent.SendResult(status, riva::utils::coordination::ToPayload(run_stats));
+    return status;
+  }
+  catch (const std::exception& e) {
+    std::cerr << "Agent error: " << e.what() << std::endl;
+    return 1;
+  }
+}
+
 int
 main(int argc, char** argv)
 {
@@ -129,12 +538,35 @@ main(int argc, char** argv)
   str_usage << "           --max_alternatives=<integer>" << std::endl;
   str_usage << "           --profanity_filter=<true|false>" << std::endl;
   str_usage << "           --word_time_offsets=<true|false>" << std::endl;
-  str_usage << "           --riva_uri=<server_name:port> " << std::endl;
+  str_usage << "           --riva_uri=<server_name:port[,server_name:port...]> " << std::endl;
+  str_usage << "           --balance_policy=<round_robin|least_outstanding|latency_weighted> "
+            << std::endl;
+  str_usage << "           --max_endpoint_failures=<integer> " << std::endl;
+  str_usage << "           --endpoint_ejection_ms=<integer> " << std::endl;
+  str_usage << "           --num_connections=<integer> " << std::endl;
+  str_usage << "           --max_streams_per_connection=<integer> " << std::endl;
   str_usage << "           --chunk_duration_ms=<integer> " << std::endl;
   str_usage << "           --interim_results=<true|false> " << std::endl;
   str_usage << "           --simulate_realtime=<true|false> " << std::endl;
   str_usage << "           --num_iterations=<integer> " << std::endl;
   str_usage << "           --num_parallel_requests=<integer> " << std::endl;
+  str_usage << "           --sla_ms=<float> " << std::endl;
+  str_usage << "           --capacity_slo_ms=<float> " << std::endl;
+  str_usage << "           --capacity_percentile=<float> " << std::endl;
+  str_usage << "           --max_concurrency=<integer> " << std::endl;
+  str_usage << "           --capacity_warmup_runs=<integer> " << std::endl;
+  str_usage << "           --schedule=<file_order|longest_first|shortest_first|"
+            << "round_robin|bin_pack>" << std::endl;
+  str_usage << "           --num_processes=<integer> " << std::endl;
+  str_usage << "           --controller_port=<integer> " << std::endl;
+  str_usage << "           --num_agents=<integer> " << std::endl;
+  str_usage << "           --start_delay_ms=<integer> " << std::endl;
+  str_usage << "           --controller=<host:port> " << std::endl;
+  str_usage << "           --sweep=<flag=value,value,...;flag=value,...> " << std::endl;
+  str_usage << "           --sweep_warmup_iterations=<integer> " << std::endl;
+  str_usage << "           --shard_index=<integer> " << std::endl;
+  str_usage << "           --num_shards=<integer> " << std::endl;
+  str_usage << "           --shard_mode=<stride|hash> " << std::endl;
   str_usage << "           --print_transcripts=<true|false> " << std::endl;
   str_usage << "           --output_filename=<string>" << std::endl;
   str_usage << "           --verbatim_transcripts=<true|false>" << std::endl;
@@ -146,7 +578,7 @@ main(int argc, char** argv)
   str_usage << "           --ssl_client_cert=<filename>" << std::endl;
   str_usage << "           --model_name=<model>" << std::endl;
   str_usage << "           --list_models" << std::endl;
-  str_usage << "           --metadata=<key,value,...>" << std::endl;
+  str_usage << "           --metadata=<key,value,...|@filename>" << std::endl;
   str_usage << "           --start_history=<int>" << std::endl;
   str_usage << "           --start_threshold=<float>" << std::endl;
   str_usage << "           --stop_history=<int>" << std::endl;
@@ -187,23 +619,70 @@ main(int argc, char** argv)
     FLAGS_riva_uri = riva_uri;
   }
 
-  std::shared_ptr<grpc::Channel> grpc_channel;
+  riva::utils::scheduling::Policy schedule;
+  ShardSpec shard;
   try {
-    auto creds = riva::clients::CreateChannelCredentials(
-        FLAGS_use_ssl, FLAGS_ssl_root_cert, FLAGS_ssl_client_key, FLAGS_ssl_client_cert,
-        FLAGS_metadata);
-    grpc_channel = riva::clients::CreateChannelBlocking(FLAGS_riva_uri, creds, FLAGS_timeout_ms,
-                                                        FLAGS_max_grpc_message_size);
+    schedule = riva::utils::scheduling::ParsePolicy(FLAGS_schedule);
+    // Only validated here, the balancer is created with each client
+    riva::clients::ParseBalancePolicy(FLAGS_balance_policy);
+    shard.index = FLAGS_shard_index;
+    shard.count = FLAGS_num_shards;
+    shard.mode = ParseShardMode(FLAGS_shard_mode);
   }
   catch (const std::exception& e) {
-    std::cerr << "Error creating GRPC channel: " << e.what() << std::endl;
-    std::cerr << "Exiting." << std::endl;
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  if (FLAGS_controller_port > 0) {
+    return RunController();
+  } else if (FLAGS_controller.size()) {
+    return RunAgent();
+  }
+
+  if (FLAGS_num_processes < 1) {
+    std::cerr << "num_processes must be greater than or equal to 1." << std::endl;
+    return 1;
+  }
+  if (FLAGS_sweep.size()) {
+    if (FLAGS_audio_file.empty() || FLAGS_num_processes > 1) {
+      std::cerr << "sweep requires --audio_file and a single process" << std::endl;
+      return 1;
+    }
+    return RunSweep(schedule, shard);
+  }
+  if (FLAGS_capacity_slo_ms > 0.) {
+    if (FLAGS_audio_file.empty() || FLAGS_num_processes > 1 || !FLAGS_simulate_realtime) {
+      std::cerr << "capacity_slo_ms requires --audio_file, --simulate_realtime and a single process"
+                << std::endl;
+      return 1;
+    }
+    if (FLAGS_capacity_percentile < 0. || FLAGS_capacity_percentile > 100. ||
+        FLAGS_max_concurrency < 1 || FLAGS_capacity_warmup_runs < 0) {
+      std::cerr << "capacity_percentile must be between 0 and 100, max_concurrency positive and "
+                   "capacity_warmup_runs non-negative."
+                << std::endl;
+      return 1;
+    }
+    return RunCapacitySearch(schedule, shard);
+  }
+  if (FLAGS_num_processes > 1) {
+    if (FLAGS_audio_file.empty() || FLAGS_list_models) {
+      std::cerr << "num_processes > 1 requires --audio_file" << std::endl;
+      return 1;
+    }
+    StreamingRunStats run_stats{};
+    return DoStreamingFromFileInProcesses(schedule, shard, std::nullopt, run_stats);
+  }
+
+  auto channel_pools = CreateChannelPools();
+  if (channel_pools.empty()) {
     return 1;
   }
 
   if (FLAGS_list_models) {
     std::unique_ptr<nr_asr::RivaSpeechRecognition::Stub> asr_stub_(
-        nr_asr::RivaSpeechRecognition::NewStub(grpc_channel));
+        nr_asr::RivaSpeechRecognition::NewStub(channel_pools[0]->Channel(0)));
     grpc::ClientContext asr_context;
     nr_asr::RivaSpeechRecognitionConfigRequest asr_request;
     nr_asr::RivaSpeechRecognitionConfigResponse asr_response;
@@ -219,19 +698,11 @@ main(int argc, char** argv)
     return 0;
   }
 
-  StreamingRecognizeClient recognize_client(
-      grpc_channel, FLAGS_num_parallel_requests, FLAGS_language_code, FLAGS_max_alternatives,
-      FLAGS_profanity_filter, FLAGS_word_time_offsets, FLAGS_automatic_punctuation,
-      /* separate_recognition_per_channel*/ false, FLAGS_print_transcripts, FLAGS_chunk_duration_ms,
-      FLAGS_interim_results, FLAGS_output_filename, FLAGS_model_name, FLAGS_simulate_realtime,
-      FLAGS_verbatim_transcripts, FLAGS_boosted_words_file, FLAGS_boosted_words_score,
-      FLAGS_start_history, FLAGS_start_threshold, FLAGS_stop_history, FLAGS_stop_history_eou,
-      FLAGS_stop_threshold, FLAGS_stop_threshold_eou, FLAGS_custom_configuration,
-      FLAGS_speaker_diarization, FLAGS_diarization_max_speakers);
+  auto recognize_client = CreateRecognizeClient(channel_pools, FLAGS_output_filename);
 
   if (FLAGS_audio_file.size()) {
-    return recognize_client.DoStreamingFromFile(
-        FLAGS_audio_file, FLAGS_num_iterations, FLAGS_num_parallel_requests);
+    return recognize_client->DoStreamingFromFile(
+        FLAGS_audio_file, FLAGS_num_iterations, FLAGS_num_parallel_requests, schedule, shard);
 
   } else if (FLAGS_audio_device.size()) {
     if (FLAGS_num_parallel_requests != 1) {
@@ -261,7 +732,7 @@ main(int argc, char** argv)
       return 1;
     }
 
-    return recognize_client.DoStreamingFromMicrophone(FLAGS_audio_device, g_request_exit);
+    return recognize_client->DoStreamingFromMicrophone(FLAGS_audio_device, g_request_exit);
 
   } else {
     std::cout << "No audio files or audio device specified, exiting" << std::endl;
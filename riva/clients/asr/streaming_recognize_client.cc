@@ -11,6 +11,22 @@
 #define clear_screen() printf("\033[H\033[J")
 #define gotoxy(x, y) printf("\033[%d;%dH", (y), (x))
 
+// Mean time between each chunk sent and its response, in milliseconds
+static double
+MeanResponseLatency(const ClientCall& call)
+{
+  size_t num_responses = std::min(call.send_times.size(), call.recv_times.size());
+  if (num_responses == 0) {
+    return 0.;
+  }
+  double total = 0.;
+  for (size_t i = 0; i < num_responses; ++i) {
+    total += std::chrono::duration<double, std::milli>(call.recv_times[i] - call.send_times[i])
+                 .count();
+  }
+  return total / num_responses;
+}
+
 static void
 MicrophoneThreadMain(
     std::shared_ptr<ClientCall> call, snd_pcm_t* alsa_handle, int samplerate, int numchannels,
@@ -84,6 +100,7 @@ StreamingRecognizeClient::StreamingRecognizeClient(
   }
 
   boosted_phrases_ = ReadPhrasesFromFile(boosted_phrases_file);
+  BuildConfigPrototype();
 }
 
 StreamingRecognizeClient::~StreamingRecognizeClient()
@@ -93,12 +110,29 @@ StreamingRecognizeClient::~StreamingRecognizeClient()
   }
 }
 
+void
+StreamingRecognizeClient::SetEndpoints(
+    const std::vector<std::shared_ptr<riva::clients::ChannelPool>>& pools,
+    std::shared_ptr<riva::clients::EndpointBalancer> balancer)
+{
+  endpoint_pools_ = pools;
+  balancer_ = std::move(balancer);
+}
+
 void
 StreamingRecognizeClient::StartNewStream(std::unique_ptr<Stream> stream)
 {
   std::shared_ptr<ClientCall> call =
       std::make_shared<ClientCall>(stream->corr_id, word_time_offsets_, speaker_diarization_);
-  call->streamer = stub_->StreamingRecognize(&call->context);
+  if (!endpoint_pools_.empty()) {
+    call->endpoint = balancer_ ? balancer_->Acquire() : 0;
+    // Blocks while every connection of the endpoint is at its stream limit
+    call->lease = endpoint_pools_[call->endpoint]->Acquire();
+    call->streamer = nr_asr::RivaSpeechRecognition::NewStub(call->lease.Channel())
+                         ->StreamingRecognize(&call->context);
+  } else {
+    call->streamer = stub_->StreamingRecognize(&call->context);
+  }
   call->stream = std::move(stream);
 
   num_active_streams_++;
@@ -112,6 +146,37 @@ StreamingRecognizeClient::StartNewStream(std::unique_ptr<Stream> stream)
   thread_pool_->Enqueue(recv_func);
 }
 
+void
+StreamingRecognizeClient::BuildConfigPrototype()
+{
+  config_prototype_.set_interim_results(interim_results_);
+  auto config = config_prototype_.mutable_config();
+  config->set_language_code(language_code_);
+  config->set_max_alternatives(max_alternatives_);
+  config->set_profanity_filter(profanity_filter_);
+  config->set_enable_word_time_offsets(word_time_offsets_);
+  config->set_enable_automatic_punctuation(automatic_punctuation_);
+  config->set_enable_separate_recognition_per_channel(separate_recognition_per_channel_);
+  auto custom_config = config->mutable_custom_configuration();
+  for (auto& it : ReadCustomConfiguration(custom_configuration_)) {
+    (*custom_config)[it.first] = it.second;
+  }
+  config->set_verbatim_transcripts(verbatim_transcripts_);
+  if (model_name_ != "") {
+    config->set_model(model_name_);
+  }
+
+  nr_asr::SpeechContext* speech_context = config->add_speech_contexts();
+  *(speech_context->mutable_phrases()) = {boosted_phrases_.begin(), boosted_phrases_.end()};
+  speech_context->set_boost(boosted_phrases_score_);
+
+  // Set the endpoint parameters
+  UpdateEndpointingConfig(config);
+
+  // Set the speaker diarization parameters
+  UpdateSpeakerDiarizationConfig(config);
+}
+
 void
 StreamingRecognizeClient::UpdateEndpointingConfig(nr_asr::RecognitionConfig* config)
 {
@@ -162,38 +227,13 @@ StreamingRecognizeClient::GenerateRequests(std::shared_ptr<ClientCall> call)
   while (!done) {
     nr_asr::StreamingRecognizeRequest request;
     if (first_write) {
+      // Only the audio format differs from the prototype
       auto streaming_config = request.mutable_streaming_config();
-      streaming_config->set_interim_results(interim_results_);
+      *streaming_config = config_prototype_;
       auto config = streaming_config->mutable_config();
       config->set_sample_rate_hertz(call->stream->wav->sample_rate);
-      config->set_language_code(language_code_);
       config->set_encoding(call->stream->wav->encoding);
-      config->set_max_alternatives(max_alternatives_);
-      config->set_profanity_filter(profanity_filter_);
       config->set_audio_channel_count(call->stream->wav->channels);
-      config->set_enable_word_time_offsets(word_time_offsets_);
-      config->set_enable_automatic_punctuation(automatic_punctuation_);
-      config->set_enable_separate_recognition_per_channel(separate_recognition_per_channel_);
-      auto custom_config = config->mutable_custom_configuration();
-      std::unordered_map<std::string, std::string> custom_configuration_map =
-          ReadCustomConfiguration(custom_configuration_);
-      for (auto& it : custom_configuration_map) {
-        (*custom_config)[it.first] = it.second;
-      }
-      config->set_verbatim_transcripts(verbatim_transcripts_);
-      if (model_name_ != "") {
-        config->set_model(model_name_);
-      }
-
-      nr_asr::SpeechContext* speech_context = config->add_speech_contexts();
-      *(speech_context->mutable_phrases()) = {boosted_phrases_.begin(), boosted_phrases_.end()};
-      speech_context->set_boost(boosted_phrases_score_);
-
-      // Set the endpoint parameters
-      UpdateEndpointingConfig(config);
-
-      // Set the speaker diarization parameters
-      UpdateSpeakerDiarizationConfig(config);
 
       call->streamer->Write(request);
       first_write = false;
@@ -234,6 +274,10 @@ StreamingRecognizeClient::GenerateRequests(std::shared_ptr<ClientCall> call)
 
     // Set write done to true so next call will lead to WritesDone
     if (offset == call->stream->wav->data.size()) {
+      {
+        std::lock_guard<std::mutex> lock(call->finish_mutex);
+        call->writes_done_time = std::chrono::steady_clock::now();
+      }
       call->streamer->WritesDone();
       done = true;
     }
@@ -245,16 +289,29 @@ StreamingRecognizeClient::GenerateRequests(std::shared_ptr<ClientCall> call)
   }
 
   num_active_streams_--;
+
+  if (sla_->Enabled()) {
+    // Cancel the stream if its final results are not in within the SLA after the last chunk
+    std::unique_lock<std::mutex> lock(call->finish_mutex);
+    auto deadline = *call->writes_done_time +
+                    std::chrono::microseconds(static_cast<int64_t>(sla_->SlaMs() * 1000.));
+    if (!call->finish_cv.wait_until(lock, deadline, [&call]() { return call->finished; })) {
+      call->cancelled_late = true;
+      call->context.TryCancel();
+    }
+  }
 }
 
 int
 StreamingRecognizeClient::DoStreamingFromFile(
-    std::string& audio_file, int32_t num_iterations, int32_t num_parallel_requests)
+    std::string& audio_file, int32_t num_iterations, int32_t num_parallel_requests,
+    riva::utils::scheduling::Policy schedule, const ShardSpec& shard,
+    StreamingRunStats* run_stats)
 {
-  // Preload all wav files, sort by size to reduce tail effects
+  // Preload all wav files, the dispatch order is chosen by the scheduling policy
   std::vector<std::shared_ptr<WaveData>> all_wav;
   try {
-    LoadWavData(all_wav, audio_file);
+    LoadWavData(all_wav, audio_file, shard);
   }
   catch (const std::exception& e) {
     std::cerr << "Unable to load audio file(s): " << e.what() << std::endl;
@@ -265,13 +322,25 @@ StreamingRecognizeClient::DoStreamingFromFile(
     return 1;
   }
 
-  uint32_t all_wav_max = all_wav.size() * num_iterations;
+  std::vector<double> weights = AudioWeights(all_wav);
+  auto order = riva::utils::scheduling::ScheduleWork(
+      weights, num_iterations, num_parallel_requests, schedule);
+
+  uint32_t all_wav_max = order.size();
   std::vector<std::shared_ptr<WaveData>> all_wav_repeated;
   all_wav_repeated.reserve(all_wav_max);
-  for (uint32_t file_id = 0; file_id < all_wav.size(); file_id++) {
-    for (int iter = 0; iter < num_iterations; iter++) {
-      all_wav_repeated.push_back(all_wav[file_id]);
+  for (auto file_id : order) {
+    all_wav_repeated.push_back(all_wav[file_id]);
+  }
+
+  if (start_at_) {
+    auto now = std::chrono::system_clock::now();
+    if (now > *start_at_) {
+      std::cerr << "Start time passed while loading audio, starting "
+                << std::chrono::duration<double, std::milli>(now - *start_at_).count()
+                << " ms late" << std::endl;
     }
+    std::this_thread::sleep_until(*start_at_);
   }
 
   // Ensure there's also num_parallel_requests in flight
@@ -313,11 +382,91 @@ StreamingRecognizeClient::DoStreamingFromFile(
     std::cout << "Run time: " << diff_time / 1000. << " sec." << std::endl;
     std::cout << "Total audio processed: " << total_processed << " sec." << std::endl;
     std::cout << "Throughput: " << total_processed * 1000. / diff_time << " RTFX" << std::endl;
+    if (sla_->Enabled()) {
+      sla_->Print(diff_time / 1000., "audio sec");
+    }
+
+    std::vector<double> completion_times;
+    completion_times.reserve(completion_times_.size());
+    for (auto& t : completion_times_) {
+      completion_times.push_back(std::chrono::duration<double>(t - start_time).count());
+    }
+    double tail_idle =
+        riva::utils::scheduling::TailIdleTime(completion_times, num_parallel_requests);
+    std::cout << "Tail idle slot time (" << riva::utils::scheduling::PolicyName(schedule)
+              << "): " << tail_idle << " sec ("
+              << 100. * tail_idle / (num_parallel_requests * diff_time / 1000.)
+              << "% of slot capacity)" << std::endl;
+    if (balancer_ && balancer_->NumEndpoints() > 1) {
+      balancer_->PrintStats(diff_time / 1000., "RTFX");
+    }
+    for (auto& pool : endpoint_pools_) {
+      if (pool->NumConnections() > 1 || pool->MaxStreamsPerConnection() > 0) {
+        pool->PrintStats();
+      }
+    }
+
+    if (run_stats) {
+      for (auto& [latencies, histogram] :
+           {std::make_pair(&latencies_, &run_stats->latencies),
+            std::make_pair(&int_latencies_, &run_stats->int_latencies),
+            std::make_pair(&final_latencies_, &run_stats->final_latencies)}) {
+        for (double latency : *latencies) {
+          histogram->Record(latency);
+        }
+      }
+      run_stats->latency_stats_valid = print_latency_stats_ && simulate_realtime_;
+      run_stats->num_streams = all_wav_max;
+      run_stats->run_time_sec = diff_time / 1000.;
+      run_stats->audio_processed_sec = total_processed;
+      run_stats->tail_idle_sec = tail_idle;
+      run_stats->sla_ms = sla_->SlaMs();
+      run_stats->sla = sla_->Counts();
+    }
   }
 
   return 0;
 }
 
+void
+MergeRunStats(StreamingRunStats& total, const StreamingRunStats& other)
+{
+  total.latencies.Merge(other.latencies);
+  total.int_latencies.Merge(other.int_latencies);
+  total.final_latencies.Merge(other.final_latencies);
+  total.latency_stats_valid =
+      (total.num_streams == 0 || total.latency_stats_valid) && other.latency_stats_valid;
+  total.num_streams += other.num_streams;
+  total.run_time_sec = std::max(total.run_time_sec, other.run_time_sec);
+  total.audio_processed_sec += other.audio_processed_sec;
+  total.tail_idle_sec += other.tail_idle_sec;
+  total.sla_ms = other.sla_ms;
+  total.sla.Merge(other.sla);
+}
+
+void
+PrintRunStats(const StreamingRunStats& run_stats)
+{
+  if (run_stats.latency_stats_valid) {
+    riva::utils::stats::PrintLatencyTable(run_stats.latencies, "Latencies");
+    riva::utils::stats::PrintLatencyTable(run_stats.int_latencies, "Intermediate latencies");
+    riva::utils::stats::PrintLatencyTable(run_stats.final_latencies, "Final latencies");
+  } else {
+    std::cout << "Not printing latency statistics, at least one run could not measure them"
+              << std::endl;
+  }
+  std::cout << "Streams: " << run_stats.num_streams << std::endl;
+  std::cout << "Run time: " << run_stats.run_time_sec << " sec." << std::endl;
+  std::cout << "Total audio processed: " << run_stats.audio_processed_sec << " sec." << std::endl;
+  std::cout << "Throughput: " << run_stats.audio_processed_sec / run_stats.run_time_sec << " RTFX"
+            << std::endl;
+  std::cout << "Tail idle slot time: " << run_stats.tail_idle_sec << " sec." << std::endl;
+  if (run_stats.sla_ms > 0.) {
+    riva::clients::PrintSlaReport(
+        run_stats.sla, run_stats.sla_ms, run_stats.run_time_sec, "audio sec");
+  }
+}
+
 void
 StreamingRecognizeClient::PostProcessResults(std::shared_ptr<ClientCall> call, bool audio_device)
 {
@@ -391,13 +540,40 @@ StreamingRecognizeClient::ReceiveResponses(std::shared_ptr<ClientCall> call, boo
   }
 
   grpc::Status status = call->streamer->Finish();
+  call->lease.Reset();
+  double finalization_ms = 0.;
+  bool cancelled_late = false;
+  {
+    std::lock_guard<std::mutex> lock(call->finish_mutex);
+    call->finished = true;
+    cancelled_late = call->cancelled_late;
+    if (call->writes_done_time) {
+      finalization_ms = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - *call->writes_done_time)
+                            .count();
+    }
+  }
+  call->finish_cv.notify_all();
+  sla_->Record(status, finalization_ms, call->latest_result_.audio_processed, cancelled_late);
+
   if (!status.ok()) {
-    // Report the RPC failure.
-    std::cerr << status.error_message() << std::endl;
+    // Report the RPC failure. Streams cancelled for missing the SLA are counted by its report.
+    if (!cancelled_late) {
+      std::cerr << status.error_message() << std::endl;
+    }
   } else {
     PostProcessResults(call, audio_device);
   }
+  if (balancer_) {
+    balancer_->Release(
+        call->endpoint, status.ok(), MeanResponseLatency(*call),
+        call->latest_result_.audio_processed);
+  }
 
+  {
+    std::lock_guard<std::mutex> lock(latencies_mutex_);
+    completion_times_.push_back(std::chrono::steady_clock::now());
+  }
   num_streams_finished_++;
 }
 
@@ -21,13 +21,18 @@
 #include <iterator>
 #include <mutex>
 #include <numeric>
+#include <optional>
 #include <queue>
 #include <sstream>
 #include <string>
 #include <thread>
 
 #include "client_call.h"
+#include "riva/clients/utils/endpoint_balancer.h"
+#include "riva/clients/utils/sla.h"
 #include "riva/proto/riva_asr.grpc.pb.h"
+#include "riva/utils/scheduling/scheduling.h"
+#include "riva/utils/stats/latency_histogram.h"
 #include "riva/utils/thread_pool.h"
 #include "riva/utils/wav/wav_reader.h"
 #include "riva_asr_client_helper.h"
@@ -38,6 +43,27 @@ using grpc::StatusCode;
 namespace nr = nvidia::riva;
 namespace nr_asr = nvidia::riva::asr;
 
+// Summary of one DoStreamingFromFile run. It has a fixed size so that worker processes can hand
+// it to their parent through shared memory.
+struct StreamingRunStats {
+  riva::utils::stats::LatencyHistogram latencies;
+  riva::utils::stats::LatencyHistogram int_latencies;
+  riva::utils::stats::LatencyHistogram final_latencies;
+  bool latency_stats_valid;
+  uint32_t num_streams;
+  double run_time_sec;
+  double audio_processed_sec;
+  double tail_idle_sec;
+  // Finalization latency SLA, 0 when not set, and the streams meeting it
+  double sla_ms;
+  riva::clients::SlaCounts sla;
+};
+
+// Adds the streams of `other` to `total`. Run times overlap, so the longest one is kept.
+void MergeRunStats(StreamingRunStats& total, const StreamingRunStats& other);
+
+void PrintRunStats(const StreamingRunStats& run_stats);
+
 class StreamingRecognizeClient {
  public:
   StreamingRecognizeClient(
@@ -62,6 +88,24 @@ class StreamingRecognizeClient {
 
   void StartNewStream(std::unique_ptr<Stream> stream);
 
+  // Sends the streams of DoStreamingFromFile over the connections of the given pools, one pool per
+  // server. The balancer picks the server when there are several of them
+  void SetEndpoints(
+      const std::vector<std::shared_ptr<riva::clients::ChannelPool>>& pools,
+      std::shared_ptr<riva::clients::EndpointBalancer> balancer);
+
+  // Makes DoStreamingFromFile wait, once the audio is loaded, until the given wall clock time
+  // before sending the first request
+  void SetStartTime(std::chrono::system_clock::time_point start_time) { start_at_ = start_time; }
+
+  // Gives every stream of DoStreamingFromFile `sla_ms` after its last audio chunk to return its
+  // final results. Streams missing it are cancelled and reported as late.
+  void SetSla(double sla_ms) { sla_ = std::make_unique<riva::clients::SlaTracker>(sla_ms); }
+
+  // Builds the part of the streaming configuration shared by every stream, which each stream
+  // copies before setting its audio format
+  void BuildConfigPrototype();
+
   void UpdateEndpointingConfig(nr_asr::RecognitionConfig* config);
 
   void UpdateSpeakerDiarizationConfig(nr_asr::RecognitionConfig* config);
@@ -69,7 +113,9 @@ class StreamingRecognizeClient {
   void GenerateRequests(std::shared_ptr<ClientCall> call);
 
   int DoStreamingFromFile(
-      std::string& audio_file, int32_t num_iterations, int32_t num_parallel_requests);
+      std::string& audio_file, int32_t num_iterations, int32_t num_parallel_requests,
+      riva::utils::scheduling::Policy schedule = riva::utils::scheduling::Policy::kFileOrder,
+      const ShardSpec& shard = ShardSpec(), StreamingRunStats* run_stats = nullptr);
 
   void PostProcessResults(std::shared_ptr<ClientCall> call, bool audio_device);
 
@@ -89,7 +135,12 @@ class StreamingRecognizeClient {
   // Out of the passed in Channel comes the stub, stored here, our view of the
   // server's exposed services.
   std::unique_ptr<nr_asr::RivaSpeechRecognition::Stub> stub_;
+  std::vector<std::shared_ptr<riva::clients::ChannelPool>> endpoint_pools_;
+  std::shared_ptr<riva::clients::EndpointBalancer> balancer_;
   std::vector<double> int_latencies_, final_latencies_, latencies_;
+  std::vector<std::chrono::steady_clock::time_point> completion_times_;
+  std::optional<std::chrono::system_clock::time_point> start_at_;
+  std::unique_ptr<riva::clients::SlaTracker> sla_ = std::make_unique<riva::clients::SlaTracker>(0.);
 
   std::string language_code_;
   int32_t max_alternatives_;
@@ -120,6 +171,8 @@ class StreamingRecognizeClient {
   bool verbatim_transcripts_;
 
   std::vector<std::string> boosted_phrases_;
+  // Configuration of every stream read from a file, but for the audio format
+  nr_asr::StreamingRecognitionConfig config_prototype_;
   float boosted_phrases_score_;
 
   int32_t start_history_;
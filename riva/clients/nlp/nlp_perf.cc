@@ -0,0 +1,182 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nlp_perf.h"
+
+#include <gflags/gflags.h>
+
+#include <cstdlib>
+#include <sstream>
+
+#include "riva/clients/utils/grpc.h"
+#include "riva/utils/stamping.h"
+
+DEFINE_string(riva_uri, "localhost:50051", "URI to access riva-server");
+DEFINE_string(model_name, "", "Model name to test");
+DEFINE_string(language_code, "en-US", "Model language code");
+DEFINE_string(queries, "", "Path to a file with one input sentence per line");
+DEFINE_string(output, "", "Path to output file, written in the order of the input sentences");
+DEFINE_int32(
+    output_window, 1024,
+    "Maximum number of sentences sent past the oldest one not yet written to the output file");
+DEFINE_string(ssl_root_cert, "", "Path to SSL root certificates file");
+DEFINE_string(ssl_client_key, "", "Path to SSL client certificates key");
+DEFINE_string(ssl_client_cert, "", "Path to SSL client certificates file");
+DEFINE_int32(num_iterations, 1, "Number of times to loop over strings");
+DEFINE_int32(parallel_requests, 10, "Number of in-flight sentences to send");
+DEFINE_int32(
+    batch_size, 1,
+    "Maximum number of sentences packed into one request. Requests only fill up when "
+    "parallel_requests is at least as large");
+DEFINE_double(
+    max_batch_wait_ms, 5.,
+    "Maximum time a sentence waits for others to fill its request when batch_size > 1");
+DEFINE_int32(
+    max_attempts, 1, "Maximum number of attempts per request, counting hedges and retries");
+DEFINE_double(
+    hedge_delay_ms, 0.,
+    "Delay after which another attempt is sent if a request got no answer, 0 to only retry");
+DEFINE_double(
+    hedge_percentile, 0.,
+    "Percentile of the observed latencies used as hedge delay, hedge_delay_ms being used until "
+    "enough requests completed");
+DEFINE_double(
+    retry_budget, 0.1, "Maximum ratio of hedges and retries to requests, on top of a few extra");
+DEFINE_bool(print_results, true, "Print final classification results");
+DEFINE_bool(
+    use_ssl, false,
+    "Whether to use SSL credentials or not. If ssl_root_cert is specified, "
+    "this is assumed to be true");
+DEFINE_string(
+    metadata, "",
+    "Comma separated key-value pair(s) of metadata to be sent to server, or @<file> to read them "
+    "from a file that is reloaded when it changes");
+
+bool
+ParseNLPPerfFlags(
+    int argc, char** argv, const std::string& name, const std::string& usage,
+    NLPPerfOptions& options)
+{
+  std::stringstream str_usage;
+  str_usage << "Usage: " << name << std::endl;
+  str_usage << "           --queries=<filename> " << std::endl;
+  str_usage << usage;
+  str_usage << "           --riva_uri=<server_name:port> " << std::endl;
+  str_usage << "           --model_name=<model> " << std::endl;
+  str_usage << "           --language_code=<bcp 47 language code (such as en-US)> " << std::endl;
+  str_usage << "           --num_iterations=<integer> " << std::endl;
+  str_usage << "           --parallel_requests=<integer> " << std::endl;
+  str_usage << "           --batch_size=<integer> " << std::endl;
+  str_usage << "           --max_batch_wait_ms=<float> " << std::endl;
+  str_usage << "           --max_attempts=<integer> " << std::endl;
+  str_usage << "           --hedge_delay_ms=<float> " << std::endl;
+  str_usage << "           --hedge_percentile=<float> " << std::endl;
+  str_usage << "           --retry_budget=<float> " << std::endl;
+  str_usage << "           --print_results=<true|false> " << std::endl;
+  str_usage << "           --output=<filename> " << std::endl;
+  str_usage << "           --output_window=<integer> " << std::endl;
+  str_usage << "           --ssl_root_cert=<filename>" << std::endl;
+  str_usage << "           --ssl_client_key=<filename>" << std::endl;
+  str_usage << "           --ssl_client_cert=<filename>" << std::endl;
+  str_usage << "           --metadata=<key,value,...|@filename>" << std::endl;
+  gflags::SetUsageMessage(str_usage.str());
+  gflags::SetVersionString(::riva::utils::kBuildScmRevision);
+
+  if (argc < 2) {
+    std::cout << gflags::ProgramUsage();
+    return false;
+  }
+
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc > 1) {
+    std::cout << gflags::ProgramUsage();
+    return false;
+  }
+
+  if (FLAGS_max_attempts < 1 || FLAGS_hedge_percentile < 0. || FLAGS_hedge_percentile > 100.) {
+    std::cerr << "max_attempts must be greater than or equal to 1 and hedge_percentile between 0 "
+                 "and 100."
+              << std::endl;
+    return false;
+  }
+
+  if (FLAGS_parallel_requests < 1 || FLAGS_num_iterations < 1) {
+    std::cerr << "parallel_requests and num_iterations must be greater than or equal to 1."
+              << std::endl;
+    return false;
+  }
+
+  if (FLAGS_batch_size < 1 || FLAGS_max_batch_wait_ms < 0.) {
+    std::cerr << "batch_size must be greater than or equal to 1 and max_batch_wait_ms "
+                 "non-negative."
+              << std::endl;
+    return false;
+  }
+
+  if (FLAGS_output_window < 1) {
+    std::cerr << "output_window must be greater than or equal to 1." << std::endl;
+    return false;
+  }
+
+  bool flag_set = gflags::GetCommandLineFlagInfoOrDie("riva_uri").is_default;
+  const char* riva_uri = getenv("RIVA_URI");
+
+  if (riva_uri && flag_set) {
+    std::cout << "Using environment for " << riva_uri << std::endl;
+    FLAGS_riva_uri = riva_uri;
+  }
+
+  options.model_name = FLAGS_model_name;
+  options.language_code = FLAGS_language_code;
+  options.queries = FLAGS_queries;
+  options.output = FLAGS_output;
+  options.output_window = FLAGS_output_window;
+  options.num_iterations = FLAGS_num_iterations;
+  options.parallel_requests = FLAGS_parallel_requests;
+  options.batch_size = FLAGS_batch_size;
+  options.max_batch_wait_ms = FLAGS_max_batch_wait_ms;
+  options.print_results = FLAGS_print_results;
+  options.hedging.max_attempts = FLAGS_max_attempts;
+  options.hedging.hedge_delay_ms = FLAGS_hedge_delay_ms;
+  options.hedging.hedge_percentile = FLAGS_hedge_percentile;
+  options.hedging.retry_budget = FLAGS_retry_budget;
+  return true;
+}
+
+std::shared_ptr<grpc::Channel>
+CreateNLPPerfChannel()
+{
+  try {
+    auto creds = riva::clients::CreateChannelCredentials(
+        FLAGS_use_ssl, FLAGS_ssl_root_cert, FLAGS_ssl_client_key, FLAGS_ssl_client_cert,
+        FLAGS_metadata);
+    return riva::clients::CreateChannelBlocking(FLAGS_riva_uri, creds);
+  }
+  catch (const std::exception& e) {
+    std::cerr << "Error creating GRPC channel: " << e.what() << std::endl;
+    std::cerr << "Exiting." << std::endl;
+    return nullptr;
+  }
+}
+
+bool
+LoadStringData(std::vector<std::string>& all_queries, const std::string& path)
+{
+  std::ifstream in(path.c_str());
+
+  if (!in) {
+    std::cerr << "Cannot open path: " << path << std::endl;
+    return false;
+  }
+
+  std::string str;
+  while (std::getline(in, str)) {
+    if (str.size() > 0)
+      all_queries.push_back(str);
+  }
+  in.close();
+  return true;
+}
@@ -0,0 +1,186 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "riva/clients/utils/hedging.h"
+#include "riva/utils/reorder_buffer.h"
+#include "riva_nlp_client.h"
+
+// Load loop shared by the NLP perf clients: the client binaries only define how their queries
+// are built, sent and printed, and get the concurrency, batching, hedging, output and report
+// options of nlp_perf.cc.
+
+class Query {
+ public:
+  Query(uint32_t corr_id) : corr_id_(corr_id) {}
+  uint32_t GetCorrId() const { return corr_id_; }
+
+ private:
+  uint32_t corr_id_;
+};
+
+// Query of the services taking a text and a model
+class TextQuery : public Query {
+ public:
+  TextQuery(
+      const std::string& text, const std::string& model, const std::string& language_code,
+      uint32_t _corr_id)
+      : Query(_corr_id), text_(text), model_(model), language_code_(language_code)
+  {
+  }
+  std::string GetText() const { return text_; }
+  std::string GetModel() const { return model_; }
+  std::string GetLanguageCode() const { return language_code_; }
+
+ private:
+  std::string text_;
+  std::string model_;
+  std::string language_code_;
+};
+
+// Options shared by the NLP perf clients, from their command line
+struct NLPPerfOptions {
+  std::string model_name;
+  std::string language_code;
+  std::string queries;
+  std::string output;
+  int32_t output_window = 1024;
+  int32_t num_iterations = 1;
+  int32_t parallel_requests = 10;
+  int32_t batch_size = 1;
+  double max_batch_wait_ms = 5.;
+  bool print_results = true;
+  riva::clients::HedgingPolicy::Options hedging;
+};
+
+// Parses and validates the command line of the NLP perf client `name`, whose own flags are
+// listed in `usage`. Returns false if the client should exit with an error.
+bool ParseNLPPerfFlags(
+    int argc, char** argv, const std::string& name, const std::string& usage,
+    NLPPerfOptions& options);
+
+// Connects to --riva_uri, returns null on failure
+std::shared_ptr<grpc::Channel> CreateNLPPerfChannel();
+
+// Reads the non-empty lines of `path`
+bool LoadStringData(std::vector<std::string>& all_queries, const std::string& path);
+
+// Sends the queries of `num_inputs` inputs, each num_iterations times, with parallel_requests
+// queries in flight and prints the throughput and latencies of the run.
+//
+// `make_query` builds the query of an input, `format_func` the text of a result, printed after
+// `result_name` and written to the output file in the order of the queries. Requests are only
+// batched by clients passing `extract_item_func`. Returns the exit status of the client.
+template <class T_Query, class T_Response, class T_Request>
+int
+RunNLPPerf(
+    const NLPPerfOptions& options,
+    typename NLPClient<T_Query, T_Response, T_Request>::PrepareFunc prepare_func,
+    typename NLPClient<T_Query, T_Response, T_Request>::FillRequestFunc fill_request_func,
+    typename NLPClient<T_Query, T_Response, T_Request>::ExtractItemFunc extract_item_func,
+    const std::string& result_name, std::function<std::string(const T_Response&)> format_func,
+    size_t num_inputs,
+    std::function<std::unique_ptr<T_Query>(size_t input, uint32_t corr_id)> make_query)
+{
+  using Client = NLPClient<T_Query, T_Response, T_Request>;
+  if (options.batch_size > 1 && !extract_item_func) {
+    std::cerr << "This service does not support batch_size > 1." << std::endl;
+    return 1;
+  }
+
+  // Responses complete out of order, the reorder buffer writes them in the order of the queries
+  std::ofstream outfile;
+  std::unique_ptr<riva::utils::ReorderBuffer<std::string>> output_buffer;
+  if (!options.output.empty()) {
+    outfile.open(options.output);
+    output_buffer = std::make_unique<riva::utils::ReorderBuffer<std::string>>(
+        options.output_window, [&outfile](uint64_t corr_id, std::string& text) {
+          outfile << corr_id << "\t" << text << std::endl;
+        });
+  }
+
+  auto print_response_func = [&](T_Query& query, T_Response& response) -> void {
+    std::cout << query.GetCorrId() << ":\t";
+    std::cout << result_name << ": " << format_func(response) << std::endl;
+  };
+
+  Client client(prepare_func, fill_request_func, print_response_func, options.print_results);
+  client.SetHedgingOptions(options.hedging);
+  if (extract_item_func) {
+    client.SetBatching(options.batch_size, options.max_batch_wait_ms, extract_item_func);
+  }
+  if (output_buffer) {
+    // Failed queries are left out of the output rather than holding back the later ones
+    client.SetResultFunc([&](T_Query& query, T_Response* response) {
+      if (response) {
+        output_buffer->Push(query.GetCorrId(), format_func(*response));
+      } else {
+        output_buffer->Skip(query.GetCorrId());
+      }
+    });
+  }
+
+  // Spawn reader thread that loops indefinitely
+  std::thread thread_ = std::thread(&Client::AsyncCompleteRpc, &client);
+
+  // Ensure there's also num_channels requests in flight
+  uint32_t all_query_max = num_inputs * options.num_iterations;
+  uint32_t all_query_i = 0;
+  auto start_time = std::chrono::steady_clock::now();
+  while (true) {
+    while (client.NumActiveTasks() < (uint32_t)options.parallel_requests &&
+           all_query_i < all_query_max) {
+      if (output_buffer) {
+        output_buffer->WaitForSlot(all_query_i);
+      }
+      // Each input is repeated num_iterations times in a row
+      client.Infer(make_query(all_query_i / options.num_iterations, all_query_i));
+      ++all_query_i;
+    }
+
+    if (all_query_i == all_query_max) {
+      break;
+    }
+  }
+
+  client.DoneSending();
+  thread_.join();
+
+  if (!options.output.empty()) {
+    outfile.close();
+    std::cout << "Output written to " << options.output << std::endl;
+  }
+
+  if (client.NumFailedRequests() || client.NumFailedItems()) {
+    std::cout << "Some requests failed to complete properly, not printing performance stats"
+              << std::endl;
+  } else {
+    auto current_time = std::chrono::steady_clock::now();
+    double diff_time = std::chrono::duration<double, std::milli>(current_time - start_time).count();
+    std::cout << "Run time: " << diff_time / 1000. << "s" << std::endl;
+    std::cout << "Total sequences processed: " << client.TotalSequencesProcessed() << std::endl;
+    std::cout << "Throughput: " << client.TotalSequencesProcessed() * 1000. / diff_time
+              << " seq/sec" << std::endl;
+
+    client.PrintStats();
+  }
+  if (options.hedging.max_attempts > 1) {
+    client.Hedging().PrintStats();
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <grpcpp/grpcpp.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nlp_perf.h"
+#include "riva_nlp_client.h"
+
+namespace nr = nvidia::riva;
+namespace nr_nlp = nvidia::riva::nlp;
+
+DEFINE_string(domain, "", "Domain of the queries, empty to let the server detect it");
+
+// Domain, intent and slots of the response, e.g. "weather, weather.temperature 0.97, slots:
+// Santa Clara (weatherplace 0.99)"
+std::string
+FormatIntent(const nr_nlp::AnalyzeIntentResponse& response)
+{
+  std::stringstream ss;
+  ss << response.domain_str() << ", " << response.intent().class_name() << " "
+     << response.intent().score() << ", slots:";
+  for (auto& slot : response.slots()) {
+    ss << " " << slot.token();
+    if (slot.label_size()) {
+      ss << " (" << slot.label(0).class_name() << " " << slot.label(0).score() << ")";
+    }
+  }
+  return ss.str();
+}
+
+int
+main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = 1;
+
+  std::stringstream str_usage;
+  str_usage << "           --domain=<domain> " << std::endl;
+  NLPPerfOptions options;
+  if (!ParseNLPPerfFlags(argc, argv, "riva_nlp_analyze_intent", str_usage.str(), options)) {
+    return 1;
+  }
+
+  auto grpc_channel = CreateNLPPerfChannel();
+  if (!grpc_channel) {
+    return 1;
+  }
+  auto stub = nr_nlp::RivaLanguageUnderstanding::NewStub(grpc_channel);
+
+  auto prepare_func = [&stub](
+      grpc::ClientContext * context, const nr_nlp::AnalyzeIntentRequest& request,
+      grpc::CompletionQueue* cq) -> auto
+  {
+    return std::move(stub->PrepareAsyncAnalyzeIntent(context, request, cq));
+  };
+
+  // One query per request, the service has no batched form
+  auto fill_request_func = [](TextQuery& query, nr_nlp::AnalyzeIntentRequest& request) -> void {
+    request.set_query(query.GetText());
+    auto intent_options = request.mutable_options();
+    intent_options->set_domain(FLAGS_domain);
+    intent_options->set_lang(query.GetLanguageCode());
+  };
+
+  std::vector<std::string> all_queries;
+  if (!LoadStringData(all_queries, options.queries)) {
+    return 1;
+  }
+
+  return RunNLPPerf<TextQuery, nr_nlp::AnalyzeIntentResponse, nr_nlp::AnalyzeIntentRequest>(
+      options, prepare_func, fill_request_func, nullptr, "Intent", FormatIntent,
+      all_queries.size(), [&](size_t input, uint32_t corr_id) {
+        return std::make_unique<TextQuery>(
+            all_queries[input], options.model_name, options.language_code, corr_id);
+      });
+}
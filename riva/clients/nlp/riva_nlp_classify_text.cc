@@ -0,0 +1,96 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <grpcpp/grpcpp.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nlp_perf.h"
+#include "riva_nlp_client.h"
+
+namespace nr = nvidia::riva;
+namespace nr_nlp = nvidia::riva::nlp;
+
+DEFINE_int32(top_n, 1, "Number of labels returned for each sentence");
+
+// Labels of the first sentence of the response with their scores, e.g. "weather 0.98"
+std::string
+FormatLabels(const nr_nlp::TextClassResponse& response)
+{
+  std::stringstream ss;
+  if (response.results_size()) {
+    for (auto& label : response.results(0).labels()) {
+      if (ss.tellp() > 0) {
+        ss << ", ";
+      }
+      ss << label.class_name() << " " << label.score();
+    }
+  }
+  return ss.str();
+}
+
+int
+main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = 1;
+
+  std::stringstream str_usage;
+  str_usage << "           --top_n=<integer> " << std::endl;
+  NLPPerfOptions options;
+  if (!ParseNLPPerfFlags(argc, argv, "riva_nlp_classify_text", str_usage.str(), options)) {
+    return 1;
+  }
+  if (FLAGS_top_n < 1) {
+    std::cerr << "top_n must be greater than or equal to 1." << std::endl;
+    return 1;
+  }
+
+  auto grpc_channel = CreateNLPPerfChannel();
+  if (!grpc_channel) {
+    return 1;
+  }
+  auto stub = nr_nlp::RivaLanguageUnderstanding::NewStub(grpc_channel);
+
+  auto prepare_func = [&stub](
+      grpc::ClientContext * context, const nr_nlp::TextClassRequest& request,
+      grpc::CompletionQueue* cq) -> auto
+  {
+    return std::move(stub->PrepareAsyncClassifyText(context, request, cq));
+  };
+
+  auto fill_request_func = [](TextQuery& query, nr_nlp::TextClassRequest& request) -> void {
+    request.add_text(query.GetText());
+    request.set_top_n(FLAGS_top_n);
+    auto model = request.mutable_model();
+    model->set_model_name(query.GetModel());
+    model->set_language_code(query.GetLanguageCode());
+  };
+
+  std::vector<std::string> all_queries;
+  if (!LoadStringData(all_queries, options.queries)) {
+    return 1;
+  }
+
+  return RunNLPPerf<TextQuery, nr_nlp::TextClassResponse, nr_nlp::TextClassRequest>(
+      options, prepare_func, fill_request_func,
+      [](const nr_nlp::TextClassResponse& response, size_t index,
+         nr_nlp::TextClassResponse& item) {
+        if (index >= static_cast<size_t>(response.results_size())) {
+          return false;
+        }
+        *item.add_results() = response.results(index);
+        return true;
+      },
+      "Labels", FormatLabels, all_queries.size(), [&](size_t input, uint32_t corr_id) {
+        return std::make_unique<TextQuery>(
+            all_queries[input], options.model_name, options.language_code, corr_id);
+      });
+}
@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <grpcpp/grpcpp.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nlp_perf.h"
+#include "riva_nlp_client.h"
+
+namespace nr = nvidia::riva;
+namespace nr_nlp = nvidia::riva::nlp;
+
+// Tokens of the first sequence of the response with their top label, e.g. "NVIDIA (ORG 0.99)"
+std::string
+FormatTokens(const nr_nlp::TokenClassResponse& response)
+{
+  std::stringstream ss;
+  if (response.results_size()) {
+    for (auto& token : response.results(0).results()) {
+      if (ss.tellp() > 0) {
+        ss << ", ";
+      }
+      ss << token.token();
+      if (token.label_size()) {
+        ss << " (" << token.label(0).class_name() << " " << token.label(0).score() << ")";
+      }
+    }
+  }
+  return ss.str();
+}
+
+int
+main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = 1;
+
+  NLPPerfOptions options;
+  if (!ParseNLPPerfFlags(argc, argv, "riva_nlp_classify_tokens", "", options)) {
+    return 1;
+  }
+
+  auto grpc_channel = CreateNLPPerfChannel();
+  if (!grpc_channel) {
+    return 1;
+  }
+  auto stub = nr_nlp::RivaLanguageUnderstanding::NewStub(grpc_channel);
+
+  auto prepare_func = [&stub](
+      grpc::ClientContext * context, const nr_nlp::TokenClassRequest& request,
+      grpc::CompletionQueue* cq) -> auto
+  {
+    return std::move(stub->PrepareAsyncClassifyTokens(context, request, cq));
+  };
+
+  auto fill_request_func = [](TextQuery& query, nr_nlp::TokenClassRequest& request) -> void {
+    request.add_text(query.GetText());
+    request.set_top_n(1);
+    auto model = request.mutable_model();
+    model->set_model_name(query.GetModel());
+    model->set_language_code(query.GetLanguageCode());
+  };
+
+  std::vector<std::string> all_queries;
+  if (!LoadStringData(all_queries, options.queries)) {
+    return 1;
+  }
+
+  return RunNLPPerf<TextQuery, nr_nlp::TokenClassResponse, nr_nlp::TokenClassRequest>(
+      options, prepare_func, fill_request_func,
+      [](const nr_nlp::TokenClassResponse& response, size_t index,
+         nr_nlp::TokenClassResponse& item) {
+        if (index >= static_cast<size_t>(response.results_size())) {
+          return false;
+        }
+        *item.add_results() = response.results(index);
+        return true;
+      },
+      "Tokens", FormatTokens, all_queries.size(), [&](size_t input, uint32_t corr_id) {
+        return std::make_unique<TextQuery>(
+            all_queries[input], options.model_name, options.language_code, corr_id);
+      });
+}
@@ -10,8 +10,10 @@
 #include <grpcpp/grpcpp.h>
 #include <strings.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <csignal>
 #include <fstream>
 #include <iomanip>
@@ -22,7 +24,9 @@
 #include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 
+#include "riva/clients/utils/hedging.h"
 #include "riva/proto/riva_nlp.grpc.pb.h"
 
 using grpc::Status;
@@ -41,16 +45,27 @@ class NLPClient {
 
   using PrintResponseFunc = std::function<void(T_Query& query, T_Response& response)>;
 
+  // Called for every query once its request completed, with its response, or null if the
+  // request failed
+  using ResultFunc = std::function<void(T_Query& query, T_Response* response)>;
+
+  // Copies the result of item `index` of a batched response into `item`, a response of its own.
+  // Returns false if the response has no result for the item.
+  using ExtractItemFunc =
+      std::function<bool(const T_Response& response, size_t index, T_Response& item)>;
+
   NLPClient(
       PrepareFunc prepare_func, FillRequestFunc fill_request_func,
       PrintResponseFunc print_response_func, bool print_results)
       : prepare_func_(prepare_func), fill_request_func_(fill_request_func),
         print_response_func_(print_response_func), print_results_(print_results),
         total_sequences_processed_(0), done_sending_(false), num_requests_(0), num_responses_(0),
-        num_failed_requests_(0)
+        num_failed_requests_(0), num_failed_items_(0)
   {
   }
 
+  ~NLPClient() { StopFlushing(); }
+
   uint32_t NumActiveTasks()
   {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -61,6 +76,33 @@ class NLPClient {
 
   uint32_t NumFailedRequests() { return num_failed_requests_; }
 
+  // Queries of successful batched requests whose response had no result for them
+  uint32_t NumFailedItems() { return num_failed_items_; }
+
+  riva::clients::HedgingPolicy& Hedging() { return *hedging_; }
+
+  void SetHedgingOptions(const riva::clients::HedgingPolicy::Options& options)
+  {
+    hedging_ = std::make_unique<riva::clients::HedgingPolicy>(options);
+  }
+
+  // Sets the function getting the result of every query, whether or not results are printed
+  void SetResultFunc(ResultFunc result_func) { result_func_ = result_func; }
+
+  // Packs up to `max_batch_size` queries into each request, fill_request_func being called for
+  // each of them on the same request. A query waits at most `max_wait_ms` for others to join it.
+  // The print function gets the result of each query, taken from the batched response by
+  // `extract_item_func`. Must be called before the first Infer.
+  void SetBatching(int32_t max_batch_size, double max_wait_ms, ExtractItemFunc extract_item_func)
+  {
+    max_batch_size_ = std::max(max_batch_size, 1);
+    max_wait_ = std::chrono::microseconds(static_cast<int64_t>(max_wait_ms * 1000.));
+    extract_item_func_ = extract_item_func;
+    if (max_batch_size_ > 1) {
+      flush_thread_ = std::thread(&NLPClient::FlushExpiredBatches, this);
+    }
+  }
+
   void PrintStats()
   {
     std::sort(latencies_.begin(), latencies_.end());
@@ -85,43 +127,56 @@ class NLPClient {
 
   void DoneSending()
   {
-    done_sending_ = true;
+    // The last, partial batch is sent right away
+    StopFlushing();
+    std::vector<PendingQuery> batch;
+    {
+      std::lock_guard<std::mutex> lock(batch_mutex_);
+      batch.swap(pending_);
+    }
+    if (!batch.empty()) {
+      Send(std::move(batch));
+    }
+    bool all_done;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_sending_ = true;
+      all_done = num_responses_ == num_requests_;
+    }
     std::cout << "Done sending " << num_requests_ << " requests" << std::endl;
+    // Every response already came back, nothing else would wake AsyncCompleteRpc up
+    if (all_done) {
+      cq_.Shutdown();
+    }
     return;
   }
 
-  // Assembles the client's payload and sends it to the server.
+  // Queues the query for the next batch, which is sent once full, or sends it right away when
+  // requests are not batched.
   void Infer(std::unique_ptr<T_Query> query)
   {
-    // Data we are sending to the server.
-    T_Request request;
-    fill_request_func_(*query, request);
-
     {
       std::lock_guard<std::mutex> lock(mutex_);
       curr_tasks_.emplace(query->GetCorrId());
-      num_requests_++;
     }
 
-    // Call object to store rpc data
-    AsyncClientCall* call = new AsyncClientCall;
-
-    call->query = std::move(query);
-    call->start_time = std::chrono::steady_clock::now();
-
-    // stub_->PrepareAsyncSayHello() creates an RPC object, returning
-    // an instance to store in "call" but does not actually start the RPC
-    // Because we are using the asynchronous API, we need to hold on to
-    // the "call" instance in order to get updates on the ongoing RPC.
-    call->response_reader = prepare_func_(&call->context, request, &cq_);
-
-    // StartCall initiates the RPC call
-    call->response_reader->StartCall();
-
-    // Request that, upon completion of the RPC, "reply" be updated with the
-    // server's response; "status" with the indication of whether the operation
-    // was successful. Tag the request with the memory address of the call object.
-    call->response_reader->Finish(&call->response, &call->status, (void*)call);
+    std::vector<PendingQuery> batch;
+    PendingQuery pending{std::move(query), std::chrono::steady_clock::now()};
+    if (max_batch_size_ <= 1) {
+      batch.push_back(std::move(pending));
+    } else {
+      std::lock_guard<std::mutex> lock(batch_mutex_);
+      pending_.push_back(std::move(pending));
+      if (pending_.size() >= static_cast<size_t>(max_batch_size_)) {
+        batch.swap(pending_);
+      } else if (pending_.size() == 1) {
+        // A new batch was started, whose deadline the flush thread must wait for
+        batch_cv_.notify_one();
+      }
+    }
+    if (!batch.empty()) {
+      Send(std::move(batch));
+    }
   }
 
   // Loop while listening for completed responses.
@@ -134,65 +189,156 @@ class NLPClient {
     // Block until the next result is available in the completion queue "cq".
     bool stop_flag = false;
     while (!stop_flag && cq_.Next(&got_tag, &ok)) {
-      // The tag in this example is the memory location of the call object
-      AsyncClientCall* call = static_cast<AsyncClientCall*>(got_tag);
-
-      // Verify that the request was completed successfully. Note that "ok"
-      // corresponds solely to the request for updates introduced by Finish().
-      GPR_ASSERT(ok);
+      // Tags are attempts and hedging alarms of the calls, a call is complete once all of them
+      // came back
+      auto* tag = static_cast<riva::clients::HedgedCallTag*>(got_tag);
+      if (!tag->call->Proceed(tag, ok)) {
+        continue;
+      }
+      AsyncClientCall* call = static_cast<AsyncClientCall*>(tag->call);
 
       if (call->status.ok()) {
-        auto end_time = std::chrono::steady_clock::now();
-        double lat = std::chrono::duration<double, std::milli>(end_time - call->start_time).count();
-        total_sequences_processed_++;
-        latencies_.push_back(lat);
-
-        if (print_results_) {
-          std::lock_guard<std::mutex> lock(mutex_);
-          print_response_func_(*(call->query), call->response);
+        for (size_t i = 0; i < call->queries.size(); ++i) {
+          auto& item = call->queries[i];
+          T_Response* response = &call->response;
+          T_Response item_response;
+          if (call->queries.size() > 1) {
+            if (!extract_item_func_(call->response, i, item_response)) {
+              std::cout << "No result for query " << item.query->GetCorrId() << " in a response to "
+                        << call->queries.size() << " queries" << std::endl;
+              num_failed_items_++;
+              if (result_func_) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                result_func_(*item.query, nullptr);
+              }
+              continue;
+            }
+            response = &item_response;
+          }
+          // Time spent waiting for the batch to fill up included
+          total_sequences_processed_++;
+          latencies_.push_back(item.wait_ms + call->latency_ms);
+
+          if (print_results_ || result_func_) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (print_results_) {
+              print_response_func_(*item.query, *response);
+            }
+            if (result_func_) {
+              result_func_(*item.query, response);
+            }
+          }
         }
       } else {
         std::cout << "RPC failed. Code: " << call->status.error_code() << std::endl;
         std::cout << "  Message: " << call->status.error_message() << std::endl;
         std::cout << "  Details: " << call->status.error_details() << std::endl;
         num_failed_requests_++;
+        if (result_func_) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          for (auto& item : call->queries) {
+            result_func_(*item.query, nullptr);
+          }
+        }
       }
 
-      // Remove the element from the map
+      // Remove the elements from the map
       {
         std::lock_guard<std::mutex> lock(mutex_);
-        curr_tasks_.erase(call->query->GetCorrId());
+        for (auto& item : call->queries) {
+          curr_tasks_.erase(item.query->GetCorrId());
+        }
         num_responses_++;
+        stop_flag = num_responses_ == num_requests_ && done_sending_;
       }
 
       // Once we're complete, deallocate the call object.
       delete call;
-
-      if (num_responses_ == num_requests_ && done_sending_) {
-        stop_flag = true;
-        std::cout << "Done processing " << num_responses_ << " responses" << std::endl;
-      }
     }
+    std::cout << "Done processing " << num_responses_ << " responses" << std::endl;
   }
 
  private:
-  // struct for keeping state and data information
-  struct AsyncClientCall {
-    // Container for the data we expect from the server.
-    T_Response response;
+  struct PendingQuery {
+    std::unique_ptr<T_Query> query;
+    std::chrono::steady_clock::time_point enqueue_time;
+    // Time between the query being queued and its batch being sent
+    double wait_ms = 0.;
+  };
 
-    // Context for the client. It could be used to convey extra information to
-    // the server and/or tweak certain RPC behaviors.
-    grpc::ClientContext context;
+  // struct for keeping state and data information. The response and status of the RPC are the
+  // ones of the attempt that answered.
+  struct AsyncClientCall : public riva::clients::HedgedCall<T_Response> {
+    // Kept for the hedges and retries
+    T_Request request;
 
-    // Storage for the status of the RPC upon completion.
-    grpc::Status status;
+    // Queries packed in the request, in the order of its items
+    std::vector<PendingQuery> queries;
+  };
 
-    std::unique_ptr<grpc::ClientAsyncResponseReader<T_Response>> response_reader;
+  // Assembles the payload of a batch of queries and sends it to the server.
+  void Send(std::vector<PendingQuery> batch)
+  {
+    // Data we are sending to the server.
+    T_Request request;
+    auto now = std::chrono::steady_clock::now();
+    for (auto& item : batch) {
+      item.wait_ms = std::chrono::duration<double, std::milli>(now - item.enqueue_time).count();
+      fill_request_func_(*item.query, request);
+    }
 
-    std::unique_ptr<T_Query> query;
-    std::chrono::time_point<std::chrono::steady_clock> start_time;
-  };
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      num_requests_++;
+    }
+
+    // Call object to store rpc data
+    AsyncClientCall* call = new AsyncClientCall;
+
+    call->queries = std::move(batch);
+    call->request = std::move(request);
+
+    // Every attempt of the call, hedge or retry, sends the same request
+    call->Start(
+        hedging_.get(), &cq_,
+        [this, call](grpc::ClientContext* context, grpc::CompletionQueue* cq, int32_t attempt) {
+          return prepare_func_(context, call->request, cq);
+        });
+  }
+
+  // Sends the pending batch once its oldest query waited max_wait_, until StopFlushing
+  void FlushExpiredBatches()
+  {
+    std::unique_lock<std::mutex> lock(batch_mutex_);
+    while (!stop_flushing_) {
+      if (pending_.empty()) {
+        batch_cv_.wait(lock);
+        continue;
+      }
+      auto deadline = pending_.front().enqueue_time + max_wait_;
+      if (std::chrono::steady_clock::now() < deadline) {
+        batch_cv_.wait_until(lock, deadline);
+        continue;
+      }
+      std::vector<PendingQuery> batch;
+      batch.swap(pending_);
+      lock.unlock();
+      Send(std::move(batch));
+      lock.lock();
+    }
+  }
+
+  void StopFlushing()
+  {
+    {
+      std::lock_guard<std::mutex> lock(batch_mutex_);
+      stop_flushing_ = true;
+    }
+    batch_cv_.notify_one();
+    if (flush_thread_.joinable()) {
+      flush_thread_.join();
+    }
+  }
 
   // The producer-consumer queue we use to communicate asynchronously with the
   // gRPC runtime.
@@ -203,7 +349,11 @@ class NLPClient {
   PrepareFunc prepare_func_;
   FillRequestFunc fill_request_func_;
   PrintResponseFunc print_response_func_;
+  ExtractItemFunc extract_item_func_;
+  ResultFunc result_func_;
   bool print_results_;
+  std::unique_ptr<riva::clients::HedgingPolicy> hedging_ =
+      std::make_unique<riva::clients::HedgingPolicy>(riva::clients::HedgingPolicy::Options{});
 
   size_t total_sequences_processed_;
   std::vector<double> latencies_;
@@ -213,4 +363,14 @@ class NLPClient {
   uint32_t num_requests_;
   uint32_t num_responses_;
   uint32_t num_failed_requests_;
+  uint32_t num_failed_items_;
+
+  // Batching: queries queued for the next request, sent when it is full or by the flush thread
+  int32_t max_batch_size_ = 1;
+  std::chrono::microseconds max_wait_{0};
+  std::mutex batch_mutex_;
+  std::condition_variable batch_cv_;
+  std::vector<PendingQuery> pending_;
+  bool stop_flushing_ = false;
+  std::thread flush_thread_;
 };
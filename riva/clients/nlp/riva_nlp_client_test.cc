@@ -0,0 +1,204 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "riva_nlp_client.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "riva/clients/utils/test_server.h"
+
+namespace {
+
+class TestQuery {
+ public:
+  TestQuery(const std::string& text, uint32_t corr_id) : text_(text), corr_id_(corr_id) {}
+  uint32_t GetCorrId() const { return corr_id_; }
+  const std::string& GetText() const { return text_; }
+
+ private:
+  std::string text_;
+  uint32_t corr_id_;
+};
+
+using Client =
+    NLPClient<TestQuery, nr_nlp::TextTransformResponse, nr_nlp::TextTransformRequest>;
+
+// Answers every request with its texts in upper case, at most `max_texts` of them
+riva::clients::TestServer::Respond
+UpperCase(int max_texts = 1000)
+{
+  return [max_texts](const grpc::ByteBuffer& buffer) {
+    auto request = riva::clients::ParseMessage<nr_nlp::TextTransformRequest>(buffer);
+    nr_nlp::TextTransformResponse response;
+    for (int i = 0; i < std::min(request.text_size(), max_texts); ++i) {
+      std::string text = request.text(i);
+      std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+        return std::toupper(c);
+      });
+      response.add_text(text);
+    }
+    return riva::clients::SerializeMessage(response);
+  };
+}
+
+// Client of `server` batching up to `batch_size` queries, which records the result of every
+// query, an empty string for the failed ones
+class BatchingTest {
+ public:
+  BatchingTest(riva::clients::TestServer& server, int32_t batch_size, double max_wait_ms)
+      : stub_(nr_nlp::RivaLanguageUnderstanding::NewStub(server.Channel())),
+        client_(
+            [this](
+                grpc::ClientContext* context, const nr_nlp::TextTransformRequest& request,
+                grpc::CompletionQueue* cq) {
+              return stub_->PrepareAsyncPunctuateText(context, request, cq);
+            },
+            [](TestQuery& query, nr_nlp::TextTransformRequest& request) {
+              request.add_text(query.GetText());
+            },
+            [](TestQuery&, nr_nlp::TextTransformResponse&) {}, false)
+  {
+    client_.SetBatching(
+        batch_size, max_wait_ms,
+        [](const nr_nlp::TextTransformResponse& response, size_t index,
+           nr_nlp::TextTransformResponse& item) {
+          if (index >= static_cast<size_t>(response.text_size())) {
+            return false;
+          }
+          item.add_text(response.text(index));
+          return true;
+        });
+    client_.SetResultFunc([this](TestQuery& query, nr_nlp::TextTransformResponse* response) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      results_[query.GetCorrId()] = response ? response->text(0) : "";
+      result_cv_.notify_all();
+    });
+    completion_thread_ = std::thread(&Client::AsyncCompleteRpc, &client_);
+  }
+
+  void Infer(const std::string& text, uint32_t corr_id)
+  {
+    client_.Infer(std::make_unique<TestQuery>(text, corr_id));
+  }
+
+  // Waits for the results of `count` queries
+  bool WaitForResults(size_t count)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return result_cv_.wait_for(
+        lock, std::chrono::seconds(10), [this, count]() { return results_.size() >= count; });
+  }
+
+  // Sends the last batch and waits for every result
+  std::map<uint32_t, std::string> Finish()
+  {
+    client_.DoneSending();
+    completion_thread_.join();
+    return results_;
+  }
+
+  Client& client() { return client_; }
+
+ private:
+  std::unique_ptr<nr_nlp::RivaLanguageUnderstanding::Stub> stub_;
+  Client client_;
+  std::thread completion_thread_;
+  std::mutex mutex_;
+  std::condition_variable result_cv_;
+  std::map<uint32_t, std::string> results_;
+};
+
+riva::clients::TestServer::Behavior
+Ok(int delay_ms = 0)
+{
+  return [delay_ms](int) { return std::make_pair(delay_ms, grpc::StatusCode::OK); };
+}
+
+}  // namespace
+
+TEST(NLPClientBatching, FullBatchesFanOut)
+{
+  riva::clients::TestServer server(Ok(), UpperCase());
+  BatchingTest test(server, 3, 10000.);
+  std::vector<std::string> texts = {"a", "b", "c", "d", "e", "f"};
+  for (uint32_t i = 0; i < texts.size(); ++i) {
+    test.Infer(texts[i], i);
+  }
+  ASSERT_TRUE(test.WaitForResults(texts.size()));
+  auto results = test.Finish();
+
+  // Two full requests, each of their items going back to its query
+  EXPECT_EQ(server.NumCalls(), 2);
+  ASSERT_EQ(results.size(), texts.size());
+  for (uint32_t i = 0; i < texts.size(); ++i) {
+    EXPECT_EQ(results[i], std::string(1, 'A' + i));
+  }
+  EXPECT_EQ(test.client().TotalSequencesProcessed(), texts.size());
+  EXPECT_EQ(test.client().NumFailedItems(), 0U);
+}
+
+TEST(NLPClientBatching, PartialBatchTimeout)
+{
+  riva::clients::TestServer server(Ok(), UpperCase());
+  BatchingTest test(server, 8, 20.);
+  auto start = std::chrono::steady_clock::now();
+  test.Infer("x", 0);
+  test.Infer("y", 1);
+  // Sent by the flush thread once the first query waited 20 ms, without DoneSending
+  ASSERT_TRUE(test.WaitForResults(2));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+  EXPECT_EQ(server.NumCalls(), 1);
+
+  test.Infer("z", 2);
+  auto results = test.Finish();
+  EXPECT_EQ(server.NumCalls(), 2);
+  EXPECT_EQ(results[0], "X");
+  EXPECT_EQ(results[1], "Y");
+  EXPECT_EQ(results[2], "Z");
+}
+
+TEST(NLPClientBatching, DoneSendingFlushesPartialBatch)
+{
+  riva::clients::TestServer server(Ok(), UpperCase());
+  // The flush thread would wait for a minute
+  BatchingTest test(server, 4, 60000.);
+  for (uint32_t i = 0; i < 5; ++i) {
+    test.Infer("q", i);
+  }
+  auto start = std::chrono::steady_clock::now();
+  auto results = test.Finish();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+  EXPECT_EQ(server.NumCalls(), 2);
+  EXPECT_EQ(results.size(), 5U);
+  EXPECT_EQ(results[4], "Q");
+}
+
+TEST(NLPClientBatching, ShortResponseFailsMissingItems)
+{
+  // Only the first text of each request is answered
+  riva::clients::TestServer server(Ok(), UpperCase(1));
+  BatchingTest test(server, 3, 10000.);
+  test.Infer("a", 0);
+  test.Infer("b", 1);
+  test.Infer("c", 2);
+  ASSERT_TRUE(test.WaitForResults(3));
+  auto results = test.Finish();
+  EXPECT_EQ(results[0], "A");
+  EXPECT_EQ(results[1], "");
+  EXPECT_EQ(results[2], "");
+  EXPECT_EQ(test.client().NumFailedItems(), 2U);
+  EXPECT_EQ(test.client().NumFailedRequests(), 0U);
+  EXPECT_EQ(test.client().TotalSequencesProcessed(), 1U);
+}
@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <grpcpp/grpcpp.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nlp_perf.h"
+#include "riva_nlp_client.h"
+
+namespace nr = nvidia::riva;
+namespace nr_nlp = nvidia::riva::nlp;
+
+DEFINE_string(
+    contexts, "",
+    "Path to a file with one context per line, the question of the same line of --queries being "
+    "asked about it");
+DEFINE_int32(top_n, 1, "Number of answers returned for each question");
+
+class QAQuery : public Query {
+ public:
+  QAQuery(const std::string& question, const std::string& context, uint32_t _corr_id)
+      : Query(_corr_id), question_(question), context_(context)
+  {
+  }
+  const std::string& GetQuestion() const { return question_; }
+  const std::string& GetContext() const { return context_; }
+
+ private:
+  std::string question_;
+  std::string context_;
+};
+
+// Answers with their scores
+std::string
+FormatAnswers(const nr_nlp::NaturalQueryResponse& response)
+{
+  std::stringstream ss;
+  for (auto& result : response.results()) {
+    if (ss.tellp() > 0) {
+      ss << ", ";
+    }
+    ss << "\"" << result.answer() << "\" " << result.score();
+  }
+  return ss.str();
+}
+
+int
+main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_logtostderr = 1;
+
+  std::stringstream str_usage;
+  str_usage << "           --contexts=<filename> " << std::endl;
+  str_usage << "           --top_n=<integer> " << std::endl;
+  NLPPerfOptions options;
+  if (!ParseNLPPerfFlags(argc, argv, "riva_nlp_qa", str_usage.str(), options)) {
+    return 1;
+  }
+  if (FLAGS_top_n < 1) {
+    std::cerr << "top_n must be greater than or equal to 1." << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> questions;
+  std::vector<std::string> contexts;
+  if (!LoadStringData(questions, options.queries) || !LoadStringData(contexts, FLAGS_contexts)) {
+    return 1;
+  }
+  if (questions.size() != contexts.size()) {
+    std::cerr << "The files of queries and contexts must have as many lines, got "
+              << questions.size() << " and " << contexts.size() << std::endl;
+    return 1;
+  }
+
+  auto grpc_channel = CreateNLPPerfChannel();
+  if (!grpc_channel) {
+    return 1;
+  }
+  auto stub = nr_nlp::RivaLanguageUnderstanding::NewStub(grpc_channel);
+
+  auto prepare_func = [&stub](
+      grpc::ClientContext * context, const nr_nlp::NaturalQueryRequest& request,
+      grpc::CompletionQueue* cq) -> auto
+  {
+    return std::move(stub->PrepareAsyncNaturalQuery(context, request, cq));
+  };
+
+  // One question per request, the service has no batched form
+  auto fill_request_func = [](QAQuery& query, nr_nlp::NaturalQueryRequest& request) -> void {
+    request.set_query(query.GetQuestion());
+    request.set_context(query.GetContext());
+    request.set_top_n(FLAGS_top_n);
+  };
+
+  return RunNLPPerf<QAQuery, nr_nlp::NaturalQueryResponse, nr_nlp::NaturalQueryRequest>(
+      options, prepare_func, fill_request_func, nullptr, "Answers", FormatAnswers,
+      questions.size(), [&](size_t input, uint32_t corr_id) {
+        return std::make_unique<QAQuery>(questions[input], contexts[input], corr_id);
+      });
+}
@@ -77,7 +77,10 @@ DEFINE_bool(
     use_ssl, false,
     "Whether to use SSL credentials or not. If ssl_root_cert is specified, "
     "this is assumed to be true");
-DEFINE_string(metadata, "", "Comma separated key-value pair(s) of metadata to be sent to server");
+DEFINE_string(
+    metadata, "",
+    "Comma separated key-value pair(s) of metadata to be sent to server, or @<file> to read them "
+    "from a file that is reloaded when it changes");
 DEFINE_string(tts_prosody_rate, "", "Speech rate for TTS output");
 DEFINE_string(tts_prosody_pitch, "", "Speech pitch for TTS output");
 DEFINE_string(tts_prosody_volume, "", "Speech volume for TTS output");
@@ -233,7 +236,7 @@ main(int argc, char** argv)
   str_usage << "           --tts_audio_file=<filename>" << std::endl;
   str_usage << "           --tts_sample_rate=<rate hz>" << std::endl;
   str_usage << "           --tts_voice_name=<voice name>" << std::endl;
-  str_usage << "           --metadata=<key,value,...>" << std::endl;
+  str_usage << "           --metadata=<key,value,...|@filename>" << std::endl;
   str_usage << "           --tts_prosody_rate=<output speech rate>" << std::endl;
   str_usage << "           --tts_prosody_pitch=<output speech pitch>" << std::endl;
   str_usage << "           --tts_prosody_volume=<output speech volume>" << std::endl;
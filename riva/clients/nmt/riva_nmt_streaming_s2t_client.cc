@@ -71,7 +71,10 @@ DEFINE_bool(
     use_ssl, false,
     "Whether to use SSL credentials or not. If ssl_root_cert is specified, "
     "this is assumed to be true");
-DEFINE_string(metadata, "", "Comma separated key-value pair(s) of metadata to be sent to server");
+DEFINE_string(
+    metadata, "",
+    "Comma separated key-value pair(s) of metadata to be sent to server, or @<file> to read them "
+    "from a file that is reloaded when it changes");
 
 void
 signal_handler(int signal_num)
@@ -116,7 +119,7 @@ main(int argc, char** argv)
   str_usage << "           --ssl_client_key=<filename>" << std::endl;
   str_usage << "           --ssl_client_cert=<filename>" << std::endl;
   str_usage << "           --nmt_text_file=<filename>" << std::endl;
-  str_usage << "           --metadata=<key,value,...>" << std::endl;
+  str_usage << "           --metadata=<key,value,...|@filename>" << std::endl;
 
   gflags::SetUsageMessage(str_usage.str());
   gflags::SetVersionString(::riva::utils::kBuildScmRevision);
@@ -9,16 +9,31 @@
 #include <grpcpp/grpcpp.h>
 #include <strings.h>
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <mutex>
-#include <queue>
-#include <regex>
-#include <thread>
+#include <numeric>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
 
+#include "riva/clients/utils/capacity_search.h"
+#include "riva/clients/utils/compression_stats.h"
 #include "riva/clients/utils/grpc.h"
+#include "riva/clients/utils/hedging.h"
+#include "riva/clients/utils/length_batching.h"
+#include "riva/clients/utils/sentence_splitter.h"
+#include "riva/clients/utils/sla.h"
 #include "riva/proto/riva_nmt.grpc.pb.h"
 #include "riva/utils/files/files.h"
+#include "riva/utils/phrases/phrases.h"
+#include "riva/utils/reorder_buffer.h"
+#include "riva/utils/stats/latency_histogram.h"
+#include "translate_text_client.h"
+#include "translation_cache.h"
 using grpc::Status;
 using grpc::StatusCode;
 
@@ -29,80 +44,99 @@ DEFINE_string(
     text_file, "", "Text file with list of sentences to be TRANSLATED. Ignored if 'text' is set.");
 DEFINE_string(riva_uri, "localhost:50051", "Riva API server URI and port");
 DEFINE_string(text, "", "Text to translate");
+DEFINE_string(
+    output_file, "",
+    "Translate text_file into this file, one line per input line, streaming: the input is read "
+    "as it is sent and translations are written in input order as they complete, so that memory "
+    "use does not depend on the size of the file");
+DEFINE_int64(
+    stream_window, 100000,
+    "Maximum number of lines read but not written yet when streaming to output_file");
 DEFINE_string(source_language_code, "en-US", "Language code for the input text");
 DEFINE_string(target_language_code, "en-US", "Language code for the output text");
 DEFINE_string(model_name, "", "Model to use");
 DEFINE_bool(list_models, false, "List available models on server");
 DEFINE_int32(num_iterations, 1, "Number of times to loop over text");
 DEFINE_int32(num_parallel_requests, 1, "Number of parallel requests");
+DEFINE_int32(
+    num_completion_threads, 1,
+    "Number of threads processing the responses, each keeping many requests in flight");
 DEFINE_string(ssl_root_cert, "", "Path to SSL root certificates file");
 DEFINE_string(ssl_client_key, "", "Path to SSL client certificates key");
 DEFINE_string(ssl_client_cert, "", "Path to SSL client certificates file");
 DEFINE_int32(batch_size, 8, "Batch size to use");
+DEFINE_string(
+    batching, "input_order",
+    "How lines are grouped into requests: input_order, or length_sorted to batch lines of "
+    "similar token counts together and reduce the padding computed by the server");
+DEFINE_int32(
+    split_sentences_min_words, 0,
+    "Lines of more words than this are split into sentences, translated in parallel and put "
+    "back together. 0 to send every line as a single text");
+DEFINE_int64(
+    max_batch_tokens, 0,
+    "Maximum number of tokens of a request once padded to its longest line, 0 for no limit");
+DEFINE_int64(
+    translation_cache_size, 0,
+    "Number of translations kept in a client-side LRU cache: cached lines and repeats of a line "
+    "already in flight are not sent to the server. 0 to disable");
+DEFINE_string(
+    translation_cache_file, "",
+    "File the translation cache is loaded from, if it exists, and saved to at exit");
+DEFINE_double(
+    sla_ms, 0.,
+    "Latency SLA of a request: requests get it as deadline, are cancelled past it and the goodput "
+    "within it is reported. 0 for no deadline");
+DEFINE_int32(
+    max_attempts, 1, "Maximum number of attempts per request, counting hedges and retries");
+DEFINE_double(
+    hedge_delay_ms, 0.,
+    "Delay after which another attempt is sent if a request got no answer, 0 to only retry");
+DEFINE_double(
+    hedge_percentile, 0.,
+    "Percentile of the observed latencies used as hedge delay, hedge_delay_ms being used until "
+    "enough requests completed");
+DEFINE_double(
+    retry_budget, 0.1, "Maximum ratio of hedges and retries to requests, on top of a few extra");
+DEFINE_string(compression, "none", "Compression of the requests: none, gzip or deflate");
+DEFINE_int32(
+    compression_min_bytes, 0, "Requests smaller than this many bytes are sent uncompressed");
+DEFINE_bool(
+    compression_report, false,
+    "Report estimated wire bytes and client CPU time (adds the cost of compressing every message "
+    "once more, excluded from the reported CPU time)");
 DEFINE_bool(
     use_ssl, false,
     "Whether to use SSL credentials or not. If ssl_root_cert is specified, "
     "this is assumed to be true");
-DEFINE_string(metadata, "", "Comma separated key-value pair(s) of metadata to be sent to server");
+DEFINE_string(
+    metadata, "",
+    "Comma separated key-value pair(s) of metadata to be sent to server, or @<file> to read them "
+    "from a file that is reloaded when it changes");
+DEFINE_double(
+    capacity_slo_ms, 0.,
+    "Search the highest number of parallel requests at which the capacity_percentile latency "
+    "stays under this SLO, instead of running at num_parallel_requests. 0 to disable");
+DEFINE_double(capacity_percentile, 99., "Latency percentile the capacity search holds to the SLO");
+DEFINE_int32(max_concurrency, 256, "Highest number of parallel requests the capacity search tries");
+DEFINE_int32(
+    capacity_warmup_runs, 1, "Unmeasured runs at each level of the capacity search before it");
 DEFINE_string(
     dnt_phrases_file, "",
     "File with a list of words to be custom translated. Word and translation in a line.");
+DEFINE_bool(
+    prune_dnt_phrases, false,
+    "Send each request only the DNT phrases occurring in its texts, ignoring case, instead of "
+    "all of them");
+DEFINE_bool(
+    dictionary_cache, false,
+    "Keep the parsed DNT phrases in <file>.cache, reused while the file is unchanged");
 DEFINE_string(
     max_len_variation, "",
     "Parameter to control the maximum variation between the length of source and translated text in terms of tokens.");
 
 int
-translateBatch(
-    std::unique_ptr<nr_nmt::RivaTranslation::Stub> nmt,
-    std::queue<std::vector<std::pair<int, std::string>>>& work,
-    const std::string target_language_code, const std::string source_language_code,
-    const std::string model_name, std::mutex& mtx, std::vector<double>& latencies, std::mutex& lmtx,
-    std::vector<nr_nmt::TranslateTextResponse>& responses, std::string& dnt_phrases)
-{
-  while (1) {
-    std::vector<std::pair<int, std::string>> pairs;
-    {
-      std::lock_guard<std::mutex> guard(mtx);
-      if (work.empty()) {
-        return 1;
-      }
-      pairs = work.front();
-      work.pop();
-    }
-
-    std::vector<std::string> text;
-    for (auto it = pairs.begin(); it != pairs.end(); ++it) {
-      text.push_back(it->second);
-    }
-    grpc::ClientContext context;
-    nr_nmt::TranslateTextRequest request;
-    nr_nmt::TranslateTextResponse response;
-
-    request.set_model(model_name);
-    request.set_source_language(source_language_code);
-    request.set_target_language(target_language_code);
-    *request.mutable_texts() = {text.begin(), text.end()};
-    request.add_dnt_phrases(dnt_phrases);
-    request.set_max_len_variation(FLAGS_max_len_variation);
-    // std::cout << request.DebugString() << std::endl;
-
-    auto start = std::chrono::steady_clock::now();
-    grpc::Status rpc_status = nmt->TranslateText(&context, request, &response);
-    if (!rpc_status.ok()) {
-      LOG(ERROR) << rpc_status.error_message();
-    }
-    responses.push_back(response);
-    auto end = std::chrono::steady_clock::now();
-    std::chrono::duration<double> duration = end - start;
-    {
-      std::lock_guard<std::mutex> lguard(lmtx);
-      latencies.push_back(duration.count());
-    }
-  }
-}
-
-int
-countWords(const std::string& text)
+countWords(std::string_view text)
 {
   int wordCount = 0;
   bool wasSpace = true;
@@ -127,46 +161,215 @@ ReadDntPhrasesFile(const std::string& dnt_phrases_file)
 {
   std::string dnt_phrases_string;
   if (!dnt_phrases_file.empty()) {
-    std::ifstream infile(dnt_phrases_file);
+    auto dnt_phrases = riva::utils::phrases::Load(
+        dnt_phrases_file, riva::utils::phrases::Format::kDntPhrases, FLAGS_dictionary_cache);
+    for (auto& entry : dnt_phrases->entries) {
+      // Append the key-value pair to the dictionary string
+      if (!dnt_phrases_string.empty()) {
+        dnt_phrases_string += ",";
+      }
+      dnt_phrases_string += entry.key + "##" + entry.value;
+    }
+  }
+  return dnt_phrases_string;
+}
 
-    if (infile.is_open()) {
-      std::string line;
+// Key of the translation of `text` in the translation cache. The DNT phrases and the length
+// variation change the translations too.
+uint64_t
+LineCacheKey(const std::string& dnt_phrases, const std::string& text)
+{
+  return TranslationCacheKey(
+      FLAGS_source_language_code, FLAGS_target_language_code, FLAGS_model_name,
+      dnt_phrases + '\0' + FLAGS_max_len_variation, text);
+}
 
-      while (std::getline(infile, line)) {
-        // Trim leading and trailing whitespaces
-        line = std::regex_replace(line, std::regex("^ +| +$"), "");
+// Texts a line is translated as: the line itself, or its sentences if it has more than
+// split_sentences_min_words words
+std::vector<riva::clients::Sentence>
+SplitLine(std::string_view line, int32_t num_words)
+{
+  if (FLAGS_split_sentences_min_words > 0 && num_words > FLAGS_split_sentences_min_words) {
+    auto sentences = riva::clients::SplitSentences(line);
+    if (!sentences.empty()) {
+      return sentences;
+    }
+  }
+  return {{line, std::string_view()}};
+}
 
-        if (!line.empty()) {
-          size_t pos = line.find("##");
-          std::string key, value;
+// Translates text_file into output_file with memory bounded by stream_window: lines are read a
+// chunk at a time, only once the texts before them leave room in the window, and are written
+// in input order as soon as all the earlier ones are. Empty lines, and lines whose request
+// failed, are written as empty lines so that the output stays aligned with the input; a
+// failed sentence of a split line is left out of it. Returns false if a file could not be
+// opened.
+bool
+TranslateFileStreaming(
+    std::shared_ptr<grpc::Channel> channel, const std::string& dnt_phrases,
+    riva::clients::BatchingMode batching, grpc_compression_algorithm compression,
+    riva::clients::CompressionStats* compression_stats, riva::clients::HedgingPolicy& hedging,
+    riva::clients::SlaTracker& sla, TranslationCache* cache,
+    riva::utils::phrases::DictionaryPruner* dnt_pruner, double* run_time)
+{
+  std::ifstream input(FLAGS_text_file);
+  if (input.fail()) {
+    LOG(ERROR) << FLAGS_text_file << " failed to load, please check file";
+    return false;
+  }
+  std::ofstream output(FLAGS_output_file, std::ios::trunc);
+  if (output.fail()) {
+    LOG(ERROR) << "Could not open " << FLAGS_output_file;
+    return false;
+  }
 
-          if (pos != std::string::npos) {
-            // Line contains "##"
-            key = line.substr(0, pos);
-            value = line.substr(pos + 2);
+  auto start = std::chrono::steady_clock::now();
+  std::mutex lmtx;  // latencies
+  riva::utils::stats::LatencyHistogram latencies{};
+  std::atomic<int64_t> failed_lines{0};
+  // Separator following each text of the window in its line, and whether it ends its line,
+  // by text index modulo the window: texts only enter the window once the one at the same slot
+  // is written
+  std::vector<std::string> separators(FLAGS_stream_window);
+  std::vector<char> ends_line(FLAGS_stream_window);
+  riva::utils::ReorderBuffer<std::string> writer(
+      FLAGS_stream_window, [&](uint64_t id, std::string& translation) {
+        size_t slot = id % FLAGS_stream_window;
+        output << translation << separators[slot];
+        if (ends_line[slot]) {
+          output << '\n';
+        }
+      });
+
+  TranslateTextClient client(
+      channel, FLAGS_source_language_code, FLAGS_target_language_code, FLAGS_model_name,
+      dnt_phrases, FLAGS_max_len_variation, hedging, sla);
+  client.SetCompression(compression, FLAGS_compression_min_bytes, compression_stats);
+  client.SetDntPhrasePruner(dnt_pruner);
+  client.Start(
+      FLAGS_num_completion_threads, FLAGS_num_parallel_requests,
+      [&](TranslationBatch& batch, const grpc::Status& status,
+          nr_nmt::TranslateTextResponse& response, double latency_ms) {
+        {
+          std::lock_guard<std::mutex> lguard(lmtx);
+          latencies.Record(latency_ms);
+        }
+        for (size_t i = 0; i < batch.ids.size(); i++) {
+          std::string translation;
+          if (status.ok() && static_cast<int>(i) < response.translations_size()) {
+            translation = std::move(*response.mutable_translations(i)->mutable_text());
+            if (cache) {
+              cache->Insert(LineCacheKey(dnt_phrases, batch.texts[i]), translation);
+            }
           } else {
-            // Line doesn't contain "##"
-            key = line;
-            value = "";
-          }
-
-          // Trim key and value
-          key = std::regex_replace(key, std::regex("^ +| +$"), "");
-          value = std::regex_replace(value, std::regex("^ +| +$"), "");
-
-          // Append the key-value pair to the dictionary string
-          if (!dnt_phrases_string.empty()) {
-            dnt_phrases_string += ",";
+            failed_lines++;
           }
-          dnt_phrases_string += key + "##" + value;
+          writer.Push(batch.ids[i], std::move(translation));
         }
+      });
+
+  // Texts read at once and batched together, so that length sorting has texts to choose from
+  int64_t chunk_size = std::min<int64_t>(
+      FLAGS_stream_window, static_cast<int64_t>(FLAGS_batch_size) * FLAGS_num_parallel_requests);
+  int64_t num_lines = 0, num_texts = 0, total_words = 0, cache_hits = 0, saved_tokens = 0;
+  size_t request_count = 0;
+  riva::clients::PaddingStats padding;
+  // Texts of the chunk, and their separators and ends of line until they enter the window
+  std::vector<std::string> chunk;
+  std::vector<std::string> chunk_separators;
+  std::vector<char> chunk_ends_line;
+  std::string line;
+  while (true) {
+    chunk.clear();
+    chunk_separators.clear();
+    chunk_ends_line.clear();
+    while (static_cast<int64_t>(chunk.size()) < chunk_size && std::getline(input, line)) {
+      num_lines++;
+      auto sentences = SplitLine(line, countWords(line));
+      // A line must fit in the window to be written
+      if (static_cast<int64_t>(chunk.size() + sentences.size()) > FLAGS_stream_window) {
+        sentences = {{line, std::string_view()}};
       }
-    } else {
-      std::string err = "Could not open file " + dnt_phrases_file;
-      throw std::runtime_error(err);
+      for (auto& sentence : sentences) {
+        chunk.emplace_back(sentence.text);
+        chunk_separators.emplace_back(sentence.separator);
+        chunk_ends_line.push_back(false);
+      }
+      chunk_ends_line.back() = true;
+    }
+    if (chunk.empty()) {
+      break;
+    }
+    int64_t first_id = num_texts;
+    num_texts += chunk.size();
+    writer.WaitForSlot(num_texts - 1);
+
+    std::vector<int64_t> ids;
+    std::vector<int32_t> lengths;
+    for (size_t i = 0; i < chunk.size(); i++) {
+      int64_t id = first_id + i;
+      separators[id % FLAGS_stream_window] = std::move(chunk_separators[i]);
+      ends_line[id % FLAGS_stream_window] = chunk_ends_line[i];
+      int32_t length = countWords(chunk[i]);
+      total_words += length;
+      std::string translation;
+      if (chunk[i].empty()) {
+        writer.Push(id, std::move(translation));
+      } else if (cache && cache->Lookup(LineCacheKey(dnt_phrases, chunk[i]), &translation)) {
+        cache_hits++;
+        saved_tokens += length;
+        writer.Push(id, std::move(translation));
+      } else {
+        ids.push_back(id);
+        lengths.push_back(length);
+      }
+    }
+
+    auto batches = riva::clients::MakeLengthBatches(
+        lengths, batching, FLAGS_batch_size, FLAGS_max_batch_tokens);
+    auto chunk_padding = riva::clients::ComputePadding(lengths, batches);
+    padding.tokens += chunk_padding.tokens;
+    padding.padded_tokens += chunk_padding.padded_tokens;
+    for (auto& indices : batches) {
+      TranslationBatch batch;
+      for (size_t index : indices) {
+        batch.ids.push_back(ids[index]);
+        batch.texts.push_back(std::move(chunk[ids[index] - first_id]));
+      }
+      client.Translate(std::move(batch));
+      request_count++;
     }
   }
-  return dnt_phrases_string;
+  client.Stop();
+  output.flush();
+
+  std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+  *run_time += total.count();
+  LOG(INFO) << FLAGS_model_name << "-" << FLAGS_batch_size << "-" << FLAGS_source_language_code
+            << "-" << FLAGS_target_language_code << ",lines: " << num_lines
+            << ",texts: " << num_texts << ",tokens: " << total_words
+            << ",total time: " << total.count()
+            << ",lines/second: " << num_lines / total.count()
+            << ",requests/second: " << request_count / total.count()
+            << ",tokens/second: " << total_words / total.count()
+            << ",padded tokens/second: " << padding.padded_tokens / total.count();
+  LOG(INFO) << "Batching " << FLAGS_batching << ",padding efficiency: " << padding.Efficiency();
+  LOG(INFO) << "P90: " << latencies.Percentile(90.) / 1000.
+            << ",P95: " << latencies.Percentile(95.) / 1000.
+            << ",P99: " << latencies.Percentile(99.) / 1000.;
+  if (cache) {
+    LOG(INFO) << "Translation cache hits: " << cache_hits << " of " << num_texts
+              << " texts,server tokens saved: " << saved_tokens << " of " << total_words
+              << ",cached translations: " << cache->Size();
+  }
+  if (failed_lines > 0) {
+    LOG(WARNING) << failed_lines << " texts failed to translate and were written empty";
+  }
+  if (output.fail()) {
+    LOG(ERROR) << "Could not write " << FLAGS_output_file;
+    return false;
+  }
+  return true;
 }
 
 int
@@ -178,10 +381,30 @@ main(int argc, char** argv)
   std::stringstream str_usage;
   str_usage << "Usage: riva_nmt_t2t_client" << std::endl;
   str_usage << "           --text_file=<filename> " << std::endl;
+  str_usage << "           --output_file=<filename> " << std::endl;
+  str_usage << "           --stream_window=<integer> " << std::endl;
   str_usage << "           --riva_uri=<server_name:port> " << std::endl;
   str_usage << "           --num_iterations=<integer> " << std::endl;
   str_usage << "           --num_parallel_requests=<integer> " << std::endl;
+  str_usage << "           --num_completion_threads=<integer> " << std::endl;
   str_usage << "           --batch_size=<integer> " << std::endl;
+  str_usage << "           --batching=<input_order|length_sorted> " << std::endl;
+  str_usage << "           --max_batch_tokens=<integer> " << std::endl;
+  str_usage << "           --split_sentences_min_words=<integer> " << std::endl;
+  str_usage << "           --translation_cache_size=<integer> " << std::endl;
+  str_usage << "           --translation_cache_file=<filename> " << std::endl;
+  str_usage << "           --sla_ms=<float> " << std::endl;
+  str_usage << "           --capacity_slo_ms=<float> " << std::endl;
+  str_usage << "           --capacity_percentile=<float> " << std::endl;
+  str_usage << "           --max_concurrency=<integer> " << std::endl;
+  str_usage << "           --capacity_warmup_runs=<integer> " << std::endl;
+  str_usage << "           --max_attempts=<integer> " << std::endl;
+  str_usage << "           --hedge_delay_ms=<float> " << std::endl;
+  str_usage << "           --hedge_percentile=<float> " << std::endl;
+  str_usage << "           --retry_budget=<float> " << std::endl;
+  str_usage << "           --compression=<none|gzip|deflate> " << std::endl;
+  str_usage << "           --compression_min_bytes=<integer> " << std::endl;
+  str_usage << "           --compression_report=<true|false> " << std::endl;
   str_usage << "           --ssl_root_cert=<filename>" << std::endl;
   str_usage << "           --ssl_client_key=<filename>" << std::endl;
   str_usage << "           --ssl_client_cert=<filename>" << std::endl;
@@ -192,8 +415,10 @@ main(int argc, char** argv)
             << std::endl;
   str_usage << "           --model_name=<model>" << std::endl;
   str_usage << "           --list_models" << std::endl;
-  str_usage << "           --metadata=<key,value,...>" << std::endl;
+  str_usage << "           --metadata=<key,value,...|@filename>" << std::endl;
   str_usage << "           --dnt_phrases_file=<string>" << std::endl;
+  str_usage << "           --prune_dnt_phrases=<true|false>" << std::endl;
+  str_usage << "           --dictionary_cache=<true|false>" << std::endl;
   str_usage << "           --max_len_variation=<string>" << std::endl;
   gflags::SetUsageMessage(str_usage.str());
 
@@ -225,6 +450,48 @@ main(int argc, char** argv)
     return 1;
   }
 
+  if (FLAGS_num_completion_threads <= 0) {
+    LOG(ERROR) << "Invalid num completion threads: " << FLAGS_num_completion_threads;
+    return 1;
+  }
+
+  if (FLAGS_capacity_slo_ms < 0. || FLAGS_capacity_percentile < 0. ||
+      FLAGS_capacity_percentile > 100. || FLAGS_max_concurrency <= 0 ||
+      FLAGS_capacity_warmup_runs < 0) {
+    LOG(ERROR) << "Invalid capacity search: SLO " << FLAGS_capacity_slo_ms << " ms, percentile "
+               << FLAGS_capacity_percentile << ", max concurrency " << FLAGS_max_concurrency
+               << ", warm-up runs " << FLAGS_capacity_warmup_runs;
+    return 1;
+  }
+
+  if (FLAGS_max_attempts <= 0 || FLAGS_hedge_percentile < 0. || FLAGS_hedge_percentile > 100.) {
+    LOG(ERROR) << "Invalid max attempts or hedge percentile: " << FLAGS_max_attempts << ", "
+               << FLAGS_hedge_percentile;
+    return 1;
+  }
+
+  if (FLAGS_translation_cache_size < 0 ||
+      (!FLAGS_translation_cache_file.empty() && FLAGS_translation_cache_size == 0)) {
+    LOG(ERROR) << "Invalid translation cache size: " << FLAGS_translation_cache_size
+               << ", a cache file requires a cache size";
+    return 1;
+  }
+
+  // After the first warm-up run the cache would answer every line, and the measured runs would
+  // send no request
+  if (FLAGS_capacity_slo_ms > 0. && FLAGS_translation_cache_size > 0) {
+    LOG(ERROR) << "capacity_slo_ms requires translation_cache_size=0";
+    return 1;
+  }
+
+  if (!FLAGS_output_file.empty() &&
+      (FLAGS_text_file.empty() || !FLAGS_text.empty() || FLAGS_num_iterations != 1 ||
+       FLAGS_capacity_slo_ms > 0. || FLAGS_stream_window <= 0)) {
+    LOG(ERROR) << "output_file requires text_file, a single iteration, no capacity search and a "
+                  "positive stream_window";
+    return 1;
+  }
+
   bool flag_set = gflags::GetCommandLineFlagInfoOrDie("riva_uri").is_default;
   const char* riva_uri = getenv("RIVA_URI");
 
@@ -233,11 +500,23 @@ main(int argc, char** argv)
     FLAGS_riva_uri = riva_uri;
   }
 
+  grpc_compression_algorithm compression;
+  riva::clients::BatchingMode batching;
+  try {
+    compression = riva::clients::ParseCompressionAlgorithm(FLAGS_compression);
+    batching = riva::clients::ParseBatchingMode(FLAGS_batching);
+  }
+  catch (const std::exception& e) {
+    LOG(ERROR) << e.what();
+    return 1;
+  }
+
   std::shared_ptr<grpc::Channel> grpc_channel;
   try {
     auto creds =
         riva::clients::CreateChannelCredentials(FLAGS_use_ssl, FLAGS_ssl_root_cert, FLAGS_ssl_client_key, FLAGS_ssl_client_cert, FLAGS_metadata);
-    grpc_channel = riva::clients::CreateChannelBlocking(FLAGS_riva_uri, creds);
+    grpc_channel = riva::clients::CreateChannelBlocking(
+        FLAGS_riva_uri, creds, 10000, MAX_GRPC_MESSAGE_SIZE, compression);
   }
   catch (const std::exception& e) {
     std::cerr << "Error creating GRPC channel: " << e.what() << std::endl;
@@ -261,6 +540,16 @@ main(int argc, char** argv)
   }
 
   std::string dnt_phrases = ReadDntPhrasesFile(FLAGS_dnt_phrases_file);
+  // Matches the DNT phrases in the texts, built once as it is the costly part
+  std::unique_ptr<riva::utils::phrases::DictionaryPruner> dnt_pruner;
+  if (FLAGS_prune_dnt_phrases && !FLAGS_dnt_phrases_file.empty()) {
+    dnt_pruner = std::make_unique<riva::utils::phrases::DictionaryPruner>(
+        riva::utils::phrases::Load(
+            FLAGS_dnt_phrases_file, riva::utils::phrases::Format::kDntPhrases,
+            FLAGS_dictionary_cache)
+            ->entries,
+        "##");
+  }
 
   if (FLAGS_text != "") {
     nr_nmt::TranslateTextRequest request;
@@ -271,7 +560,7 @@ main(int argc, char** argv)
     request.set_target_language(FLAGS_target_language_code);
 
     request.add_texts(FLAGS_text);
-    request.add_dnt_phrases(dnt_phrases);
+    request.add_dnt_phrases(dnt_pruner ? dnt_pruner->Prune(FLAGS_text) : dnt_phrases);
     request.set_max_len_variation(FLAGS_max_len_variation);
     grpc::Status rpc_status = nmt->TranslateText(&context, request, &response);
     if (!rpc_status.ok()) {
@@ -290,10 +579,80 @@ main(int argc, char** argv)
      */
     // std::vector<std::vector<std::vector<std::string>>> inputs;
 
+    std::unique_ptr<riva::clients::CompressionStats> compression_stats;
+    if (FLAGS_compression_report) {
+      compression_stats = std::make_unique<riva::clients::CompressionStats>(compression);
+    }
+
+    riva::clients::HedgingPolicy::Options hedging_options;
+    hedging_options.max_attempts = FLAGS_max_attempts;
+    hedging_options.hedge_delay_ms = FLAGS_hedge_delay_ms;
+    hedging_options.hedge_percentile = FLAGS_hedge_percentile;
+    hedging_options.retry_budget = FLAGS_retry_budget;
+    riva::clients::HedgingPolicy hedging(hedging_options);
+    riva::clients::SlaTracker sla(FLAGS_sla_ms);
+
+    std::unique_ptr<TranslationCache> cache;
+    if (FLAGS_translation_cache_size > 0) {
+      cache = std::make_unique<TranslationCache>(FLAGS_translation_cache_size);
+      if (!FLAGS_translation_cache_file.empty()) {
+        try {
+          if (cache->Load(FLAGS_translation_cache_file)) {
+            LOG(INFO) << "Loaded " << cache->Size() << " translations from "
+                      << FLAGS_translation_cache_file;
+          }
+        }
+        catch (const std::exception& e) {
+          LOG(WARNING) << e.what() << ", starting with an empty translation cache";
+        }
+      }
+    }
+
+    // Prints the statistics of the whole run and saves the cache
+    double run_time = 0.;
+    auto finish = [&]() {
+      if (compression_stats) {
+        compression_stats->Print(run_time);
+      }
+      if (FLAGS_max_attempts > 1) {
+        hedging.PrintStats();
+      }
+      if (sla.Enabled()) {
+        sla.Print(run_time, "sentences");
+      }
+      if (dnt_pruner) {
+        dnt_pruner->PrintStats();
+      }
+      if (cache && !FLAGS_translation_cache_file.empty()) {
+        try {
+          cache->Save(FLAGS_translation_cache_file);
+        }
+        catch (const std::exception& e) {
+          LOG(ERROR) << e.what();
+          return 1;
+        }
+      }
+      return 0;
+    };
+
+    if (!FLAGS_output_file.empty()) {
+      if (!TranslateFileStreaming(
+              grpc_channel, dnt_phrases, batching, compression, compression_stats.get(), hedging,
+              sla, cache.get(), dnt_pruner.get(), &run_time)) {
+        return 1;
+      }
+      return finish();
+    }
+
     std::string str;
-    int count = 0, total_words = 0;
-    std::vector<std::pair<int, std::string>> batch;
-    std::vector<std::vector<std::pair<int, std::string>>> all_requests;
+    int count = 0, total_words = 0, num_lines = 0, longest_line = 0;
+    // Texts sent to the server: the lines of the file, or the sentences of the long ones
+    std::vector<std::string> lines;
+    // Whitespace following each text in its line, and whether it is the last text of its line
+    std::vector<std::string> separators;
+    std::vector<bool> ends_line;
+    // Words stand for the tokens of the model
+    std::vector<int32_t> lengths;
     std::ifstream nmt_file(FLAGS_text_file);
     if (nmt_file.fail()) {
       LOG(ERROR) << FLAGS_text_file << " failed to load, please check file " << std::endl;
@@ -301,77 +660,230 @@ main(int argc, char** argv)
     }
 
     while (std::getline(nmt_file, str)) {
-      if ((batch.size() > 0) && ((int)batch.size() == FLAGS_batch_size)) {
-        all_requests.push_back(batch);
-        batch.clear();
-      }
       if (!str.empty()) {
-        total_words += countWords(str);
-        batch.push_back(make_pair(count, str));
-        count++;
+        int32_t length = countWords(str);
+        longest_line = std::max(longest_line, length);
+        num_lines++;
+        for (auto& sentence : SplitLine(str, length)) {
+          lengths.push_back(countWords(sentence.text));
+          total_words += lengths.back();
+          lines.emplace_back(sentence.text);
+          separators.emplace_back(sentence.separator);
+          ends_line.push_back(false);
+          count++;
+        }
+        ends_line.back() = true;
       }
     }
 
-    if (batch.size() > 0) {
-      all_requests.push_back(batch);
-    }
-
-    if (!all_requests.size()) {
+    if (count == 0) {
       LOG(ERROR) << "No text to process";
       return 1;
     }
+    if (FLAGS_split_sentences_min_words > 0) {
+      LOG(INFO) << "Sentence splitting: " << num_lines << " lines sent as " << count
+                << " texts, longest text "
+                << *std::max_element(lengths.begin(), lengths.end())
+                << " words instead of " << longest_line;
+    }
 
-    auto request_count = all_requests.size();
-
-    auto start = std::chrono::steady_clock::now();
-    std::mutex mtx;   // queue
-    std::mutex lmtx;  // latency vector
-    std::vector<double> latencies;
-
-    for (int iters = 0; iters < FLAGS_num_iterations; iters++) {
-      std::queue<std::vector<std::pair<int, std::string>>> request_queue;
-      std::vector<std::thread> workers;
-      std::vector<std::vector<nr_nmt::TranslateTextResponse>> responses(
-          FLAGS_num_parallel_requests);
-
-      for (auto& request : all_requests) {
-        request_queue.push(request);
+    // Groups the given lines into requests. Batches carry the index of their lines, the
+    // translations are put back in input order.
+    auto make_requests = [&](const std::vector<int32_t>& ids) {
+      std::vector<int32_t> id_lengths;
+      for (int32_t id : ids) {
+        id_lengths.push_back(lengths[id]);
       }
-
-      for (int i = 0; i < FLAGS_num_parallel_requests; i++) {
-        workers.push_back(std::thread([&, i]() {
-          std::unique_ptr<nr_nmt::RivaTranslation::Stub> nmt2(
-              nr_nmt::RivaTranslation::NewStub(grpc_channel));
-          translateBatch(
-              std::move(nmt2), request_queue, FLAGS_target_language_code,
-              FLAGS_source_language_code, FLAGS_model_name, mtx, latencies, lmtx, responses.at(i),
-              dnt_phrases);
-        }));
+      std::vector<TranslationBatch> requests;
+      for (auto& indices : riva::clients::MakeLengthBatches(
+               id_lengths, batching, FLAGS_batch_size, FLAGS_max_batch_tokens)) {
+        TranslationBatch batch;
+        for (size_t index : indices) {
+          batch.ids.push_back(ids[index]);
+          batch.texts.push_back(lines[ids[index]]);
+        }
+        requests.push_back(std::move(batch));
+      }
+      return requests;
+    };
+
+    // Cache key of each line
+    std::vector<uint64_t> keys;
+    std::vector<TranslationBatch> all_requests;
+    if (cache) {
+      for (auto& line : lines) {
+        keys.push_back(LineCacheKey(dnt_phrases, line));
       }
+    } else {
+      // Every iteration sends the same requests
+      std::vector<int32_t> ids(count);
+      std::iota(ids.begin(), ids.end(), 0);
+      all_requests = make_requests(ids);
+      lines.clear();
+    }
 
-      std::for_each(workers.begin(), workers.end(), [](std::thread& worker) { worker.join(); });
+    auto padding = riva::clients::ComputePadding(
+        lengths, riva::clients::MakeLengthBatches(
+                     lengths, batching, FLAGS_batch_size, FLAGS_max_batch_tokens));
+    auto input_order_padding = riva::clients::ComputePadding(
+        lengths, riva::clients::MakeLengthBatches(
+                     lengths, riva::clients::BatchingMode::kInputOrder, FLAGS_batch_size,
+                     FLAGS_max_batch_tokens));
+
+    // Translates the file num_iterations times with `concurrency` requests in flight and prints
+    // the translations and statistics of the run, unless it is a warm-up run. Its latencies and
+    // throughput are added to `sample` if not null. Returns false if a request failed.
+    auto run_load = [&](int32_t concurrency, riva::clients::CapacitySample* sample) {
+      bool print = !(sample && sample->warmup);
+      auto start = std::chrono::steady_clock::now();
+      std::mutex lmtx;  // latencies and translations
+      riva::utils::stats::LatencyHistogram latencies{};
+      // Translation of each line of the file, by line index
+      std::vector<std::optional<std::string>> translations(count);
+      size_t request_count = 0;
+      // Lines answered by the cache, and lines repeating a line already sent in the iteration
+      int64_t cache_hits = 0, repeated_lines = 0, saved_tokens = 0;
+
+      TranslateTextClient client(
+          grpc_channel, FLAGS_source_language_code, FLAGS_target_language_code, FLAGS_model_name,
+          dnt_phrases, FLAGS_max_len_variation, hedging, sla);
+      client.SetCompression(compression, FLAGS_compression_min_bytes, compression_stats.get());
+      client.SetDntPhrasePruner(dnt_pruner.get());
+      client.Start(
+          FLAGS_num_completion_threads, concurrency,
+          [&](TranslationBatch& batch, const grpc::Status& status,
+              nr_nmt::TranslateTextResponse& response, double latency_ms) {
+            std::lock_guard<std::mutex> lguard(lmtx);
+            if (!status.ok()) {
+              return;
+            }
+            latencies.Record(latency_ms);
+            int num_translations =
+                std::min<int>(response.translations_size(), batch.ids.size());
+            for (int i = 0; i < num_translations; i++) {
+              auto& text = *response.mutable_translations(i)->mutable_text();
+              if (cache) {
+                cache->Insert(keys[batch.ids[i]], text);
+              }
+              translations[batch.ids[i]] = std::move(text);
+            }
+          });
+
+      for (int iters = 0; iters < FLAGS_num_iterations; iters++) {
+        // Only the lines missing from the cache are sent, each once per iteration
+        std::vector<TranslationBatch> miss_requests;
+        std::vector<std::pair<int32_t, int32_t>> repeats;  // line, line sent with its text
+        if (cache) {
+          std::vector<int32_t> misses;
+          std::unordered_map<uint64_t, int32_t> sent;
+          for (int32_t id = 0; id < count; id++) {
+            std::string translation;
+            if (cache->Lookup(keys[id], &translation)) {
+              translations[id] = std::move(translation);
+              cache_hits++;
+              saved_tokens += lengths[id];
+              continue;
+            }
+            auto inserted = sent.emplace(keys[id], id);
+            if (inserted.second) {
+              misses.push_back(id);
+            } else {
+              repeats.emplace_back(id, inserted.first->second);
+              repeated_lines++;
+              saved_tokens += lengths[id];
+            }
+          }
+          miss_requests = make_requests(misses);
+        }
+        auto& requests = cache ? miss_requests : all_requests;
+        for (auto& request : requests) {
+          client.Translate(request);
+        }
+        request_count += requests.size();
+        client.Drain();
+        for (auto& repeat : repeats) {
+          translations[repeat.first] = translations[repeat.second];
+        }
 
-      for (int i = 0; i < FLAGS_num_parallel_requests; i++) {
-        for (auto response : responses.at(i))
-          for (auto i : response.translations()) {
-            std::cout << i.text() << std::endl;
+        // Lines are printed if all their texts were translated
+        std::string line;
+        bool translated = true;
+        for (int32_t id = 0; id < count; id++) {
+          if (translations[id]) {
+            line += *translations[id] + separators[id];
+            translations[id].reset();
+          } else {
+            translated = false;
+          }
+          if (ends_line[id]) {
+            if (translated && print) {
+              std::cout << line << std::endl;
+            }
+            line.clear();
+            translated = true;
           }
+        }
+      }
+      client.Stop();
+      auto end = std::chrono::steady_clock::now();
+      std::chrono::duration<double> total = end - start;
+      run_time += total.count();
+      if (sample) {
+        sample->latencies.Merge(latencies);
+        sample->throughput = FLAGS_num_iterations * count / total.count();
+      }
+      if (!print) {
+        return client.NumFailedRequests() == 0;
+      }
+      LOG(INFO) << FLAGS_model_name << "-" << FLAGS_batch_size << "-"
+                << FLAGS_source_language_code << "-" << FLAGS_target_language_code
+                << ",lines: " << num_lines << ",texts: " << count
+                << ",tokens: " << total_words << ",total time: " << total.count()
+                << ",lines/second: " << FLAGS_num_iterations * num_lines / total.count()
+                << ",requests/second: " << request_count / total.count()
+                << ",tokens/second: " << FLAGS_num_iterations * total_words / total.count()
+                << ",padded tokens/second: "
+                << FLAGS_num_iterations * padding.padded_tokens / total.count();
+      LOG(INFO) << "Batching " << FLAGS_batching
+                << ",padding efficiency: " << padding.Efficiency()
+                << ",padding efficiency in input order: " << input_order_padding.Efficiency();
+      if (cache) {
+        int64_t lookups = static_cast<int64_t>(FLAGS_num_iterations) * count;
+        LOG(INFO) << "Translation cache hits: " << cache_hits << " of " << lookups
+                  << " texts,hit rate: " << static_cast<double>(cache_hits) / lookups
+                  << ",repeated texts sent once: " << repeated_lines
+                  << ",server tokens saved: " << saved_tokens << " of "
+                  << static_cast<int64_t>(FLAGS_num_iterations) * total_words
+                  << ",cached translations: " << cache->Size();
       }
+
+      // Percentiles are 0 when the cache answers every line and no request is sent
+      LOG(INFO) << "P90: " << latencies.Percentile(90.) / 1000.
+                << ",P95: " << latencies.Percentile(95.) / 1000.
+                << ",P99: " << latencies.Percentile(99.) / 1000.;
+      return client.NumFailedRequests() == 0;
+    };
+
+    if (FLAGS_capacity_slo_ms > 0.) {
+      riva::clients::CapacitySearch::Options capacity_options;
+      capacity_options.slo_ms = FLAGS_capacity_slo_ms;
+      capacity_options.percentile = FLAGS_capacity_percentile;
+      capacity_options.max_concurrency = FLAGS_max_concurrency;
+      capacity_options.warmup_runs = FLAGS_capacity_warmup_runs;
+      riva::clients::CapacitySearch search(capacity_options);
+      int32_t capacity =
+          search.Run([&](int32_t concurrency, riva::clients::CapacitySample& sample) {
+            return run_load(concurrency, &sample);
+          });
+      search.Print(capacity, "sentences/sec");
+      if (capacity < 0) {
+        finish();
+        return 1;
+      }
+    } else {
+      run_load(FLAGS_num_parallel_requests, nullptr);
     }
-    auto end = std::chrono::steady_clock::now();
-    std::chrono::duration<double> total = end - start;
-    LOG(INFO) << FLAGS_model_name << "-" << FLAGS_batch_size << "-" << FLAGS_source_language_code
-              << "-" << FLAGS_target_language_code << ",lines: " << count
-              << ",tokens: " << total_words << ",total time: " << total.count()
-              << ",requests/second: " << FLAGS_num_iterations * request_count / total.count()
-              << ",tokens/second: " << FLAGS_num_iterations * total_words / total.count();
-
-    std::sort(latencies.begin(), latencies.end());
-    auto size = latencies.size();
-
-    LOG(INFO) << "P90: " << latencies[static_cast<int>(0.9 * size)]
-              << ",P95: " << latencies[static_cast<int>(0.95 * size)]
-              << ",P99: " << latencies[static_cast<int>(0.99 * size)];
+    return finish();
   }
 
 
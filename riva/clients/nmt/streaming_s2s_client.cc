@@ -76,6 +76,7 @@ StreamingS2SClient::StreamingS2SClient(
 
   boosted_phrases_ = ReadPhrasesFromFile(boosted_phrases_file);
   dnt_phrases_ = ReadPhrasesFromFile(dnt_phrases_file);
+  BuildConfigPrototype();
 }
 
 StreamingS2SClient::~StreamingS2SClient() {}
@@ -99,6 +100,54 @@ StreamingS2SClient::StartNewStream(std::unique_ptr<Stream> stream)
   thread_pool_->Enqueue(recv_func);
 }
 
+void
+StreamingS2SClient::BuildConfigPrototype()
+{
+  auto streaming_s2s_config = config_prototype_.mutable_config();
+
+  // set nmt config
+  auto translation_config = streaming_s2s_config->mutable_translation_config();
+  translation_config->set_source_language_code(source_language_code_);
+  translation_config->set_target_language_code(target_language_code_);
+  *(translation_config->mutable_dnt_phrases()) = {dnt_phrases_.begin(), dnt_phrases_.end()};
+
+  // set tts config
+  auto tts_config = streaming_s2s_config->mutable_tts_config();
+  if (tts_encoding_.empty() || tts_encoding_ == "pcm") {
+    tts_config->set_encoding(nr::LINEAR_PCM);
+  } else if (tts_encoding_ == "opus") {
+    tts_config->set_encoding(nr::OGGOPUS);
+  }
+  int32_t rate = tts_sample_rate_;
+  if (tts_encoding_ == "opus") {
+    rate = riva::utils::opus::Decoder::AdjustRateIfUnsupported(tts_sample_rate_);
+  }
+  tts_config->set_sample_rate_hz(rate);
+  tts_config->set_voice_name(tts_voice_name_);
+  tts_config->set_language_code(target_language_code_);
+  tts_config->set_prosody_rate(tts_prosody_rate_);
+  tts_config->set_prosody_pitch(tts_prosody_pitch_);
+  tts_config->set_prosody_volume(tts_prosody_volume_);
+
+  // set asr config
+  auto streaming_asr_config = streaming_s2s_config->mutable_asr_config();
+  streaming_asr_config->set_interim_results(false);
+  auto config = streaming_asr_config->mutable_config();
+  config->set_language_code(source_language_code_);
+  config->set_max_alternatives(1);
+  config->set_profanity_filter(profanity_filter_);
+  config->set_enable_word_time_offsets(false);
+  config->set_enable_automatic_punctuation(automatic_punctuation_);
+  config->set_enable_separate_recognition_per_channel(separate_recognition_per_channel_);
+  auto custom_config = config->mutable_custom_configuration();
+  (*custom_config)["test_key"] = "test_value";
+  config->set_verbatim_transcripts(verbatim_transcripts_);
+
+  nr_asr::SpeechContext* speech_context = config->add_speech_contexts();
+  *(speech_context->mutable_phrases()) = {boosted_phrases_.begin(), boosted_phrases_.end()};
+  speech_context->set_boost(boosted_phrases_score_);
+}
+
 void
 StreamingS2SClient::GenerateRequests(std::shared_ptr<S2SClientCall> call)
 {
@@ -110,52 +159,12 @@ StreamingS2SClient::GenerateRequests(std::shared_ptr<S2SClientCall> call)
   while (!done) {
     nr_nmt::StreamingTranslateSpeechToSpeechRequest request;
     if (first_write) {
-      auto streaming_s2s_config = request.mutable_config();
-
-      // set nmt config
-      auto translation_config = streaming_s2s_config->mutable_translation_config();
-      translation_config->set_source_language_code(source_language_code_);
-      translation_config->set_target_language_code(target_language_code_);
-      *(translation_config->mutable_dnt_phrases()) = {dnt_phrases_.begin(), dnt_phrases_.end()};
-
-      // set tts config
-      auto tts_config = streaming_s2s_config->mutable_tts_config();
-      if (tts_encoding_.empty() || tts_encoding_ == "pcm") {
-        tts_config->set_encoding(nr::LINEAR_PCM);
-      } else if (tts_encoding_ == "opus") {
-        tts_config->set_encoding(nr::OGGOPUS);
-      }
-      int32_t rate = tts_sample_rate_;
-      if (tts_encoding_ == "opus") {
-        rate = riva::utils::opus::Decoder::AdjustRateIfUnsupported(tts_sample_rate_);
-      }
-      tts_config->set_sample_rate_hz(rate);
-      tts_config->set_voice_name(tts_voice_name_);
-      tts_config->set_language_code(target_language_code_);
-      tts_config->set_prosody_rate(tts_prosody_rate_);
-      tts_config->set_prosody_pitch(tts_prosody_pitch_);
-      tts_config->set_prosody_volume(tts_prosody_volume_);
-
-      // set asr config
-      auto streaming_asr_config = streaming_s2s_config->mutable_asr_config();
-      streaming_asr_config->set_interim_results(false);
-      auto config = streaming_asr_config->mutable_config();
+      // Only the audio format differs from the prototype
+      request = config_prototype_;
+      auto config = request.mutable_config()->mutable_asr_config()->mutable_config();
       config->set_sample_rate_hertz(call->stream->wav->sample_rate);
-      config->set_language_code(source_language_code_);
       config->set_encoding(call->stream->wav->encoding);
-      config->set_max_alternatives(1);
-      config->set_profanity_filter(profanity_filter_);
       config->set_audio_channel_count(call->stream->wav->channels);
-      config->set_enable_word_time_offsets(false);
-      config->set_enable_automatic_punctuation(automatic_punctuation_);
-      config->set_enable_separate_recognition_per_channel(separate_recognition_per_channel_);
-      auto custom_config = config->mutable_custom_configuration();
-      (*custom_config)["test_key"] = "test_value";
-      config->set_verbatim_transcripts(verbatim_transcripts_);
-
-      nr_asr::SpeechContext* speech_context = config->add_speech_contexts();
-      *(speech_context->mutable_phrases()) = {boosted_phrases_.begin(), boosted_phrases_.end()};
-      speech_context->set_boost(boosted_phrases_score_);
       call->streamer->Write(request);
       first_write = false;
     }
@@ -85,6 +85,9 @@ class StreamingS2SClient {
   std::mutex latencies_mutex_;
 
  private:
+  // Builds the configuration request that every stream read from a file starts with
+  void BuildConfigPrototype();
+
   // Out of the passed in Channel comes the stub, stored here, our view of the
   // server's exposed services.
   std::unique_ptr<nr_nmt::RivaTranslation::Stub> stub_;
@@ -120,6 +123,8 @@ class StreamingS2SClient {
 
   std::vector<std::string> boosted_phrases_;
   float boosted_phrases_score_;
+  // First request of every stream read from a file, but for the audio format
+  nr_nmt::StreamingTranslateSpeechToSpeechRequest config_prototype_;
 
   std::string tts_prosody_rate_;
   std::string tts_prosody_pitch_;
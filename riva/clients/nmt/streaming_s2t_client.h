@@ -82,6 +82,9 @@ class StreamingS2TClient {
   std::mutex latencies_mutex_;
 
  private:
+  // Builds the configuration request that every stream read from a file starts with
+  void BuildConfigPrototype();
+
   // Out of the passed in Channel comes the stub, stored here, our view of the
   // server's exposed services.
   std::unique_ptr<nr_nmt::RivaTranslation::Stub> stub_;
@@ -113,6 +116,8 @@ class StreamingS2TClient {
 
   std::vector<std::string> boosted_phrases_;
   float boosted_phrases_score_;
+  // First request of every stream read from a file, but for the audio format
+  nr_nmt::StreamingTranslateSpeechToTextRequest config_prototype_;
   std::string nmt_text_file_;
   std::ofstream output_file_;
 };
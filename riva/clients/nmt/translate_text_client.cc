@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "translate_text_client.h"
+
+#include <glog/logging.h>
+
+#include "riva/clients/utils/grpc.h"
+
+TranslateTextClient::TranslateTextClient(
+    std::shared_ptr<grpc::Channel> channel, const std::string& source_language_code,
+    const std::string& target_language_code, const std::string& model_name,
+    const std::string& dnt_phrases, const std::string& max_len_variation,
+    riva::clients::HedgingPolicy& hedging, riva::clients::SlaTracker& sla)
+    : stub_(nr_nmt::RivaTranslation::NewStub(channel)), hedging_(hedging), sla_(sla)
+{
+  request_prototype_.set_model(model_name);
+  request_prototype_.set_source_language(source_language_code);
+  request_prototype_.set_target_language(target_language_code);
+  request_prototype_.add_dnt_phrases(dnt_phrases);
+  request_prototype_.set_max_len_variation(max_len_variation);
+}
+
+TranslateTextClient::~TranslateTextClient()
+{
+  Stop();
+}
+
+void
+TranslateTextClient::SetCompression(
+    grpc_compression_algorithm compression, size_t min_bytes,
+    riva::clients::CompressionStats* stats)
+{
+  compression_ = compression;
+  compression_min_bytes_ = min_bytes;
+  compression_stats_ = stats;
+}
+
+void
+TranslateTextClient::Start(
+    int32_t num_completion_threads, int32_t max_in_flight, ResultFunc result_func)
+{
+  result_func_ = std::move(result_func);
+  max_in_flight_ = max_in_flight;
+  in_flight_ = std::make_unique<riva::utils::Semaphore>(max_in_flight);
+  for (int32_t i = 0; i < num_completion_threads; ++i) {
+    cqs_.push_back(std::make_unique<grpc::CompletionQueue>());
+  }
+  for (auto& cq : cqs_) {
+    completion_threads_.emplace_back(&TranslateTextClient::AsyncCompleteRpc, this, cq.get());
+  }
+}
+
+void
+TranslateTextClient::Translate(TranslationBatch batch)
+{
+  in_flight_->Acquire();
+
+  AsyncClientCall* call = new AsyncClientCall;
+  call->request = request_prototype_;
+  for (auto& text : batch.texts) {
+    call->request.add_texts(text);
+  }
+  if (dnt_pruner_) {
+    call->request.set_dnt_phrases(0, dnt_pruner_->Prune(batch.texts));
+  }
+  call->batch = std::move(batch);
+
+  // Hedges and retries share the deadline of the first attempt
+  auto deadline = sla_.Deadline();
+  auto* cq = cqs_[next_cq_++ % cqs_.size()].get();
+  call->Start(
+      &hedging_, cq,
+      [this, call, deadline](
+          grpc::ClientContext* context, grpc::CompletionQueue* cq, int32_t attempt) {
+        riva::clients::SetCallCompression(
+            *context, compression_, call->request.ByteSizeLong(), compression_min_bytes_);
+        if (sla_.Enabled()) {
+          context->set_deadline(deadline);
+        }
+        return stub_->PrepareAsyncTranslateText(context, call->request, cq);
+      });
+}
+
+void
+TranslateTextClient::Drain()
+{
+  if (!in_flight_) {
+    return;
+  }
+  for (int32_t i = 0; i < max_in_flight_; ++i) {
+    in_flight_->Acquire();
+  }
+  in_flight_->Release(max_in_flight_);
+}
+
+void
+TranslateTextClient::Stop()
+{
+  Drain();
+  for (auto& cq : cqs_) {
+    cq->Shutdown();
+  }
+  for (auto& thread : completion_threads_) {
+    thread.join();
+  }
+  completion_threads_.clear();
+  cqs_.clear();
+}
+
+void
+TranslateTextClient::AsyncCompleteRpc(grpc::CompletionQueue* cq)
+{
+  void* got_tag;
+  bool ok = false;
+
+  // Block until the next result is available in the completion queue "cq".
+  while (cq->Next(&got_tag, &ok)) {
+    // Tags are attempts and hedging alarms of the calls, a call is complete once all of them
+    // came back
+    auto* tag = static_cast<riva::clients::HedgedCallTag*>(got_tag);
+    if (!tag->call->Proceed(tag, ok)) {
+      continue;
+    }
+    AsyncClientCall* call = static_cast<AsyncClientCall*>(tag->call);
+
+    sla_.Record(call->status, call->latency_ms, call->batch.texts.size());
+    if (!call->status.ok()) {
+      // Requests past their deadline are counted by the SLA report rather than as failures
+      if (!sla_.IsLate(call->status)) {
+        LOG(ERROR) << call->status.error_message();
+        num_failed_requests_++;
+      }
+    } else if (compression_stats_) {
+      compression_stats_->RecordRequest(call->request);
+      compression_stats_->RecordResponse(call->response);
+    }
+    if (result_func_) {
+      result_func_(call->batch, call->status, call->response, call->latency_ms);
+    }
+
+    delete call;
+    in_flight_->Release();
+  }
+}
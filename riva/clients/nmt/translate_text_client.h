@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "riva/clients/utils/compression_stats.h"
+#include "riva/clients/utils/hedging.h"
+#include "riva/clients/utils/sla.h"
+#include "riva/proto/riva_nmt.grpc.pb.h"
+#include "riva/utils/phrases/phrase_matcher.h"
+#include "riva/utils/semaphore.h"
+
+namespace nr_nmt = nvidia::riva::nmt;
+
+// Lines of a text file translated by one TranslateText request
+struct TranslationBatch {
+  // Index of each line in the file
+  std::vector<int64_t> ids;
+  std::vector<std::string> texts;
+};
+
+// Asynchronous TranslateText client, keeping many batches in flight on a few completion threads
+// rather than a thread per request
+class TranslateTextClient {
+ public:
+  // Called from a completion thread for every batch translated, concurrently when there are
+  // several threads. `response` can be moved from.
+  using ResultFunc = std::function<void(
+      TranslationBatch& batch, const grpc::Status& status, nr_nmt::TranslateTextResponse& response,
+      double latency_ms)>;
+
+  TranslateTextClient(
+      std::shared_ptr<grpc::Channel> channel, const std::string& source_language_code,
+      const std::string& target_language_code, const std::string& model_name,
+      const std::string& dnt_phrases, const std::string& max_len_variation,
+      riva::clients::HedgingPolicy& hedging, riva::clients::SlaTracker& sla);
+
+  ~TranslateTextClient();
+
+  // Per-request override of the channel compression, see riva::clients::SetCallCompression.
+  // Requests and responses are recorded in `stats` if not null
+  void SetCompression(
+      grpc_compression_algorithm compression, size_t min_bytes,
+      riva::clients::CompressionStats* stats);
+
+  // Sends each request only the DNT phrases occurring in its texts, as pruned by `pruner`,
+  // instead of all of them
+  void SetDntPhrasePruner(riva::utils::phrases::DictionaryPruner* pruner) { dnt_pruner_ = pruner; }
+
+  // Starts the threads processing the responses, each draining a completion queue of its own.
+  // Translate then blocks while `max_in_flight` requests are in flight.
+  void Start(int32_t num_completion_threads, int32_t max_in_flight, ResultFunc result_func);
+
+  // Sends the batch to the server, blocking without using CPU while the maximum number of
+  // requests is in flight
+  void Translate(TranslationBatch batch);
+
+  // Waits for the responses of all the batches sent so far
+  void Drain();
+
+  // Drains, then stops the completion threads
+  void Stop();
+
+  uint32_t NumFailedRequests() { return num_failed_requests_; }
+
+ private:
+  struct AsyncClientCall : public riva::clients::HedgedCall<nr_nmt::TranslateTextResponse> {
+    // Kept for the hedges and retries
+    nr_nmt::TranslateTextRequest request;
+    TranslationBatch batch;
+  };
+
+  void AsyncCompleteRpc(grpc::CompletionQueue* cq);
+
+  std::unique_ptr<nr_nmt::RivaTranslation::Stub> stub_;
+  // Configuration of every request, but for its texts
+  nr_nmt::TranslateTextRequest request_prototype_;
+  riva::clients::HedgingPolicy& hedging_;
+  riva::clients::SlaTracker& sla_;
+  grpc_compression_algorithm compression_ = GRPC_COMPRESS_NONE;
+  size_t compression_min_bytes_ = 0;
+  riva::clients::CompressionStats* compression_stats_ = nullptr;
+  riva::utils::phrases::DictionaryPruner* dnt_pruner_ = nullptr;
+
+  ResultFunc result_func_;
+  // One completion queue per completion thread
+  std::vector<std::unique_ptr<grpc::CompletionQueue>> cqs_;
+  std::vector<std::thread> completion_threads_;
+  std::atomic<size_t> next_cq_{0};
+  // One permit per request allowed in flight
+  std::unique_ptr<riva::utils::Semaphore> in_flight_;
+  int32_t max_in_flight_ = 0;
+  std::atomic<uint32_t> num_failed_requests_{0};
+};
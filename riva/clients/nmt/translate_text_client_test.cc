@@ -0,0 +1,199 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "translate_text_client.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "riva/clients/utils/test_server.h"
+
+namespace {
+
+// Translates every text of a request into "<text>!"
+grpc::ByteBuffer
+Exclaim(const grpc::ByteBuffer& buffer)
+{
+  auto request = riva::clients::ParseMessage<nr_nmt::TranslateTextRequest>(buffer);
+  nr_nmt::TranslateTextResponse response;
+  for (auto& text : request.texts()) {
+    response.add_translations()->set_text(text + "!");
+  }
+  return riva::clients::SerializeMessage(response);
+}
+
+TranslationBatch
+Batch(int64_t id)
+{
+  return TranslationBatch{{id, id + 1000}, {std::to_string(id), std::to_string(id + 1000)}};
+}
+
+// Client of `server` without hedging nor SLA, which records the results it gets
+class Translator {
+ public:
+  explicit Translator(riva::clients::TestServer& server)
+      : hedging_(riva::clients::HedgingPolicy::Options{}), sla_(0.),
+        client_(server.Channel(), "en", "de", "", "", "", hedging_, sla_)
+  {
+  }
+
+  void Start(int32_t num_completion_threads, int32_t max_in_flight)
+  {
+    client_.Start(
+        num_completion_threads, max_in_flight,
+        [this](
+            TranslationBatch& batch, const grpc::Status& status,
+            nr_nmt::TranslateTextResponse& response, double latency_ms) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          threads_.insert(std::this_thread::get_id());
+          if (!status.ok()) {
+            failed_.push_back(batch.ids[0]);
+            return;
+          }
+          for (int i = 0; i < response.translations_size(); ++i) {
+            translations_[batch.ids[i]] = response.translations(i).text();
+          }
+        });
+  }
+
+  TranslateTextClient& client() { return client_; }
+
+  std::map<int64_t, std::string> translations()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return translations_;
+  }
+
+  std::vector<int64_t> failed()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+  }
+
+  size_t NumThreads()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_.size();
+  }
+
+ private:
+  riva::clients::HedgingPolicy hedging_;
+  riva::clients::SlaTracker sla_;
+  TranslateTextClient client_;
+  std::mutex mutex_;
+  std::map<int64_t, std::string> translations_;
+  std::vector<int64_t> failed_;
+  std::set<std::thread::id> threads_;
+};
+
+}  // namespace
+
+TEST(TranslateTextClient, InFlightLimit)
+{
+  // Calls in flight on the server: counted when their request is read, until they are answered
+  std::mutex mutex;
+  int in_flight = 0;
+  int max_in_flight = 0;
+  riva::clients::TestServer server(
+      [&](int) {
+        std::lock_guard<std::mutex> lock(mutex);
+        max_in_flight = std::max(max_in_flight, ++in_flight);
+        return std::make_pair(50, grpc::StatusCode::OK);
+      },
+      [&](const grpc::ByteBuffer& request) {
+        std::lock_guard<std::mutex> lock(mutex);
+        in_flight--;
+        return Exclaim(request);
+      });
+  Translator translator(server);
+  translator.Start(2, 2);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t id = 0; id < 6; ++id) {
+    translator.client().Translate(Batch(id));
+  }
+  translator.client().Drain();
+
+  // Three rounds of two requests
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(150));
+  EXPECT_EQ(max_in_flight, 2);
+  EXPECT_EQ(server.NumCalls(), 6);
+  EXPECT_EQ(translator.translations().size(), 12U);
+}
+
+TEST(TranslateTextClient, DrainSeveralCompletionThreads)
+{
+  // Later calls are answered first, out of order
+  riva::clients::TestServer server(
+      [](int call_index) {
+        return std::make_pair(((call_index * 7) % 5) * 10, grpc::StatusCode::OK);
+      },
+      Exclaim);
+  Translator translator(server);
+  translator.Start(3, 8);
+
+  const int64_t kNumBatches = 30;
+  for (int64_t id = 0; id < kNumBatches; ++id) {
+    translator.client().Translate(Batch(id));
+  }
+  translator.client().Drain();
+
+  // Every result is in once Drain returns, each text translated by the item of the response
+  // matching its index in the batch
+  auto translations = translator.translations();
+  ASSERT_EQ(translations.size(), static_cast<size_t>(2 * kNumBatches));
+  for (int64_t id = 0; id < kNumBatches; ++id) {
+    EXPECT_EQ(translations[id], std::to_string(id) + "!");
+    EXPECT_EQ(translations[id + 1000], std::to_string(id + 1000) + "!");
+  }
+  // The requests are spread over the completion queues, each drained by its own thread
+  EXPECT_EQ(translator.NumThreads(), 3U);
+  EXPECT_EQ(translator.client().NumFailedRequests(), 0U);
+
+  // The client can be used again after Drain
+  translator.client().Translate(Batch(kNumBatches));
+  translator.client().Drain();
+  EXPECT_EQ(translator.translations().size(), static_cast<size_t>(2 * kNumBatches + 2));
+}
+
+TEST(TranslateTextClient, StopWaitsForResults)
+{
+  riva::clients::TestServer server(
+      [](int call_index) {
+        return std::make_pair(
+            20, call_index % 3 == 1 ? grpc::StatusCode::INVALID_ARGUMENT : grpc::StatusCode::OK);
+      },
+      Exclaim);
+  Translator translator(server);
+  translator.Start(2, 4);
+
+  for (int64_t id = 0; id < 9; ++id) {
+    translator.client().Translate(Batch(id));
+  }
+  translator.client().Stop();
+
+  // The failed requests reach the callback too
+  EXPECT_EQ(translator.translations().size(), 12U);
+  EXPECT_EQ(translator.failed().size(), 3U);
+  EXPECT_EQ(translator.client().NumFailedRequests(), 3U);
+
+  // Stopping again, as the destructor does, is a no-op
+  translator.client().Stop();
+}
+
+TEST(TranslateTextClient, StopWithoutStart)
+{
+  riva::clients::TestServer server([](int) { return std::make_pair(0, grpc::StatusCode::OK); });
+  Translator translator(server);
+  translator.client().Drain();
+  translator.client().Stop();
+}
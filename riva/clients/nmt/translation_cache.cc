@@ -0,0 +1,207 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "translation_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// File layout, in host byte order: magic, version, number of entries, then for each entry from
+// the least to the most recently used its key, the length of its translation and the translation
+constexpr uint32_t kMagic = 0x43545652;  // "RVTC"
+// Bumped whenever the layout or the key hash changes
+constexpr uint32_t kVersion = 1;
+
+void
+HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+  // FNV-1a
+  auto bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+}
+
+void
+HashField(uint64_t& hash, const std::string& field)
+{
+  // Length-prefixed, so that moving characters from a field to the next changes the key
+  uint64_t size = field.size();
+  HashBytes(hash, &size, sizeof(size));
+  HashBytes(hash, field.data(), field.size());
+}
+
+template <typename T>
+bool
+ReadValue(const char*& pos, const char* end, T* value)
+{
+  if (static_cast<size_t>(end - pos) < sizeof(T)) {
+    return false;
+  }
+  memcpy(value, pos, sizeof(T));
+  pos += sizeof(T);
+  return true;
+}
+
+}  // namespace
+
+uint64_t
+TranslationCacheKey(
+    const std::string& source_language_code, const std::string& target_language_code,
+    const std::string& model_name, const std::string& config, const std::string& text)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  HashField(hash, source_language_code);
+  HashField(hash, target_language_code);
+  HashField(hash, model_name);
+  HashField(hash, config);
+  HashField(hash, text);
+  return hash;
+}
+
+bool
+TranslationCache::Lookup(uint64_t key, std::string* translation)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  *translation = it->second->second;
+  return true;
+}
+
+void
+TranslationCache::Insert(uint64_t key, std::string translation)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  InsertLocked(key, std::move(translation));
+}
+
+void
+TranslationCache::InsertLocked(uint64_t key, std::string translation)
+{
+  if (capacity_ == 0) {
+    return;
+  }
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->second = std::move(translation);
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return;
+  }
+  if (entries_.size() == capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(key, std::move(translation));
+  index_[key] = entries_.begin();
+}
+
+size_t
+TranslationCache::Size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+bool
+TranslationCache::Load(const std::string& path)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return false;
+    }
+    throw std::runtime_error("Could not open translation cache " + path + ": " + strerror(errno));
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("Could not stat translation cache " + path + ": " + strerror(errno));
+  }
+  size_t size = st.st_size;
+  void* data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Could not map translation cache " + path + ": " + strerror(errno));
+  }
+
+  // Entries are only added once the whole file was checked
+  std::vector<std::pair<uint64_t, std::string>> loaded;
+  const char* pos = static_cast<const char*>(data);
+  const char* end = pos + size;
+  uint32_t magic = 0, version = 0;
+  uint64_t count = 0;
+  bool valid = ReadValue(pos, end, &magic) && magic == kMagic && ReadValue(pos, end, &version) &&
+               version == kVersion && ReadValue(pos, end, &count);
+  for (uint64_t i = 0; valid && i < count; i++) {
+    uint64_t key;
+    uint32_t length;
+    valid = ReadValue(pos, end, &key) && ReadValue(pos, end, &length) &&
+            static_cast<size_t>(end - pos) >= length;
+    if (valid) {
+      loaded.emplace_back(key, std::string(pos, length));
+      pos += length;
+    }
+  }
+  valid = valid && pos == end;
+  if (data) {
+    munmap(data, size);
+  }
+  if (!valid) {
+    throw std::runtime_error("Invalid translation cache " + path);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& entry : loaded) {
+    InsertLocked(entry.first, std::move(entry.second));
+  }
+  return true;
+}
+
+void
+TranslationCache::Save(const std::string& path) const
+{
+  std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw std::runtime_error("Could not write translation cache " + tmp_path);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t count = entries_.size();
+    out.write(reinterpret_cast<const char*>(&kMagic), sizeof(kMagic));
+    out.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+      uint32_t length = it->second.size();
+      out.write(reinterpret_cast<const char*>(&it->first), sizeof(it->first));
+      out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+      out.write(it->second.data(), length);
+    }
+    out.flush();
+    if (!out) {
+      throw std::runtime_error("Could not write translation cache " + tmp_path);
+    }
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    throw std::runtime_error(
+        "Could not replace translation cache " + path + ": " + strerror(errno));
+  }
+}
@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// Key of a translation: a hash of everything the server output depends on, i.e. the source and
+// target languages, the model, the other options of the request (`config`) and the text
+uint64_t TranslationCacheKey(
+    const std::string& source_language_code, const std::string& target_language_code,
+    const std::string& model_name, const std::string& config, const std::string& text);
+
+// Content-addressed LRU cache of translations, holding at most `capacity` entries. Thread safe.
+//
+// The cache can be persisted across runs: Load maps a file written by Save and adds its
+// entries. Files are checked before use; Load throws std::runtime_error on a file that cannot
+// be read or is not a valid cache.
+class TranslationCache {
+ public:
+  explicit TranslationCache(size_t capacity) : capacity_(capacity) {}
+
+  TranslationCache(const TranslationCache&) = delete;
+  TranslationCache& operator=(const TranslationCache&) = delete;
+
+  // Copies the translation of `key` to `translation` and marks it as most recently used.
+  // Returns false when it is not cached.
+  bool Lookup(uint64_t key, std::string* translation);
+
+  // Adds or replaces the translation of `key`, evicting the least recently used entry when full
+  void Insert(uint64_t key, std::string translation);
+
+  size_t Size() const;
+
+  // Adds the entries of the cache file at `path`, keeping their recency order. Returns false,
+  // leaving the cache unchanged, when the file does not exist.
+  bool Load(const std::string& path);
+
+  // Writes the cache to `path`, replacing any previous file only once the new one is complete
+  void Save(const std::string& path) const;
+
+ private:
+  using Entry = std::pair<uint64_t, std::string>;
+
+  // Caller holds mutex_
+  void InsertLocked(uint64_t key, std::string translation);
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  // Most recently used first
+  std::list<Entry> entries_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+};
@@ -0,0 +1,105 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "translation_cache.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::string
+TempPath(const std::string& name)
+{
+  return ::testing::TempDir() + "/" + name + "_" + std::to_string(getpid());
+}
+
+}  // namespace
+
+TEST(TranslationCache, Key)
+{
+  uint64_t key = TranslationCacheKey("en-US", "de-DE", "", "", "Hello");
+  EXPECT_EQ(key, TranslationCacheKey("en-US", "de-DE", "", "", "Hello"));
+  EXPECT_NE(key, TranslationCacheKey("en-US", "fr-FR", "", "", "Hello"));
+  EXPECT_NE(key, TranslationCacheKey("en-US", "de-DE", "model", "", "Hello"));
+  EXPECT_NE(key, TranslationCacheKey("en-US", "de-DE", "", "dnt", "Hello"));
+  EXPECT_NE(key, TranslationCacheKey("en-US", "de-DE", "", "", "Hello!"));
+  EXPECT_NE(
+      TranslationCacheKey("en-US", "de-DE", "", "a", "b"),
+      TranslationCacheKey("en-US", "de-DE", "", "", "ab"));
+}
+
+TEST(TranslationCache, LeastRecentlyUsedEvicted)
+{
+  TranslationCache cache(2);
+  std::string translation;
+  EXPECT_FALSE(cache.Lookup(1, &translation));
+  cache.Insert(1, "one");
+  cache.Insert(2, "two");
+  ASSERT_TRUE(cache.Lookup(1, &translation));
+  EXPECT_EQ(translation, "one");
+
+  cache.Insert(3, "three");
+  EXPECT_EQ(cache.Size(), 2U);
+  EXPECT_FALSE(cache.Lookup(2, &translation));
+  EXPECT_TRUE(cache.Lookup(1, &translation));
+  ASSERT_TRUE(cache.Lookup(3, &translation));
+  EXPECT_EQ(translation, "three");
+
+  cache.Insert(1, "uno");
+  ASSERT_TRUE(cache.Lookup(1, &translation));
+  EXPECT_EQ(translation, "uno");
+  EXPECT_EQ(cache.Size(), 2U);
+}
+
+TEST(TranslationCache, SaveAndLoad)
+{
+  std::string path = TempPath("translation_cache");
+  {
+    TranslationCache cache(3);
+    EXPECT_FALSE(cache.Load(path));
+    cache.Insert(1, "one");
+    cache.Insert(2, "");
+    cache.Insert(3, "three");
+    std::string translation;
+    cache.Lookup(1, &translation);
+    cache.Save(path);
+  }
+
+  // Only the two most recently used entries fit
+  TranslationCache cache(2);
+  ASSERT_TRUE(cache.Load(path));
+  EXPECT_EQ(cache.Size(), 2U);
+  std::string translation;
+  EXPECT_FALSE(cache.Lookup(2, &translation));
+  ASSERT_TRUE(cache.Lookup(1, &translation));
+  EXPECT_EQ(translation, "one");
+  ASSERT_TRUE(cache.Lookup(3, &translation));
+  EXPECT_EQ(translation, "three");
+  unlink(path.c_str());
+}
+
+TEST(TranslationCache, InvalidFile)
+{
+  std::string path = TempPath("invalid_translation_cache");
+  {
+    TranslationCache cache(2);
+    cache.Insert(1, "one");
+    cache.Save(path);
+  }
+  // Truncated in the middle of the translation
+  ASSERT_EQ(truncate(path.c_str(), 20), 0);
+  TranslationCache cache(2);
+  EXPECT_THROW(cache.Load(path), std::runtime_error);
+  EXPECT_EQ(cache.Size(), 0U);
+
+  std::ofstream(path, std::ios::trunc) << "not a cache";
+  EXPECT_THROW(cache.Load(path), std::runtime_error);
+  unlink(path.c_str());
+}
@@ -14,13 +14,13 @@
 #include <fstream>
 #include <iostream>
 #include <iterator>
-#include <regex>
 #include <string>
 
 #include "riva/clients/utils/grpc.h"
 #include "riva/proto/riva_tts.grpc.pb.h"
 #include "riva/utils/files/files.h"
 #include "riva/utils/opus/opus_client_decoder.h"
+#include "riva/utils/phrases/phrases.h"
 #include "riva/utils/stamping.h"
 #include "riva/utils/wav/wav_reader.h"
 #include "riva/utils/wav/wav_writer.h"
@@ -49,12 +49,18 @@ DEFINE_bool(
     use_ssl, false,
     "Whether to use SSL credentials or not. If ssl_root_cert is specified, "
     "this is assumed to be true");
-DEFINE_string(metadata, "", "Comma separated key-value pair(s) of metadata to be sent to server");
+DEFINE_string(
+    metadata, "",
+    "Comma separated key-value pair(s) of metadata to be sent to server, or @<file> to read them "
+    "from a file that is reloaded when it changes");
 DEFINE_string(
     zero_shot_audio_prompt, "",
     "Input audio prompt file for Zero Shot Model. Audio length should be between 3-10 seconds.");
 DEFINE_int32(zero_shot_quality, 20, "Required quality of output audio, ranges between 1-40.");
 DEFINE_string(custom_dictionary, "", " User dictionary containing graph-to-phone custom words");
+DEFINE_bool(
+    dictionary_cache, false,
+    "Keep the parsed custom dictionary in <file>.cache, reused while the file is unchanged");
 DEFINE_string(zero_shot_transcript, "", "Transcript corresponding to Zero shot audio prompt.");
 DEFINE_uint64(timeout_ms, 10000, "Timeout for GRPC channel creation");
 DEFINE_uint64(max_grpc_message_size, MAX_GRPC_MESSAGE_SIZE, "Max GRPC message size");
@@ -70,31 +76,17 @@ ReadUserDictionaryFile(const std::string& dictionary_file)
 {
   std::string dictionary_string;
   if (!dictionary_file.empty()) {
-    std::ifstream infile(dictionary_file);
-
-    if (infile.is_open()) {
-      std::string line;
-
-      while (std::getline(infile, line)) {
-        // Trim leading and trailing whitespaces
-        line = std::regex_replace(line, std::regex("^ +| +$"), "");
-        size_t pos = line.find("  ");
-
-        if (pos != std::string::npos) {
-          std::string key = line.substr(0, pos);
-          std::string value = std::regex_replace(line.substr(pos + 2), std::regex("^ +"), "");
-          // Append the key-value pair to the dictionary string
-          if (!dictionary_string.empty()) {
-            dictionary_string += ",";
-          }
-          dictionary_string += key + "  " + value;
-        } else {
-          LOG(WARNING) << "Warning: Malformed line " << line << std::endl;
-        }
+    auto dictionary = riva::utils::phrases::Load(
+        dictionary_file, riva::utils::phrases::Format::kUserDictionary, FLAGS_dictionary_cache);
+    for (auto& line : dictionary->malformed_lines) {
+      LOG(WARNING) << "Warning: Malformed line " << line << std::endl;
+    }
+    for (auto& entry : dictionary->entries) {
+      // Append the key-value pair to the dictionary string
+      if (!dictionary_string.empty()) {
+        dictionary_string += ",";
       }
-    } else {
-      std::string err = "Could not open file " + dictionary_file;
-      throw std::runtime_error(err);
+      dictionary_string += entry.key + "  " + entry.value;
     }
   }
   return dictionary_string;
@@ -145,11 +137,12 @@ main(int argc, char** argv)
   str_usage << "           --ssl_root_cert=<filename>" << std::endl;
   str_usage << "           --ssl_client_key=<filename>" << std::endl;
   str_usage << "           --ssl_client_cert=<filename>" << std::endl;
-  str_usage << "           --metadata=<key,value,...>" << std::endl;
+  str_usage << "           --metadata=<key,value,...|@filename>" << std::endl;
   str_usage << "           --zero_shot_audio_prompt=<filename>" << std::endl;
   str_usage << "           --zero_shot_quality=<quality>" << std::endl;
   str_usage << "           --zero_shot_transcript=<text>" << std::endl;
   str_usage << "           --custom_dictionary=<filename> " << std::endl;
+  str_usage << "           --dictionary_cache=<true|false> " << std::endl;
   str_usage << "           --timeout_ms=<timeout_ms> " << std::endl;
   str_usage << "           --max_grpc_message_size=<max_grpc_message_size> " << std::endl;
   str_usage << "           --custom_configuration=<key:value,key:value,...> " << std::endl;
@@ -9,21 +9,27 @@
 #include <strings.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <chrono>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <numeric>
-#include <regex>
 #include <string>
 #include <thread>
 #include <utility>
 
+#include "riva/clients/utils/capacity_search.h"
+#include "riva/clients/utils/compression_stats.h"
 #include "riva/clients/utils/grpc.h"
+#include "riva/clients/utils/hedging.h"
+#include "riva/clients/utils/sla.h"
 #include "riva/proto/riva_tts.grpc.pb.h"
 #include "riva/utils/files/files.h"
 #include "riva/utils/opus/opus_client_decoder.h"
+#include "riva/utils/phrases/phrase_matcher.h"
+#include "riva/utils/phrases/phrases.h"
 #include "riva/utils/stamping.h"
 #include "riva/utils/wav/wav_reader.h"
 #include "riva/utils/wav/wav_writer.h"
@@ -36,7 +42,9 @@ namespace nr_tts = nvidia::riva::tts;
 DEFINE_string(
     text_file, "", "Text file with list of sentences to be synthesized. Ignored if 'text' is set.");
 DEFINE_string(audio_encoding, "pcm", "Audio encoding (pcm or opus)");
-DEFINE_string(riva_uri, "localhost:50051", "Riva API server URI and port");
+DEFINE_string(
+    riva_uri, "localhost:50051",
+    "Riva API server URI and port, or comma separated URIs of several servers used in turn");
 DEFINE_int32(rate, 44100, "Sample rate for the TTS output");
 DEFINE_bool(online, false, "Whether synthesis should be online or batch");
 DEFINE_bool(
@@ -48,6 +56,43 @@ DEFINE_string(
 DEFINE_string(voice_name, "", "Desired voice name");
 DEFINE_int32(num_iterations, 1, "Number of times to loop over audio files");
 DEFINE_int32(num_parallel_requests, 1, "Number of parallel requests to keep in flight");
+DEFINE_double(
+    sla_ms, 0.,
+    "Latency SLA of a request (the whole stream when online): requests get it as deadline, are "
+    "cancelled past it and the goodput within it is reported. 0 for no deadline");
+DEFINE_int32(
+    max_attempts, 1,
+    "Maximum number of attempts per batch request, counting hedges and retries (not used when "
+    "online)");
+DEFINE_double(
+    hedge_delay_ms, 0.,
+    "Delay after which another attempt is sent if a request got no answer, 0 to only retry");
+DEFINE_double(
+    hedge_percentile, 0.,
+    "Percentile of the observed latencies used as hedge delay, hedge_delay_ms being used until "
+    "enough requests completed");
+DEFINE_double(
+    retry_budget, 0.1, "Maximum ratio of hedges and retries to requests, on top of a few extra");
+DEFINE_double(
+    capacity_slo_ms, 0.,
+    "Search the highest number of parallel requests at which the capacity_percentile latency "
+    "stays under this SLO, instead of running at num_parallel_requests. The latency is the time "
+    "to first audio in online mode. 0 to disable");
+DEFINE_double(capacity_percentile, 99., "Latency percentile the capacity search holds to the SLO");
+DEFINE_int32(max_concurrency, 256, "Highest number of parallel requests the capacity search tries");
+DEFINE_int32(
+    capacity_warmup_runs, 1, "Unmeasured runs at each level of the capacity search before it");
+DEFINE_int32(num_connections, 1, "Number of connections opened to the server");
+DEFINE_string(compression, "none", "Compression of the requests: none, gzip or deflate");
+DEFINE_int32(
+    compression_min_bytes, 0, "Requests smaller than this many bytes are sent uncompressed");
+DEFINE_bool(
+    compression_report, false,
+    "Report estimated wire bytes and client CPU time (adds the cost of compressing every message "
+    "once more, excluded from the reported CPU time)");
+DEFINE_int32(
+    max_streams_per_connection, 0,
+    "Maximum number of requests in flight per connection, 0 for no limit");
 DEFINE_int32(num_sentences, 1, "Number of sentences to send");
 DEFINE_int32(throttle_milliseconds, 0, "Number of milliseconds to sleep for between TTS requests");
 DEFINE_int32(offset_milliseconds, 0, "Number of milliseconds to offset each parallel TTS requests");
@@ -58,12 +103,22 @@ DEFINE_bool(
     use_ssl, false,
     "Whether to use SSL credentials or not. If ssl_root_cert is specified, "
     "this is assumed to be true");
-DEFINE_string(metadata, "", "Comma separated key-value pair(s) of metadata to be sent to server");
+DEFINE_string(
+    metadata, "",
+    "Comma separated key-value pair(s) of metadata to be sent to server, or @<file> to read them "
+    "from a file that is reloaded when it changes");
 DEFINE_string(
     zero_shot_audio_prompt, "",
     "Input audio prompt file for Zero Shot Model. Audio length should be between 3-10 seconds.");
 DEFINE_int32(zero_shot_quality, 20, "Required quality of output audio, ranges between 1-40.");
 DEFINE_string(custom_dictionary, "", " User dictionary containing graph-to-phone custom words");
+DEFINE_bool(
+    prune_custom_dictionary, false,
+    "Send each request only the custom dictionary words occurring in its text, ignoring case, "
+    "instead of the whole dictionary");
+DEFINE_bool(
+    dictionary_cache, false,
+    "Keep the parsed custom dictionary in <file>.cache, reused while the file is unchanged");
 DEFINE_string(zero_shot_transcript, "", "Transcript corresponding to Zero shot audio prompt.");
 DEFINE_string(
     custom_configuration, "",
@@ -85,31 +140,17 @@ ReadUserDictionaryFile(const std::string& dictionary_file)
 {
   std::string dictionary_string;
   if (!dictionary_file.empty()) {
-    std::ifstream infile(dictionary_file);
-
-    if (infile.is_open()) {
-      std::string line;
-
-      while (std::getline(infile, line)) {
-        // Trim leading and trailing whitespaces
-        line = std::regex_replace(line, std::regex("^ +| +$"), "");
-        size_t pos = line.find("  ");
-
-        if (pos != std::string::npos) {
-          std::string key = line.substr(0, pos);
-          std::string value = std::regex_replace(line.substr(pos + 2), std::regex("^ +"), "");
-          // Append the key-value pair to the dictionary string
-          if (!dictionary_string.empty()) {
-            dictionary_string += ",";
-          }
-          dictionary_string += key + "  " + value;
-        } else {
-          LOG(WARNING) << "Warning: Malformed line " << line << std::endl;
-        }
+    auto dictionary = riva::utils::phrases::Load(
+        dictionary_file, riva::utils::phrases::Format::kUserDictionary, FLAGS_dictionary_cache);
+    for (auto& line : dictionary->malformed_lines) {
+      LOG(WARNING) << "Warning: Malformed line " << line << std::endl;
+    }
+    for (auto& entry : dictionary->entries) {
+      // Append the key-value pair to the dictionary string
+      if (!dictionary_string.empty()) {
+        dictionary_string += ",";
       }
-    } else {
-      std::string err = "Could not open file " + dictionary_file;
-      throw std::runtime_error(err);
+      dictionary_string += entry.key + "  " + entry.value;
     }
   }
   return dictionary_string;
@@ -144,8 +185,12 @@ int32_t
 synthesizeBatch(
     std::unique_ptr<nr_tts::RivaSpeechSynthesis::Stub> tts, std::string text, std::string language,
     uint32_t rate, std::string voice_name, std::string filepath,
-    std::string zero_shot_prompt_filename, int32_t zero_shot_quality, std::string custom_dictionary,
-    std::string zero_shot_transcript, const std::string& custom_configuration)
+    std::string zero_shot_prompt_filename, int32_t zero_shot_quality,
+    const std::string& custom_dictionary, riva::utils::phrases::DictionaryPruner* dictionary_pruner,
+    std::string zero_shot_transcript, const std::string& custom_configuration,
+    grpc_compression_algorithm compression, riva::clients::CompressionStats* compression_stats,
+    riva::clients::HedgingPolicy* hedging, riva::clients::SlaTracker& sla,
+    double* latency_ms = nullptr)
 {
   // Parse command line arguments.
   nr_tts::SynthesizeSpeechRequest request;
@@ -162,8 +207,8 @@ synthesizeBatch(
     return -1;
   }
 
-  custom_dictionary = ReadUserDictionaryFile(custom_dictionary);
-  request.set_custom_dictionary(custom_dictionary);
+  request.set_custom_dictionary(
+      dictionary_pruner ? dictionary_pruner->Prune(text) : custom_dictionary);
 
   if (not zero_shot_prompt_filename.empty()) {
     auto zero_shot_data = request.mutable_zero_shot_data();
@@ -203,17 +248,62 @@ synthesizeBatch(
     return -1;
   }
 
-  // Send text content using Synthesize().
-  grpc::ClientContext context;
+  // Send text content using Synthesize(), or its asynchronous version when hedging or retrying
   nr_tts::SynthesizeSpeechResponse response;
+  // Hedges and retries share the deadline of the first attempt
+  auto deadline = sla.Deadline();
+  auto prepare_context = [&](grpc::ClientContext* context) {
+    riva::clients::SetCallCompression(
+        *context, compression, request.ByteSizeLong(), FLAGS_compression_min_bytes);
+    if (sla.Enabled()) {
+      context->set_deadline(deadline);
+    }
+  };
 
   DLOG(INFO) << "Sending request for input \"" << text << "\".";
   auto start = std::chrono::steady_clock::now();
-  grpc::Status rpc_status = tts->Synthesize(&context, request, &response);
+  grpc::Status rpc_status;
+  if (hedging && hedging->MaxAttempts() > 1) {
+    rpc_status = riva::clients::HedgedUnaryCall<nr_tts::SynthesizeSpeechResponse>(
+        *hedging,
+        [&](grpc::ClientContext* context, grpc::CompletionQueue* cq, int32_t attempt) {
+          prepare_context(context);
+          return tts->PrepareAsyncSynthesize(context, request, cq);
+        },
+        &response);
+  } else {
+    grpc::ClientContext context;
+    prepare_context(&context);
+    rpc_status = tts->Synthesize(&context, request, &response);
+  }
   auto end = std::chrono::steady_clock::now();
   DLOG(INFO) << "Received response for input \"" << text << "\".";
   std::chrono::duration<double> elapsed = end - start;
+  if (latency_ms) {
+    *latency_ms = elapsed.count() * 1000.;
+  }
+
+  // Opus responses are decoded to count their samples, the audio they carry being compressed
+  auto audio = response.audio();
+  std::vector<int16_t> pcm;
+  int32_t num_samples = 0;
+  if (rpc_status.ok()) {
+    if (FLAGS_audio_encoding == "opus") {
+      riva::utils::opus::Decoder decoder(rate, 1);
+      auto ptr = reinterpret_cast<unsigned char*>(audio.data());
+      pcm = decoder.DecodePcm(
+          decoder.DeserializeOpus(std::vector<unsigned char>(ptr, ptr + audio.size())));
+      num_samples = pcm.size();
+    } else {
+      num_samples = audio.length() / sizeof(int16_t);
+    }
+  }
+  sla.Record(rpc_status, elapsed.count() * 1000., static_cast<double>(num_samples) / rate);
 
+  if (sla.IsLate(rpc_status)) {
+    // Counted by the SLA report rather than as a failure
+    return 0;
+  }
   if (!rpc_status.ok()) {
     // Report the RPC failure.
     std::cerr << rpc_status.error_message() << std::endl;
@@ -221,31 +311,32 @@ synthesizeBatch(
     return -1;
   }
 
-  auto audio = response.audio();
+  if (compression_stats) {
+    compression_stats->RecordRequest(request);
+    compression_stats->RecordResponse(response);
+  }
+
   // Write to WAV file
   if (FLAGS_write_output_audio) {
     if (FLAGS_audio_encoding.empty() || FLAGS_audio_encoding == "pcm") {
-      ::riva::utils::wav::Write(
-          filepath, rate, (int16_t*)audio.data(), audio.length() / sizeof(int16_t));
+      ::riva::utils::wav::Write(filepath, rate, (int16_t*)audio.data(), num_samples);
     } else if (FLAGS_audio_encoding == "opus") {
-      riva::utils::opus::Decoder decoder(rate, 1);
-      auto ptr = reinterpret_cast<unsigned char*>(audio.data());
-      auto pcm = decoder.DecodePcm(
-          decoder.DeserializeOpus(std::vector<unsigned char>(ptr, ptr + audio.size())));
       ::riva::utils::wav::Write(filepath, rate, pcm.data(), pcm.size());
     }
   }
 
-  return audio.length() / sizeof(int16_t);
+  return num_samples;
 }
 
-void
+// Returns the status of the stream, whose audio is only counted if it is ok
+grpc::Status
 synthesizeOnline(
     std::unique_ptr<nr_tts::RivaSpeechSynthesis::Stub> tts, std::vector<std::string> text, std::string language,
     uint32_t rate, std::string voice_name, double* time_to_first_chunk,
     std::vector<double>* time_to_next_chunk, size_t* num_samples, std::string filepath,
     std::string zero_shot_prompt_filename, int32_t zero_shot_quality,
-    const std::string& custom_configuration)
+    const std::string& custom_configuration, riva::clients::CompressionStats* compression_stats,
+    riva::clients::SlaTracker& sla)
 {
   nr_tts::SynthesizeSpeechRequest request;
   request.set_language_code(language);
@@ -258,7 +349,7 @@ synthesizeOnline(
     ae = nr::OGGOPUS;
   } else {
     std::cerr << "Unsupported encoding: \'" << FLAGS_audio_encoding << "\'" << std::endl;
-    return;
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "unsupported encoding");
   }
   request.set_encoding(ae);
 
@@ -269,7 +360,7 @@ synthesizeOnline(
     if (audio_prompt.size() != 1) {
       LOG(ERROR) << "Unsupported number of audio prompts. Need exactly 1 audio prompt."
                  << std::endl;
-      return;
+      return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "unsupported audio prompts");
     }
 
     if (audio_prompt[0]->encoding != nr::LINEAR_PCM && audio_prompt[0]->encoding != nr::OGGOPUS) {
@@ -277,7 +368,7 @@ synthesizeOnline(
                  << "\'";
       std::cerr << "Unsupported encoding for zero shot prompt: \'" << audio_prompt[0]->encoding
                 << "\'" << std::endl;
-      return;
+      return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "unsupported prompt encoding");
     }
     zero_shot_data->set_audio_prompt(&audio_prompt[0]->data[0], audio_prompt[0]->data.size());
     int32_t zero_shot_sample_rate = audio_prompt[0]->sample_rate;
@@ -295,16 +386,18 @@ synthesizeOnline(
   }
   catch (const std::exception& e) {
     LOG(ERROR) << e.what() << std::endl;
-    return;
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, e.what());
   }
 
 
   // Send text content using SynthesizeOnline().
   grpc::ClientContext context;
+  sla.SetDeadline(context);
 
   nr_tts::SynthesizeSpeechResponse chunk;
 
   auto start = std::chrono::steady_clock::now();
+  auto call_start = start;
   std::unique_ptr<
       grpc::ClientReaderWriter<nr_tts::SynthesizeSpeechRequest, nr_tts::SynthesizeSpeechResponse>>
       reader(tts->SynthesizeOnline(&context));
@@ -313,6 +406,9 @@ synthesizeOnline(
     request.set_text(text_line);
     text_complete += text_line + " ";
     reader->Write(request);
+    if (compression_stats) {
+      compression_stats->RecordRequest(request);
+    }
   }
   reader->WritesDone();
   DLOG(INFO) << "Sending request for input \"" << text[0] << "\".";
@@ -322,6 +418,9 @@ synthesizeOnline(
   riva::utils::opus::Decoder opus_decoder(rate, 1);
 
   while (reader->Read(&chunk)) {
+    if (compression_stats) {
+      compression_stats->RecordResponse(chunk);
+    }
     // DLOG(INFO) << "Received chunk with " << chunk.audio().length() << " bytes.";
     // Copy chunk to local buffer
     size_t len = 0U;
@@ -356,28 +455,36 @@ synthesizeOnline(
   }
   grpc::Status rpc_status = reader->Finish();
   DLOG(INFO) << "Received all chunks for input \"" << text_complete << "\".";
+  sla.Record(
+      rpc_status,
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - call_start)
+          .count(),
+      static_cast<double>(audio_len) / rate);
 
   if (!rpc_status.ok()) {
-    // Report the RPC failure.
-    std::cerr << rpc_status.error_message() << std::endl;
-    std::cerr << "Input was: \'" << text_complete << "\'" << std::endl;
+    // Requests past their deadline are counted by the SLA report rather than as failures
+    if (!sla.IsLate(rpc_status)) {
+      std::cerr << rpc_status.error_message() << std::endl;
+      std::cerr << "Input was: \'" << text_complete << "\'" << std::endl;
+    }
   } else {
     *num_samples = audio_len;
     if (FLAGS_write_output_audio) {
       ::riva::utils::wav::Write(filepath, rate, buffer.data(), buffer.size());
     }
   }
+  return rpc_status;
 }
 
-std::vector<double>*
+std::vector<double>
 percentiles(std::vector<double> v)
 {
-  std::vector<double>* results = new std::vector<double>();
+  std::vector<double> results;
   if (!v.empty()) {
     std::sort(v.begin(), v.end());
-    results->push_back(v[static_cast<int>(0.90 * v.size())]);
-    results->push_back(v[static_cast<int>(0.95 * v.size())]);
-    results->push_back(v[static_cast<int>(0.99 * v.size())]);
+    results.push_back(v[static_cast<int>(0.90 * v.size())]);
+    results.push_back(v[static_cast<int>(0.95 * v.size())]);
+    results.push_back(v[static_cast<int>(0.99 * v.size())]);
   }
   return results;
 }
@@ -399,6 +506,20 @@ main(int argc, char** argv)
   str_usage << "           --online=<true|false> " << std::endl;
   str_usage << "           --audio_encoding=<pcm|opus> " << std::endl;
   str_usage << "           --num_parallel_requests=<num-parallel-reqs> " << std::endl;
+  str_usage << "           --sla_ms=<float> " << std::endl;
+  str_usage << "           --capacity_slo_ms=<float> " << std::endl;
+  str_usage << "           --capacity_percentile=<float> " << std::endl;
+  str_usage << "           --max_concurrency=<integer> " << std::endl;
+  str_usage << "           --capacity_warmup_runs=<integer> " << std::endl;
+  str_usage << "           --max_attempts=<integer> " << std::endl;
+  str_usage << "           --hedge_delay_ms=<float> " << std::endl;
+  str_usage << "           --hedge_percentile=<float> " << std::endl;
+  str_usage << "           --retry_budget=<float> " << std::endl;
+  str_usage << "           --num_connections=<integer> " << std::endl;
+  str_usage << "           --max_streams_per_connection=<integer> " << std::endl;
+  str_usage << "           --compression=<none|gzip|deflate> " << std::endl;
+  str_usage << "           --compression_min_bytes=<integer> " << std::endl;
+  str_usage << "           --compression_report=<true|false> " << std::endl;
   str_usage << "           --num_iterations=<num-iterations> " << std::endl;
   str_usage << "           --num_sentences=<num-sentences> " << std::endl;
   str_usage << "           --throttle_milliseconds=<throttle-milliseconds> " << std::endl;
@@ -406,11 +527,13 @@ main(int argc, char** argv)
   str_usage << "           --ssl_root_cert=<filename>" << std::endl;
   str_usage << "           --ssl_client_key=<filename>" << std::endl;
   str_usage << "           --ssl_client_cert=<filename>" << std::endl;
-  str_usage << "           --metadata=<key,value,...>" << std::endl;
+  str_usage << "           --metadata=<key,value,...|@filename>" << std::endl;
   str_usage << "           --zero_shot_audio_prompt=<filename>" << std::endl;
   str_usage << "           --zero_shot_quality=<quality>" << std::endl;
   str_usage << "           --zero_shot_transcript=<text>" << std::endl;
   str_usage << "           --custom_dictionary=<filename> " << std::endl;
+  str_usage << "           --prune_custom_dictionary=<true|false> " << std::endl;
+  str_usage << "           --dictionary_cache=<true|false> " << std::endl;
   str_usage << "           --custom_configuration=<key:value,key:value,...> " << std::endl;
   gflags::SetUsageMessage(str_usage.str());
   gflags::SetVersionString(::riva::utils::kBuildScmRevision);
@@ -427,6 +550,22 @@ main(int argc, char** argv)
     return 1;
   }
 
+  if (FLAGS_max_attempts < 1 || FLAGS_hedge_percentile < 0. || FLAGS_hedge_percentile > 100.) {
+    std::cerr << "max_attempts must be greater than or equal to 1 and hedge_percentile between 0 "
+                 "and 100."
+              << std::endl;
+    return 1;
+  }
+
+  if (FLAGS_capacity_slo_ms < 0. || FLAGS_capacity_percentile < 0. ||
+      FLAGS_capacity_percentile > 100. || FLAGS_max_concurrency <= 0 ||
+      FLAGS_capacity_warmup_runs < 0) {
+    std::cerr << "capacity_slo_ms must be non-negative, capacity_percentile between 0 and 100, "
+                 "max_concurrency positive and capacity_warmup_runs non-negative."
+              << std::endl;
+    return 1;
+  }
+
   bool flag_set = gflags::GetCommandLineFlagInfoOrDie("riva_uri").is_default;
   const char* riva_uri = getenv("RIVA_URI");
 
@@ -435,9 +574,6 @@ main(int argc, char** argv)
     FLAGS_riva_uri = riva_uri;
   }
 
-  std::string sentence;
-  std::vector<std::vector<std::pair<int, std::string>>> sentences;
-
   auto text_file = FLAGS_text_file;
   if (text_file.length() == 0) {
     std::cerr << "Input text file required." << std::endl;
@@ -450,213 +586,332 @@ main(int argc, char** argv)
     rate = riva::utils::opus::Decoder::AdjustRateIfUnsupported(FLAGS_rate);
   }
 
-  // create sentence vectors for each worker
-  for (int i = 0; i < FLAGS_num_parallel_requests; i++) {
-    std::vector<std::pair<int, std::string>> sentence_vec;
-    sentences.push_back(sentence_vec);
-  }
-
-  // open text file, load sentences as a vector
-  int count = 0;
-  for (int i = 0; i < FLAGS_num_iterations * FLAGS_num_sentences; i++) {
-    std::ifstream file(text_file);
-    while (std::getline(file, sentence)) {
-      if (sentence.find("|") != std::string::npos) {
-        // sentences are distributed between workers in
-        // a round-robin fashion
-        sentences[count % FLAGS_num_parallel_requests].push_back(
-            make_pair(count, sentence.substr(sentence.find("|") + 1, sentence.length())));
-      } else {
-        sentences[count % FLAGS_num_parallel_requests].push_back(make_pair(count, sentence));
-      }
-      count++;
+  grpc_compression_algorithm compression;
+  // Read once, not for every request
+  std::string custom_dictionary;
+  std::unique_ptr<riva::utils::phrases::DictionaryPruner> dictionary_pruner;
+  try {
+    compression = riva::clients::ParseCompressionAlgorithm(FLAGS_compression);
+    custom_dictionary = ReadUserDictionaryFile(FLAGS_custom_dictionary);
+    if (FLAGS_prune_custom_dictionary && !FLAGS_custom_dictionary.empty()) {
+      dictionary_pruner = std::make_unique<riva::utils::phrases::DictionaryPruner>(
+          riva::utils::phrases::Load(
+              FLAGS_custom_dictionary, riva::utils::phrases::Format::kUserDictionary,
+              FLAGS_dictionary_cache)
+              ->entries,
+          "  ");
     }
   }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
 
-  std::shared_ptr<grpc::Channel> grpc_channel;
+  // Workers take a connection of the pool of each server in turn for each request
+  std::vector<std::shared_ptr<riva::clients::ChannelPool>> channel_pools;
   try {
     auto creds = riva::clients::CreateChannelCredentials(
         FLAGS_use_ssl, FLAGS_ssl_root_cert, FLAGS_ssl_client_key, FLAGS_ssl_client_cert,
         FLAGS_metadata);
-    grpc_channel = riva::clients::CreateChannelBlocking(FLAGS_riva_uri, creds);
+    channel_pools = riva::clients::CreateChannelPools(
+        FLAGS_riva_uri, creds, FLAGS_num_connections, FLAGS_max_streams_per_connection, 10000,
+        MAX_GRPC_MESSAGE_SIZE, compression);
   }
   catch (const std::exception& e) {
     std::cerr << "Error creating GRPC channel: " << e.what() << std::endl;
     std::cerr << "Exiting." << std::endl;
     return 1;
   }
+  std::atomic<size_t> next_pool{0};
+  auto acquire_channel = [&]() {
+    return channel_pools[next_pool++ % channel_pools.size()]->Acquire();
+  };
+
+  std::unique_ptr<riva::clients::CompressionStats> compression_stats;
+  if (FLAGS_compression_report) {
+    compression_stats = std::make_unique<riva::clients::CompressionStats>(compression);
+  }
 
-  // Create and start worker threads
-  std::vector<std::thread> workers;
-  int STATUS = 0;
+  riva::clients::HedgingPolicy::Options hedging_options;
+  hedging_options.max_attempts = FLAGS_max_attempts;
+  hedging_options.hedge_delay_ms = FLAGS_hedge_delay_ms;
+  hedging_options.hedge_percentile = FLAGS_hedge_percentile;
+  hedging_options.retry_budget = FLAGS_retry_budget;
+  riva::clients::HedgingPolicy hedging(hedging_options);
+  riva::clients::SlaTracker sla(FLAGS_sla_ms);
+
+  // Synthesizes the text file num_iterations times with `concurrency` requests in flight and
+  // prints the statistics of the run, unless it is a warm-up run. Its latencies, of the first
+  // audio in online mode, and throughput are added to `sample` if not null.
+  auto run_load = [&](int32_t concurrency, riva::clients::CapacitySample* sample) {
+    bool print_stats = !FLAGS_write_output_audio && !(sample && sample->warmup);
+    std::string sentence;
+    std::vector<std::vector<std::pair<int, std::string>>> sentences;
+
+    // create sentence vectors for each worker
+    for (int i = 0; i < concurrency; i++) {
+      std::vector<std::pair<int, std::string>> sentence_vec;
+      sentences.push_back(sentence_vec);
+    }
 
-  if (FLAGS_online) {
-    if (!FLAGS_zero_shot_transcript.empty()) {
-      LOG(ERROR) << "Zero shot transcript is not supported for streaming inference.";
-      return -1;
+    // open text file, load sentences as a vector
+    int count = 0;
+    for (int i = 0; i < FLAGS_num_iterations * FLAGS_num_sentences; i++) {
+      std::ifstream file(text_file);
+      while (std::getline(file, sentence)) {
+        if (sentence.find("|") != std::string::npos) {
+          // sentences are distributed between workers in
+          // a round-robin fashion
+          sentences[count % concurrency].push_back(
+              make_pair(count, sentence.substr(sentence.find("|") + 1, sentence.length())));
+        } else {
+          sentences[count % concurrency].push_back(make_pair(count, sentence));
+        }
+        count++;
+      }
     }
-    std::vector<std::vector<double>*> latencies_first_chunk;
-    std::vector<std::vector<double>*> latencies_next_chunks;
-    std::vector<std::vector<size_t>*> lengths;
-
-    auto start = std::chrono::steady_clock::now();
-    std::vector<int> worker_sentence_idx(FLAGS_num_parallel_requests, 0);
-
-    for (int i = 0; i < FLAGS_num_parallel_requests; i++) {
-      auto time_to_first_chunks = new std::vector<double>();
-      latencies_first_chunk.push_back(time_to_first_chunks);
-      auto time_to_next_chunks = new std::vector<double>();
-      latencies_next_chunks.push_back(time_to_next_chunks);
-      auto length = new std::vector<size_t>();
-      lengths.push_back(length);
-      workers.push_back(std::thread([&, i]() {
-        usleep(i * FLAGS_offset_milliseconds * 1000);
-        auto start_time = std::chrono::steady_clock::now();
-
-        int batch_count = 0;
-        while (worker_sentence_idx[i] < sentences[i].size()) {
-          auto current_time = std::chrono::steady_clock::now();
-          double diff_time =
-              std::chrono::duration<double, std::milli>(current_time - start_time).count();
-          double wait_time = (batch_count + 1) * FLAGS_throttle_milliseconds - diff_time;
-
-          // To nanoseconds
-          wait_time *= 1.e3;
-          wait_time = std::max(wait_time, 0.);
-
-          // Round to nearest integer
-          wait_time = wait_time + 0.5 - (wait_time < 0);
-          int64_t usecs = (int64_t)wait_time;
-          // Sleep
-          if (usecs > 0) {
-            usleep(usecs);
-          }
 
-          auto tts = CreateTTS(grpc_channel);
-          double time_to_first_chunk = 0.;
-          auto time_to_next_chunk = new std::vector<double>();
+    // Create and start worker threads
+    std::vector<std::thread> workers;
+    int STATUS = 0;
+
+    if (FLAGS_online) {
+      if (!FLAGS_zero_shot_transcript.empty()) {
+        LOG(ERROR) << "Zero shot transcript is not supported for streaming inference.";
+        return -1;
+      }
+      std::vector<std::vector<double>> latencies_first_chunk(concurrency);
+      std::vector<std::vector<double>> latencies_next_chunks(concurrency);
+      std::vector<std::vector<size_t>> lengths(concurrency);
+
+      // Set by streams failing before their deadline
+      std::atomic<bool> failed{false};
+
+      auto start = std::chrono::steady_clock::now();
+      std::vector<int> worker_sentence_idx(concurrency, 0);
+
+      for (int i = 0; i < concurrency; i++) {
+        workers.push_back(std::thread([&, i]() {
+          usleep(i * FLAGS_offset_milliseconds * 1000);
+          auto start_time = std::chrono::steady_clock::now();
+
+          int batch_count = 0;
+          while (worker_sentence_idx[i] < sentences[i].size()) {
+            auto current_time = std::chrono::steady_clock::now();
+            double diff_time =
+                std::chrono::duration<double, std::milli>(current_time - start_time).count();
+            double wait_time = (batch_count + 1) * FLAGS_throttle_milliseconds - diff_time;
+
+            // To nanoseconds
+            wait_time *= 1.e3;
+            wait_time = std::max(wait_time, 0.);
+
+            // Round to nearest integer
+            wait_time = wait_time + 0.5 - (wait_time < 0);
+            int64_t usecs = (int64_t)wait_time;
+            // Sleep
+            if (usecs > 0) {
+              usleep(usecs);
+            }
 
-          std::vector<std::string> texts;
-          std::string text_complete = "";
-          int count = sentences[i][worker_sentence_idx[i]].first;
-          for (int j = 0; j < FLAGS_num_sentences; j++) {
-            if (worker_sentence_idx[i] >= sentences[i].size()) {
-              break;
+            auto lease = acquire_channel();
+            auto tts = CreateTTS(lease.Channel());
+            double time_to_first_chunk = 0.;
+            std::vector<double> time_to_next_chunk;
+
+            std::vector<std::string> texts;
+            std::string text_complete = "";
+            int count = sentences[i][worker_sentence_idx[i]].first;
+            for (int j = 0; j < FLAGS_num_sentences; j++) {
+              if (worker_sentence_idx[i] >= sentences[i].size()) {
+                break;
+              }
+              texts.push_back(sentences[i][worker_sentence_idx[i]].second);
+              text_complete += sentences[i][worker_sentence_idx[i]].second + " ";
+              worker_sentence_idx[i]++;
+            }
+            size_t num_samples = 0;
+            auto status = synthesizeOnline(
+                std::move(tts), texts, FLAGS_language, rate, FLAGS_voice_name,
+                &time_to_first_chunk, &time_to_next_chunk, &num_samples,
+                std::to_string(count) + ".wav", FLAGS_zero_shot_audio_prompt,
+                FLAGS_zero_shot_quality, FLAGS_custom_configuration, compression_stats.get(), sla);
+            // The latencies of failed streams are not the ones of the audio, late streams being
+            // counted by the SLA report
+            if (status.ok()) {
+              latencies_first_chunk[i].push_back(time_to_first_chunk);
+              latencies_next_chunks[i].insert(
+                  latencies_next_chunks[i].end(), time_to_next_chunk.begin(),
+                  time_to_next_chunk.end());
+              lengths[i].push_back(num_samples);
+            } else if (!sla.IsLate(status)) {
+              failed = true;
             }
-            texts.push_back(sentences[i][worker_sentence_idx[i]].second);
-            text_complete += sentences[i][worker_sentence_idx[i]].second + " ";
-            worker_sentence_idx[i]++;
+            batch_count++;
           }
-          size_t num_samples = 0;
-          synthesizeOnline(
-              std::move(tts), texts, FLAGS_language, rate, FLAGS_voice_name,
-              &time_to_first_chunk, time_to_next_chunk, &num_samples,
-              std::to_string(count) + ".wav", FLAGS_zero_shot_audio_prompt,
-              FLAGS_zero_shot_quality, FLAGS_custom_configuration);
-          latencies_first_chunk[i]->push_back(time_to_first_chunk);
-          latencies_next_chunks[i]->insert(
-              latencies_next_chunks[i]->end(), time_to_next_chunk->begin(),
-              time_to_next_chunk->end());
-          lengths[i]->push_back(num_samples);
-          batch_count++;
-        }
-      }));
-    }
+        }));
+      }
 
-    std::for_each(workers.begin(), workers.end(), [](std::thread& worker) { worker.join(); });
-    auto end = std::chrono::steady_clock::now();
-    std::chrono::duration<double> elapsed = end - start;
-
-    if (!FLAGS_write_output_audio) {
-      std::vector<double> first_chunks_all_threads;
-      std::vector<double> next_chunks_all_threads;
-      std::vector<double> lengths_all_threads;
-
-      for (int i = 0; i < FLAGS_num_parallel_requests; i++) {
-        // concatenate all result vectors
-        first_chunks_all_threads.insert(
-            first_chunks_all_threads.end(), latencies_first_chunk[i]->begin(),
-            latencies_first_chunk[i]->end());
-        next_chunks_all_threads.insert(
-            next_chunks_all_threads.end(), latencies_next_chunks[i]->begin(),
-            latencies_next_chunks[i]->end());
-        lengths_all_threads.insert(
-            lengths_all_threads.end(), lengths[i]->begin(), lengths[i]->end());
+      std::for_each(workers.begin(), workers.end(), [](std::thread& worker) { worker.join(); });
+      auto end = std::chrono::steady_clock::now();
+      std::chrono::duration<double> elapsed = end - start;
+      if (failed) {
+        STATUS = -1;
+      }
+      if (sample) {
+        double total_num_samples = 0.;
+        for (int i = 0; i < concurrency; i++) {
+          for (double latency : latencies_first_chunk[i]) {
+            sample->latencies.Record(1000. * latency);
+          }
+          total_num_samples += std::accumulate(lengths[i].begin(), lengths[i].end(), 0.);
+        }
+        sample->throughput = (total_num_samples / rate) / elapsed.count();
       }
 
-      if (!first_chunks_all_threads.empty() && !next_chunks_all_threads.empty()) {
-        auto results_first_chunk = percentiles(first_chunks_all_threads);
-        auto results_next_chunk = percentiles(next_chunks_all_threads);
-        auto total_num_samples =
-            std::accumulate(lengths_all_threads.begin(), lengths_all_threads.end(), 0.);
-
-        std::cout << "Latencies: " << std::endl;
-        std::cout << "First audio - average: "
-                  << std::accumulate(
-                         first_chunks_all_threads.begin(), first_chunks_all_threads.end(), 0.) /
-                         first_chunks_all_threads.size()
-                  << std::endl;
-        std::cout << "First audio - P90: " << results_first_chunk->at(0) << std::endl;
-        std::cout << "First audio - P95: " << results_first_chunk->at(1) << std::endl;
-        std::cout << "First audio - P99: " << results_first_chunk->at(2) << std::endl;
-
-        std::cout << "Chunk - average: "
-                  << std::accumulate(
-                         next_chunks_all_threads.begin(), next_chunks_all_threads.end(), 0.) /
-                         next_chunks_all_threads.size()
-                  << std::endl;
-        std::cout << "Chunk - P90: " << results_next_chunk->at(0) << std::endl;
-        std::cout << "Chunk - P95: " << results_next_chunk->at(1) << std::endl;
-        std::cout << "Chunk - P99: " << results_next_chunk->at(2) << std::endl;
-
-        std::cout << "Throughput (RTF): " << (total_num_samples / rate) / elapsed.count()
-                  << std::endl
-                  << "Total samples: " << total_num_samples << std::endl;
-      } else {
-        std::cerr << "ERROR: Metrics vector is empty, check previous error messages for details."
-                  << std::endl;
+      if (print_stats) {
+        std::vector<double> first_chunks_all_threads;
+        std::vector<double> next_chunks_all_threads;
+        std::vector<double> lengths_all_threads;
+
+        for (int i = 0; i < concurrency; i++) {
+          // concatenate all result vectors
+          first_chunks_all_threads.insert(
+              first_chunks_all_threads.end(), latencies_first_chunk[i].begin(),
+              latencies_first_chunk[i].end());
+          next_chunks_all_threads.insert(
+              next_chunks_all_threads.end(), latencies_next_chunks[i].begin(),
+              latencies_next_chunks[i].end());
+          lengths_all_threads.insert(
+              lengths_all_threads.end(), lengths[i].begin(), lengths[i].end());
+        }
+
+        if (!first_chunks_all_threads.empty() && !next_chunks_all_threads.empty()) {
+          auto results_first_chunk = percentiles(first_chunks_all_threads);
+          auto results_next_chunk = percentiles(next_chunks_all_threads);
+          auto total_num_samples =
+              std::accumulate(lengths_all_threads.begin(), lengths_all_threads.end(), 0.);
+
+          std::cout << "Latencies: " << std::endl;
+          std::cout << "First audio - average: "
+                    << std::accumulate(
+                           first_chunks_all_threads.begin(), first_chunks_all_threads.end(), 0.) /
+                           first_chunks_all_threads.size()
+                    << std::endl;
+          std::cout << "First audio - P90: " << results_first_chunk.at(0) << std::endl;
+          std::cout << "First audio - P95: " << results_first_chunk.at(1) << std::endl;
+          std::cout << "First audio - P99: " << results_first_chunk.at(2) << std::endl;
+
+          std::cout << "Chunk - average: "
+                    << std::accumulate(
+                           next_chunks_all_threads.begin(), next_chunks_all_threads.end(), 0.) /
+                           next_chunks_all_threads.size()
+                    << std::endl;
+          std::cout << "Chunk - P90: " << results_next_chunk.at(0) << std::endl;
+          std::cout << "Chunk - P95: " << results_next_chunk.at(1) << std::endl;
+          std::cout << "Chunk - P99: " << results_next_chunk.at(2) << std::endl;
+
+          std::cout << "Throughput (RTF): " << (total_num_samples / rate) / elapsed.count()
+                    << std::endl
+                    << "Total samples: " << total_num_samples << std::endl;
+        } else {
+          std::cerr << "ERROR: Metrics vector is empty, check previous error messages for details."
+                    << std::endl;
+        }
       }
-    }
-  } else {
-    std::vector<std::vector<int32_t>*> results_num_samples;
-    auto start = std::chrono::steady_clock::now();
-    for (int i = 0; i < FLAGS_num_parallel_requests; i++) {
-      auto results_num_samples_thread = new std::vector<int32_t>();
-      results_num_samples.push_back(results_num_samples_thread);
-      workers.push_back(std::thread([&, i]() {
-        int count = 0;
-        for (size_t s = 0; s < sentences[i].size(); s++) {
-          auto tts = CreateTTS(grpc_channel);
-          int32_t num_samples = synthesizeBatch(
-              std::move(tts), sentences[i][s].second, FLAGS_language, rate, FLAGS_voice_name,
-              std::to_string(count) + ".wav", FLAGS_zero_shot_audio_prompt,
-              FLAGS_zero_shot_quality, FLAGS_custom_dictionary, FLAGS_zero_shot_transcript,
-              FLAGS_custom_configuration);
-          results_num_samples[i]->push_back(num_samples);
-          count++;
+    } else {
+      std::vector<std::vector<int32_t>> results_num_samples(concurrency);
+      std::vector<std::vector<double>> request_latencies(concurrency);
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < concurrency; i++) {
+        workers.push_back(std::thread([&, i]() {
+          int count = 0;
+          for (size_t s = 0; s < sentences[i].size(); s++) {
+            auto lease = acquire_channel();
+            auto tts = CreateTTS(lease.Channel());
+            double latency_ms = 0.;
+            int32_t num_samples = synthesizeBatch(
+                std::move(tts), sentences[i][s].second, FLAGS_language, rate, FLAGS_voice_name,
+                std::to_string(count) + ".wav", FLAGS_zero_shot_audio_prompt,
+                FLAGS_zero_shot_quality, custom_dictionary, dictionary_pruner.get(),
+                FLAGS_zero_shot_transcript, FLAGS_custom_configuration, compression,
+                compression_stats.get(), &hedging, sla, &latency_ms);
+            results_num_samples[i].push_back(num_samples);
+            request_latencies[i].push_back(latency_ms);
+            count++;
+          }
+        }));
+      }
+      std::for_each(workers.begin(), workers.end(), [](std::thread& worker) { worker.join(); });
+      auto end = std::chrono::steady_clock::now();
+      // Workers get no sentence when there are fewer sentences than workers, failed requests
+      // return a negative number of samples
+      double total_num_samples = 0.;
+      for (int i = 0; i < concurrency; ++i) {
+        for (int32_t num_samples : results_num_samples[i]) {
+          if (num_samples < 0) {
+            STATUS = -1;
+          } else {
+            total_num_samples += num_samples;
+          }
         }
-      }));
-    }
-    std::for_each(workers.begin(), workers.end(), [](std::thread& worker) { worker.join(); });
-    auto end = std::chrono::steady_clock::now();
-    for (int i = 0; i < FLAGS_num_parallel_requests; ++i) {
-      if (results_num_samples[i]->front() < 0) {
-        STATUS = -1;
-        break;
       }
-    }
-    std::chrono::duration<double> elapsed = end - start;
-    if (!FLAGS_write_output_audio) {
-      double total_num_samples = 0;
-      for (int i = 0; i < FLAGS_num_parallel_requests; i++) {
-        if (results_num_samples[i]->front() >= 0) {
-          total_num_samples +=
-              std::accumulate(results_num_samples[i]->begin(), results_num_samples[i]->end(), 0.);
+      std::chrono::duration<double> elapsed = end - start;
+      if (sample) {
+        for (int i = 0; i < concurrency; i++) {
+          for (double latency : request_latencies[i]) {
+            sample->latencies.Record(latency);
+          }
         }
+        sample->throughput = (total_num_samples / rate) / elapsed.count();
       }
-      std::cout << "Average RTF: " << (total_num_samples / rate) / elapsed.count() << std::endl
-                << "Total samples: " << total_num_samples << std::endl;
+      if (print_stats) {
+        std::cout << "Average RTF: " << (total_num_samples / rate) / elapsed.count() << std::endl
+                  << "Total samples: " << total_num_samples << std::endl;
+      }
+    }
+    return STATUS;
+  };
+
+  auto run_start = std::chrono::steady_clock::now();
+  int STATUS = 0;
+  if (FLAGS_capacity_slo_ms > 0.) {
+    riva::clients::CapacitySearch::Options capacity_options;
+    capacity_options.slo_ms = FLAGS_capacity_slo_ms;
+    capacity_options.percentile = FLAGS_capacity_percentile;
+    capacity_options.max_concurrency = FLAGS_max_concurrency;
+    capacity_options.warmup_runs = FLAGS_capacity_warmup_runs;
+    riva::clients::CapacitySearch search(capacity_options);
+    int32_t capacity = search.Run([&](int32_t concurrency, riva::clients::CapacitySample& sample) {
+      return run_load(concurrency, &sample) == 0;
+    });
+    if (capacity < 0) {
+      STATUS = -1;
+    }
+    search.Print(capacity, "audio sec/sec");
+  } else {
+    STATUS = run_load(FLAGS_num_parallel_requests, nullptr);
+  }
+  for (auto& channel_pool : channel_pools) {
+    if (channel_pools.size() > 1 || channel_pool->NumConnections() > 1 ||
+        channel_pool->MaxStreamsPerConnection() > 0) {
+      channel_pool->PrintStats();
     }
   }
+  if (compression_stats) {
+    compression_stats->Print(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count());
+  }
+  if (!FLAGS_online && FLAGS_max_attempts > 1) {
+    hedging.PrintStats();
+  }
+  if (sla.Enabled()) {
+    sla.Print(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count(),
+        "audio sec");
+  }
+  if (dictionary_pruner) {
+    dictionary_pruner->PrintStats();
+  }
   return STATUS;
 }
@@ -0,0 +1,153 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "riva/utils/stats/latency_histogram.h"
+
+namespace riva::clients {
+
+/// Latencies, in milliseconds, and throughput of a run at one concurrency
+struct CapacitySample {
+  riva::utils::stats::LatencyHistogram latencies{};
+  double throughput = 0.;
+  // Whether the run only warms up the level, in which case clients need not print its statistics
+  bool warmup = false;
+};
+
+/// Search of the highest concurrency, i.e. number of requests kept in flight, at which a latency
+/// percentile stays under an SLO
+///
+/// The concurrency is doubled from 1 until the SLO breaks or the maximum is reached, then the
+/// highest passing level is found by bisection between the last passing and the first failing
+/// one. Every level is first run `warmup_runs` times without being measured so that it is
+/// measured in steady state.
+class CapacitySearch {
+ public:
+  struct Options {
+    double slo_ms = 0.;
+    double percentile = 99.;
+    int32_t max_concurrency = 256;
+    int32_t warmup_runs = 1;
+  };
+
+  /// One explored level of the curve
+  struct Level {
+    int32_t concurrency;
+    double latency_ms;
+    double throughput;
+    bool within_slo;
+  };
+
+  /// Runs the client workload at `concurrency` and fills `sample`, returns false on failure.
+  /// Warm-up runs get a sample that is discarded.
+  using MeasureFn = std::function<bool(int32_t concurrency, CapacitySample& sample)>;
+
+  explicit CapacitySearch(const Options& options) : options_(options) {}
+
+  /// Returns the highest concurrency within the SLO, 0 if even a single request in flight misses
+  /// it, or -1 if a run failed
+  int32_t Run(const MeasureFn& measure)
+  {
+    levels_.clear();
+    int32_t max_concurrency = std::max(1, options_.max_concurrency);
+    int32_t passing = 0;
+    int32_t failing = 0;
+    for (int32_t concurrency = 1;;) {
+      auto within_slo = Measure(measure, concurrency);
+      if (!within_slo.has_value()) {
+        return -1;
+      }
+      if (!*within_slo) {
+        failing = concurrency;
+        break;
+      }
+      passing = concurrency;
+      if (concurrency == max_concurrency) {
+        return passing;
+      }
+      concurrency = std::min(2 * concurrency, max_concurrency);
+    }
+
+    while (passing > 0 && failing - passing > 1) {
+      int32_t concurrency = passing + (failing - passing) / 2;
+      auto within_slo = Measure(measure, concurrency);
+      if (!within_slo.has_value()) {
+        return -1;
+      }
+      (*within_slo ? passing : failing) = concurrency;
+    }
+    return passing;
+  }
+
+  /// Explored levels, by increasing concurrency
+  std::vector<Level> Curve() const
+  {
+    std::vector<Level> curve;
+    for (auto& [concurrency, level] : levels_) {
+      curve.push_back(level);
+    }
+    return curve;
+  }
+
+  /// Prints the latency and throughput of every explored level and the capacity found
+  void Print(int32_t capacity, const std::string& throughput_unit) const
+  {
+    std::cout << "Capacity search, p" << options_.percentile << " latency SLO " << options_.slo_ms
+              << " ms:" << std::endl;
+    std::cout << std::left << std::setw(14) << "concurrency" << std::setw(16) << "latency (ms)"
+              << std::setw(16) << throughput_unit << "SLO" << std::endl;
+    for (auto& level : Curve()) {
+      std::cout << std::left << std::setw(14) << level.concurrency << std::setw(16)
+                << level.latency_ms << std::setw(16) << level.throughput
+                << (level.within_slo ? "met" : "missed") << std::endl;
+    }
+    if (capacity > 0) {
+      std::cout << "Capacity: " << capacity << " requests in flight, "
+                << levels_.at(capacity).throughput << " " << throughput_unit << std::endl;
+    } else {
+      std::cout << "Capacity: SLO missed with a single request in flight" << std::endl;
+    }
+  }
+
+ private:
+  // Returns whether the level is within the SLO, nothing if a run failed
+  std::optional<bool> Measure(const MeasureFn& measure, int32_t concurrency)
+  {
+    for (int32_t i = 0; i < options_.warmup_runs; ++i) {
+      CapacitySample warmup;
+      warmup.warmup = true;
+      if (!measure(concurrency, warmup)) {
+        return std::nullopt;
+      }
+    }
+    CapacitySample sample;
+    if (!measure(concurrency, sample)) {
+      return std::nullopt;
+    }
+    double latency_ms = sample.latencies.Percentile(options_.percentile);
+    bool within_slo = sample.latencies.count > 0 && latency_ms <= options_.slo_ms;
+    levels_[concurrency] = {concurrency, latency_ms, sample.throughput, within_slo};
+    std::cout << "Concurrency " << concurrency << ": p" << options_.percentile << " "
+              << latency_ms << " ms, " << sample.throughput << " throughput, SLO "
+              << (within_slo ? "met" : "missed") << std::endl;
+    return within_slo;
+  }
+
+  Options options_;
+  std::map<int32_t, Level> levels_;
+};
+
+}  // namespace riva::clients
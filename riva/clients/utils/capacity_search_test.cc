@@ -0,0 +1,73 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "capacity_search.h"
+
+#include "gtest/gtest.h"
+
+namespace riva::clients {
+
+// Server whose latency grows with the concurrency past `knee`
+static CapacitySearch::MeasureFn
+FakeServer(int32_t knee, std::vector<int32_t>* runs)
+{
+  return [knee, runs](int32_t concurrency, CapacitySample& sample) {
+    runs->push_back(sample.warmup ? -concurrency : concurrency);
+    double latency = concurrency <= knee ? 50. : 50. * concurrency / knee;
+    for (int i = 0; i < 100; ++i) {
+      sample.latencies.Record(latency);
+    }
+    sample.throughput = std::min(concurrency, knee) * 20.;
+    return true;
+  };
+}
+
+TEST(CapacitySearch, FindsKnee)
+{
+  CapacitySearch::Options options;
+  options.slo_ms = 60.;
+  options.max_concurrency = 64;
+  options.warmup_runs = 0;
+  CapacitySearch search(options);
+  std::vector<int32_t> runs;
+  EXPECT_EQ(search.Run(FakeServer(11, &runs)), 13);
+  // Doubling up to 16, then bisection between 8 and 16
+  EXPECT_EQ(runs, (std::vector<int32_t>{1, 2, 4, 8, 16, 12, 14, 13}));
+
+  auto curve = search.Curve();
+  ASSERT_EQ(curve.size(), runs.size());
+  EXPECT_EQ(curve.front().concurrency, 1);
+  EXPECT_EQ(curve.back().concurrency, 16);
+  EXPECT_FALSE(curve.back().within_slo);
+  EXPECT_DOUBLE_EQ(curve.front().throughput, 20.);
+}
+
+TEST(CapacitySearch, StopsAtMaximum)
+{
+  CapacitySearch::Options options;
+  options.slo_ms = 100.;
+  options.max_concurrency = 6;
+  options.warmup_runs = 1;
+  CapacitySearch search(options);
+  std::vector<int32_t> runs;
+  EXPECT_EQ(search.Run(FakeServer(100, &runs)), 6);
+  // Every level is run once to warm up, negated
+  EXPECT_EQ(runs, (std::vector<int32_t>{-1, 1, -2, 2, -4, 4, -6, 6}));
+}
+
+TEST(CapacitySearch, SloMissedOrFailure)
+{
+  CapacitySearch::Options options;
+  options.slo_ms = 10.;
+  options.warmup_runs = 0;
+  CapacitySearch search(options);
+  std::vector<int32_t> runs;
+  EXPECT_EQ(search.Run(FakeServer(4, &runs)), 0);
+  EXPECT_EQ(runs, (std::vector<int32_t>{1}));
+
+  EXPECT_EQ(search.Run([](int32_t, CapacitySample&) { return false; }), -1);
+}
+
+}  // namespace riva::clients
@@ -0,0 +1,163 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <google/protobuf/message_lite.h>
+#include <grpc/compression.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace riva::clients {
+
+// Size of the header gRPC prepends to every message (compressed flag and length)
+constexpr size_t kGrpcMessageHeaderBytes = 5;
+// HTTP/2 DATA frames carry at most 16 KiB by default, each with a 9 byte header
+constexpr size_t kHttp2MaxFrameBytes = 16384;
+constexpr size_t kHttp2FrameHeaderBytes = 9;
+
+/// Utility function to estimate the number of bytes a serialized message takes on the wire
+/// when sent with the given compression. Like gRPC, falls back to the uncompressed message when
+/// compression does not make it smaller. TLS overhead and HTTP/2 headers are not counted
+inline size_t
+EstimateWireBytes(const std::string& payload, grpc_compression_algorithm compression)
+{
+  size_t message_bytes = payload.size();
+  if (compression == GRPC_COMPRESS_GZIP || compression == GRPC_COMPRESS_DEFLATE) {
+    // Same zlib parameters as the gRPC message compression
+    z_stream stream{};
+    int window_bits = 15 | (compression == GRPC_COMPRESS_GZIP ? 16 : 0);
+    int status = deflateInit2(
+        &stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+    if (status == Z_OK) {
+      thread_local std::vector<Bytef> buffer;
+      buffer.resize(deflateBound(&stream, payload.size()));
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(payload.data()));
+      stream.avail_in = payload.size();
+      stream.next_out = buffer.data();
+      stream.avail_out = buffer.size();
+      if (deflate(&stream, Z_FINISH) == Z_STREAM_END) {
+        message_bytes = std::min<size_t>(message_bytes, stream.total_out);
+      }
+      deflateEnd(&stream);
+    }
+  }
+  message_bytes += kGrpcMessageHeaderBytes;
+  size_t num_frames = (message_bytes + kHttp2MaxFrameBytes - 1) / kHttp2MaxFrameBytes;
+  return message_bytes + num_frames * kHttp2FrameHeaderBytes;
+}
+
+/// Bandwidth and client CPU accounting for a run with a given compression
+///
+/// Every message recorded is serialized and compressed once more to estimate its size on the
+/// wire, since gRPC does not report it. The CPU time spent on that estimation is measured and
+/// left out of the client CPU time reported by Print, which is taken from getrusage() between
+/// construction and Print. Responses are estimated as if the server used the same compression,
+/// which only holds if the server is configured to compress. All methods are thread safe.
+class CompressionStats {
+ public:
+  struct Direction {
+    uint64_t messages = 0;
+    uint64_t payload_bytes = 0;
+    uint64_t wire_bytes = 0;
+  };
+
+  explicit CompressionStats(grpc_compression_algorithm compression) : compression_(compression)
+  {
+    getrusage(RUSAGE_SELF, &start_usage_);
+  }
+
+  void RecordRequest(const google::protobuf::MessageLite& message) { Record(message, requests_); }
+
+  void RecordResponse(const google::protobuf::MessageLite& message) { Record(message, responses_); }
+
+  Direction Requests() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_;
+  }
+
+  Direction Responses() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return responses_;
+  }
+
+  /// CPU time (in seconds) spent estimating wire sizes
+  double AccountingCpuTime() const { return accounting_ns_.load() * 1.e-9; }
+
+  void Print(double run_time_sec) const
+  {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double user_sec = Seconds(usage.ru_utime) - Seconds(start_usage_.ru_utime);
+    double system_sec = Seconds(usage.ru_stime) - Seconds(start_usage_.ru_stime);
+    double client_sec = user_sec + system_sec - AccountingCpuTime();
+
+    const char* name = nullptr;
+    grpc_compression_algorithm_name(compression_, &name);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::cout << "Compression: " << (name ? name : "unknown") << std::endl;
+    std::cout << "\t\tMessages\tPayload bytes\tWire bytes (est.)\tRatio\tWire MB/s" << std::endl;
+    for (auto& [label, direction] :
+         {std::make_pair("Requests", &requests_), std::make_pair("Responses", &responses_)}) {
+      std::cout << "\t" << label << "\t" << direction->messages << "\t\t"
+                << direction->payload_bytes << "\t\t" << direction->wire_bytes << "\t\t"
+                << std::fixed << std::setprecision(3)
+                << (direction->payload_bytes
+                        ? static_cast<double>(direction->wire_bytes) / direction->payload_bytes
+                        : 0.)
+                << "\t"
+                << (run_time_sec > 0. ? direction->wire_bytes / run_time_sec / 1.e6 : 0.)
+                << std::defaultfloat << std::endl;
+    }
+    std::cout << "Client CPU time: " << client_sec << " sec (user " << user_sec << ", system "
+              << system_sec << ", " << AccountingCpuTime()
+              << " of accounting excluded), average cores used: "
+              << (run_time_sec > 0. ? client_sec / run_time_sec : 0.) << std::endl;
+  }
+
+ private:
+  static double Seconds(const timeval& tv) { return tv.tv_sec + tv.tv_usec * 1.e-6; }
+
+  static int64_t ThreadCpuNs()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  void Record(const google::protobuf::MessageLite& message, Direction& direction)
+  {
+    int64_t start_ns = ThreadCpuNs();
+    std::string payload = message.SerializeAsString();
+    size_t wire_bytes = EstimateWireBytes(payload, compression_);
+    accounting_ns_ += ThreadCpuNs() - start_ns;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    direction.messages++;
+    direction.payload_bytes += payload.size();
+    direction.wire_bytes += wire_bytes;
+  }
+
+  grpc_compression_algorithm compression_;
+  rusage start_usage_;
+  std::atomic<int64_t> accounting_ns_{0};
+  mutable std::mutex mutex_;
+  Direction requests_;
+  Direction responses_;
+};
+
+}  // namespace riva::clients
@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "compression_stats.h"
+
+#include <google/protobuf/wrappers.pb.h>
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+namespace riva::clients {
+
+TEST(CompressionStats, UncompressedWireBytes)
+{
+  EXPECT_EQ(EstimateWireBytes("", GRPC_COMPRESS_NONE), 5U + 9U);
+  EXPECT_EQ(EstimateWireBytes(std::string(100, 'a'), GRPC_COMPRESS_NONE), 105U + 9U);
+  // A message split over several HTTP/2 frames
+  EXPECT_EQ(EstimateWireBytes(std::string(40000, 'a'), GRPC_COMPRESS_NONE), 40005U + 3 * 9U);
+}
+
+TEST(CompressionStats, CompressedWireBytes)
+{
+  std::string repetitive;
+  for (int i = 0; i < 1000; ++i) {
+    repetitive += "the quick brown fox jumps over the lazy dog ";
+  }
+  size_t gzip = EstimateWireBytes(repetitive, GRPC_COMPRESS_GZIP);
+  size_t deflate = EstimateWireBytes(repetitive, GRPC_COMPRESS_DEFLATE);
+  EXPECT_LT(gzip, repetitive.size() / 10);
+  // zlib wrapper is smaller than the gzip one
+  EXPECT_LT(deflate, gzip);
+
+  // Random bytes do not compress, gRPC then sends them as is
+  std::mt19937 generator(0);
+  std::string noise(10000, '\0');
+  for (auto& c : noise) {
+    c = static_cast<char>(generator());
+  }
+  EXPECT_EQ(
+      EstimateWireBytes(noise, GRPC_COMPRESS_GZIP), EstimateWireBytes(noise, GRPC_COMPRESS_NONE));
+}
+
+TEST(CompressionStats, Record)
+{
+  CompressionStats stats(GRPC_COMPRESS_GZIP);
+  google::protobuf::StringValue message;
+  message.set_value(std::string(1000, 'a'));
+  stats.RecordRequest(message);
+  stats.RecordRequest(message);
+  stats.RecordResponse(message);
+
+  auto requests = stats.Requests();
+  EXPECT_EQ(requests.messages, 2U);
+  EXPECT_EQ(requests.payload_bytes, 2 * message.ByteSizeLong());
+  EXPECT_LT(requests.wire_bytes, requests.payload_bytes);
+  auto responses = stats.Responses();
+  EXPECT_EQ(responses.messages, 1U);
+  EXPECT_EQ(responses.payload_bytes, message.ByteSizeLong());
+  EXPECT_GT(stats.AccountingCpuTime(), 0.);
+}
+
+}  // namespace riva::clients
@@ -0,0 +1,223 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "riva/utils/stats/latency_histogram.h"
+
+namespace riva::clients {
+
+/// How EndpointBalancer picks the server of the next request
+enum class BalancePolicy {
+  kRoundRobin,        // endpoints in turn
+  kLeastOutstanding,  // endpoint with the fewest requests or streams in flight
+  kLatencyWeighted,   // endpoint with the lowest recent latency times requests in flight
+};
+
+/// Utility function to convert a policy name (round_robin, least_outstanding or
+/// latency_weighted) to a BalancePolicy. Throws an error if the name is not recognized
+inline BalancePolicy
+ParseBalancePolicy(const std::string& name)
+{
+  if (name == "round_robin") {
+    return BalancePolicy::kRoundRobin;
+  } else if (name == "least_outstanding") {
+    return BalancePolicy::kLeastOutstanding;
+  } else if (name == "latency_weighted") {
+    return BalancePolicy::kLatencyWeighted;
+  }
+  throw std::runtime_error(
+      "Unknown balancing policy " + name +
+      " (expected round_robin, least_outstanding or latency_weighted)");
+}
+
+/// Client-side load balancer over several server endpoints
+///
+/// Every request or stream is bracketed by Acquire, which returns the index of the endpoint to
+/// use, and Release, which reports how it went. An endpoint that fails `max_failures` times in a
+/// row is ejected for `ejection_time`; it then gets requests again and is ejected again on its
+/// next failure, until one succeeds. If every endpoint is ejected, the one coming back first is
+/// used rather than blocking. Per-endpoint counters and latency histograms are kept for
+/// PrintStats. All methods are thread safe.
+class EndpointBalancer {
+ public:
+  struct Options {
+    int32_t max_failures = 3;
+    std::chrono::milliseconds ejection_time = std::chrono::milliseconds(10000);
+    // Weight of the newest sample in the latency moving average
+    double latency_smoothing = 0.2;
+  };
+
+  struct EndpointStats {
+    std::string uri;
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+    uint32_t outstanding = 0;
+    uint32_t ejections = 0;
+    double work = 0.;
+    riva::utils::stats::LatencyHistogram latencies{};
+  };
+
+  EndpointBalancer(
+      const std::vector<std::string>& uris, BalancePolicy policy, const Options& options)
+      : policy_(policy), options_(options), endpoints_(uris.size())
+  {
+    if (uris.empty()) {
+      throw std::runtime_error("At least one endpoint is required");
+    }
+    for (size_t i = 0; i < uris.size(); ++i) {
+      endpoints_[i].stats.uri = uris[i];
+    }
+  }
+
+  EndpointBalancer(const std::vector<std::string>& uris, BalancePolicy policy)
+      : EndpointBalancer(uris, policy, Options())
+  {
+  }
+
+  size_t NumEndpoints() const { return endpoints_.size(); }
+
+  const std::string& Uri(size_t endpoint) const { return endpoints_[endpoint].stats.uri; }
+
+  /// Picks the endpoint of the next request and counts the request as outstanding on it
+  size_t Acquire()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    size_t num_endpoints = endpoints_.size();
+    size_t first = next_++ % num_endpoints;
+
+    size_t best = num_endpoints;
+    double best_cost = 0.;
+    for (size_t n = 0; n < num_endpoints; ++n) {
+      size_t i = (first + n) % num_endpoints;
+      auto& endpoint = endpoints_[i];
+      if (endpoint.ejected_until > now) {
+        continue;
+      }
+      double cost = 0.;
+      if (policy_ == BalancePolicy::kLeastOutstanding) {
+        cost = endpoint.stats.outstanding;
+      } else if (policy_ == BalancePolicy::kLatencyWeighted) {
+        // Endpoints without a latency sample yet look free so that they get one
+        cost = endpoint.latency_average * (endpoint.stats.outstanding + 1);
+      }
+      if (best == num_endpoints || cost < best_cost) {
+        best = i;
+        best_cost = cost;
+      }
+      if (policy_ == BalancePolicy::kRoundRobin) {
+        break;
+      }
+    }
+
+    if (best == num_endpoints) {
+      best = std::min_element(
+                 endpoints_.begin(), endpoints_.end(),
+                 [](const Endpoint& a, const Endpoint& b) {
+                   return a.ejected_until < b.ejected_until;
+                 }) -
+             endpoints_.begin();
+    }
+    endpoints_[best].stats.outstanding++;
+    return best;
+  }
+
+  /// Reports the end of a request started with Acquire
+  ///
+  /// @param endpoint Index returned by Acquire
+  /// @param success Whether the request succeeded
+  /// @param latency_ms Latency of the request, only used when it succeeded
+  /// @param work Amount of work done by the request (audio seconds, characters...), summed for the
+  /// per-endpoint throughput
+  void Release(size_t endpoint, bool success, double latency_ms, double work = 0.)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& e = endpoints_[endpoint];
+    e.stats.outstanding--;
+    e.stats.requests++;
+    if (success) {
+      e.consecutive_failures = 0;
+      e.stats.work += work;
+      e.stats.latencies.Record(latency_ms);
+      e.latency_average = e.stats.latencies.count == 1
+                              ? latency_ms
+                              : options_.latency_smoothing * latency_ms +
+                                    (1. - options_.latency_smoothing) * e.latency_average;
+      return;
+    }
+    e.stats.failures++;
+    if (++e.consecutive_failures >= options_.max_failures) {
+      e.ejected_until = std::chrono::steady_clock::now() + options_.ejection_time;
+      e.stats.ejections++;
+      LOG(WARNING) << "Ejecting endpoint " << e.stats.uri << " after " << e.consecutive_failures
+                   << " consecutive failures";
+    }
+  }
+
+  /// Ends a request started with Acquire without counting it, e.g. a hedged attempt cancelled
+  /// because another one answered first
+  void Abandon(size_t endpoint)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    endpoints_[endpoint].stats.outstanding--;
+  }
+
+  EndpointStats Stats(size_t endpoint) const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return endpoints_[endpoint].stats;
+  }
+
+  /// Prints one line per endpoint: requests, failures, ejections, throughput and latencies
+  ///
+  /// @param run_time_sec Duration of the run the throughput is computed over
+  /// @param work_unit Name of the unit of the work passed to Release, per second
+  void PrintStats(double run_time_sec, const std::string& work_unit) const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::cout << std::setprecision(5);
+    std::cout << "Per endpoint statistics:\n";
+    std::cout << "\tEndpoint\tRequests\tFailures\tEjections\tRequests/s\t" << work_unit
+              << "\tMedian (ms)\t90th (ms)\t99th (ms)\n";
+    for (auto& endpoint : endpoints_) {
+      auto& stats = endpoint.stats;
+      std::cout << "\t" << stats.uri << "\t" << stats.requests << "\t\t" << stats.failures
+                << "\t\t" << stats.ejections << "\t\t" << stats.requests / run_time_sec << "\t\t"
+                << stats.work / run_time_sec << "\t\t" << stats.latencies.Percentile(50.)
+                << "\t\t" << stats.latencies.Percentile(90.) << "\t\t"
+                << stats.latencies.Percentile(99.) << "\n";
+    }
+    std::cout << std::flush;
+  }
+
+ private:
+  struct Endpoint {
+    EndpointStats stats;
+    int32_t consecutive_failures = 0;
+    double latency_average = 0.;
+    std::chrono::steady_clock::time_point ejected_until;
+  };
+
+  BalancePolicy policy_;
+  Options options_;
+  std::vector<Endpoint> endpoints_;
+  size_t next_ = 0;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace riva::clients
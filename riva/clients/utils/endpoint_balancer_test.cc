@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "endpoint_balancer.h"
+
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace riva::clients {
+
+static const std::vector<std::string> kUris = {"a:50051", "b:50051", "c:50051"};
+
+TEST(EndpointBalancer, ParsePolicy)
+{
+  EXPECT_EQ(ParseBalancePolicy("round_robin"), BalancePolicy::kRoundRobin);
+  EXPECT_EQ(ParseBalancePolicy("least_outstanding"), BalancePolicy::kLeastOutstanding);
+  EXPECT_EQ(ParseBalancePolicy("latency_weighted"), BalancePolicy::kLatencyWeighted);
+  EXPECT_THROW(ParseBalancePolicy("random"), std::runtime_error);
+}
+
+TEST(EndpointBalancer, RoundRobin)
+{
+  EndpointBalancer balancer(kUris, BalancePolicy::kRoundRobin);
+  for (size_t i = 0; i < 6; ++i) {
+    EXPECT_EQ(balancer.Acquire(), i % 3);
+  }
+}
+
+TEST(EndpointBalancer, LeastOutstanding)
+{
+  EndpointBalancer balancer(kUris, BalancePolicy::kLeastOutstanding);
+  // One request in flight on every endpoint, then the second endpoint completes its own
+  for (size_t i = 0; i < 3; ++i) {
+    balancer.Acquire();
+  }
+  balancer.Release(1, true, 10.);
+  EXPECT_EQ(balancer.Acquire(), 1U);
+  EXPECT_EQ(balancer.Stats(1).outstanding, 1U);
+  EXPECT_EQ(balancer.Stats(0).outstanding, 1U);
+
+  // Abandoned requests free their slot without being counted
+  balancer.Abandon(2);
+  EXPECT_EQ(balancer.Acquire(), 2U);
+  EXPECT_EQ(balancer.Stats(2).requests, 0U);
+}
+
+TEST(EndpointBalancer, LatencyWeighted)
+{
+  EndpointBalancer balancer(kUris, BalancePolicy::kLatencyWeighted);
+  for (size_t i = 0; i < 3; ++i) {
+    size_t endpoint = balancer.Acquire();
+    balancer.Release(endpoint, true, endpoint == 2 ? 10. : 100.);
+  }
+  // The fast endpoint takes requests until its expected wait, 10 ms * (outstanding + 1), reaches
+  // the 100 ms of the idle slow endpoints
+  size_t on_fast = 0;
+  while (balancer.Acquire() == 2U) {
+    ++on_fast;
+  }
+  EXPECT_GE(on_fast, 9U);
+  EXPECT_LE(on_fast, 10U);
+}
+
+TEST(EndpointBalancer, EjectionAfterFailures)
+{
+  EndpointBalancer::Options options;
+  options.max_failures = 2;
+  options.ejection_time = std::chrono::milliseconds(100);
+  EndpointBalancer balancer(kUris, BalancePolicy::kRoundRobin, options);
+
+  balancer.Release(balancer.Acquire(), false, 0.);
+  balancer.Acquire();
+  balancer.Acquire();
+  balancer.Release(balancer.Acquire(), false, 0.);
+  EXPECT_EQ(balancer.Stats(0).ejections, 1U);
+  for (size_t i = 0; i < 6; ++i) {
+    EXPECT_NE(balancer.Acquire(), 0U);
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  bool used = false;
+  for (size_t i = 0; i < 3; ++i) {
+    used = used || balancer.Acquire() == 0U;
+  }
+  EXPECT_TRUE(used);
+}
+
+TEST(EndpointBalancer, AllEjected)
+{
+  EndpointBalancer::Options options;
+  options.max_failures = 1;
+  EndpointBalancer balancer({"a:50051", "b:50051"}, BalancePolicy::kLeastOutstanding, options);
+  balancer.Release(0, false, 0.);
+  balancer.Release(1, false, 0.);
+  // Never blocks, the endpoint ejected first comes back first
+  EXPECT_EQ(balancer.Acquire(), 0U);
+}
+
+TEST(EndpointBalancer, Stats)
+{
+  EndpointBalancer balancer({"a:50051"}, BalancePolicy::kRoundRobin);
+  for (int i = 1; i <= 4; ++i) {
+    balancer.Release(balancer.Acquire(), i != 4, 10. * i, 2.);
+  }
+  auto stats = balancer.Stats(0);
+  EXPECT_EQ(stats.uri, "a:50051");
+  EXPECT_EQ(stats.requests, 4U);
+  EXPECT_EQ(stats.failures, 1U);
+  EXPECT_EQ(stats.outstanding, 0U);
+  EXPECT_DOUBLE_EQ(stats.work, 6.);
+  EXPECT_EQ(stats.latencies.count, 3U);
+}
+
+}  // namespace riva::clients
@@ -9,11 +9,25 @@
 #include <glog/logging.h>
 #include <grpcpp/grpcpp.h>
 #include <strings.h>
+#include <sys/stat.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "riva/utils/files/files.h"
+#include "riva/utils/stats/latency_histogram.h"
 #include "riva/utils/string_processing.h"
 
 constexpr int MAX_GRPC_MESSAGE_SIZE = 128 * 1024 * 1024;
@@ -23,27 +37,149 @@ using grpc::StatusCode;
 
 namespace riva::clients {
 
+using MetadataPairs = std::vector<std::pair<std::string, std::string>>;
+
+/// Utility function to parse comma separated metadata keys and values ("key1,value1,key2,...").
+/// Throws an error if a key has no value
+inline MetadataPairs
+ParseMetadata(const std::string& metadata)
+{
+  std::string metadata_copy = metadata;
+  auto key_value_pairs = split(metadata_copy, ',');
+  if (key_value_pairs.size() % 2) {
+    throw std::runtime_error("Error: metadata must contain key value pairs.");
+  }
+  MetadataPairs pairs;
+  for (size_t i = 0; i < key_value_pairs.size(); i += 2) {
+    pairs.emplace_back(key_value_pairs[i], key_value_pairs[i + 1]);
+  }
+  return pairs;
+}
+
+/// Adds the same metadata to every call. The metadata is parsed once, on construction
 class CustomAuthenticator : public grpc::MetadataCredentialsPlugin {
  public:
-  CustomAuthenticator(const std::string& metadata) : metadata_(metadata) {}
+  CustomAuthenticator(const std::string& metadata) : metadata_(ParseMetadata(metadata)) {}
+
+  // Only copies strings, no need for gRPC to run it on a separate thread
+  bool IsBlocking() const override { return false; }
 
   grpc::Status GetMetadata(
       grpc::string_ref service_url, grpc::string_ref method_name,
       const grpc::AuthContext& channel_auth_context,
       std::multimap<grpc::string, grpc::string>* metadata) override
   {
-    auto key_value_pairs = split(metadata_, ',');
-    if (key_value_pairs.size() % 2) {
-      throw std::runtime_error("Error: metadata must contain key value pairs.");
+    metadata->insert(metadata_.begin(), metadata_.end());
+    return grpc::Status::OK;
+  }
+
+ private:
+  const MetadataPairs metadata_;
+};
+
+/// Adds the metadata read from a file to every call, picking up the new content when the file
+/// changes, e.g. when a bearer token is rotated
+///
+/// The file holds the same comma separated keys and values as the --metadata flag; leading and
+/// trailing whitespace, such as the final line break, is ignored. A watcher thread checks the
+/// file once per `check_interval`, never if it is 0, and reloads it when its modification time,
+/// size or inode changed, so writing the new content to a temporary file and renaming it over
+/// the old one is safe. The parsed metadata is swapped atomically: calls in flight keep the
+/// version they started with. If the new content cannot be read or parsed, the previous metadata
+/// stays in use. Throws on construction if the file cannot be loaded.
+class FileMetadataAuthenticator : public grpc::MetadataCredentialsPlugin {
+ public:
+  explicit FileMetadataAuthenticator(
+      const std::string& path,
+      std::chrono::milliseconds check_interval = std::chrono::milliseconds(1000))
+      : path_(path)
+  {
+    if (!Reload()) {
+      throw std::runtime_error("Unable to load metadata from " + path);
+    }
+    if (check_interval.count() > 0) {
+      watcher_ = std::thread([this, check_interval]() {
+        std::unique_lock<std::mutex> lock(stop_mutex_);
+        while (!stop_cv_.wait_for(lock, check_interval, [this]() { return stop_; })) {
+          Reload();
+        }
+      });
+    }
+  }
+
+  ~FileMetadataAuthenticator()
+  {
+    {
+      std::lock_guard<std::mutex> lock(stop_mutex_);
+      stop_ = true;
     }
-    for (size_t i = 0; i < key_value_pairs.size(); i += 2) {
-      metadata->insert(std::make_pair(key_value_pairs.at(i), key_value_pairs.at(i + 1)));
+    stop_cv_.notify_all();
+    if (watcher_.joinable()) {
+      watcher_.join();
     }
+  }
+
+  // The file is only read by the watcher thread, calls just copy the current metadata
+  bool IsBlocking() const override { return false; }
+
+  grpc::Status GetMetadata(
+      grpc::string_ref service_url, grpc::string_ref method_name,
+      const grpc::AuthContext& channel_auth_context,
+      std::multimap<grpc::string, grpc::string>* metadata) override
+  {
+    auto current = Metadata();
+    metadata->insert(current->begin(), current->end());
     return grpc::Status::OK;
   }
 
+  /// Current metadata, as of the last load of the file
+  std::shared_ptr<const MetadataPairs> Metadata() const { return std::atomic_load(&metadata_); }
+
+  /// Reloads the file if it changed since the last load. Returns false if it could not be loaded
+  bool Reload()
+  {
+    std::lock_guard<std::mutex> lock(reload_mutex_);
+    struct stat file_stat;
+    if (stat(path_.c_str(), &file_stat) != 0) {
+      LOG(WARNING) << "Unable to stat metadata file " << path_;
+      return false;
+    }
+    if (std::atomic_load(&metadata_) && file_stat.st_mtim.tv_sec == stat_.st_mtim.tv_sec &&
+        file_stat.st_mtim.tv_nsec == stat_.st_mtim.tv_nsec &&
+        file_stat.st_size == stat_.st_size && file_stat.st_ino == stat_.st_ino) {
+      return true;
+    }
+    try {
+      std::string content = riva::utils::files::ReadFileContentAsString(path_);
+      auto is_space = [](char c) { return std::isspace(static_cast<unsigned char>(c)); };
+      content.erase(
+          std::find_if_not(content.rbegin(), content.rend(), is_space).base(), content.end());
+      content.erase(content.begin(), std::find_if_not(content.begin(), content.end(), is_space));
+      auto metadata = std::make_shared<const MetadataPairs>(ParseMetadata(content));
+      std::atomic_store(&metadata_, metadata);
+      stat_ = file_stat;
+      num_reloads_++;
+      return true;
+    }
+    catch (const std::exception& e) {
+      LOG(WARNING) << "Keeping previous metadata, unable to load " << path_ << ": " << e.what();
+      return false;
+    }
+  }
+
+  /// Number of times the metadata was (re)loaded
+  uint64_t NumReloads() const { return num_reloads_.load(); }
+
  private:
-  std::string metadata_;
+  const std::string path_;
+  std::shared_ptr<const MetadataPairs> metadata_;
+  std::mutex reload_mutex_;
+  struct stat stat_ = {};
+  std::atomic<uint64_t> num_reloads_{0};
+  std::thread watcher_;
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cv_;
+  bool stop_ = false;
 };
 
 /// Utility function to create a GRPC channel
@@ -54,15 +190,13 @@ class CustomAuthenticator : public grpc::MetadataCredentialsPlugin {
 /// @param credentials GRPC credentials
 /// @param timeout_ms The maximum time (in milliseconds) to wait for channel creation. Throws
 /// exception if time is exceeded
+/// @param channel_args Arguments of the channel
 
-std::shared_ptr<grpc::Channel>
+inline std::shared_ptr<grpc::Channel>
 CreateChannelBlocking(
     const std::string& uri, const std::shared_ptr<grpc::ChannelCredentials> credentials,
-    uint64_t timeout_ms = 10000, uint64_t max_grpc_message_size = MAX_GRPC_MESSAGE_SIZE)
+    uint64_t timeout_ms, const grpc::ChannelArguments& channel_args)
 {
-  grpc::ChannelArguments channel_args;
-  channel_args.SetMaxReceiveMessageSize(max_grpc_message_size);
-  channel_args.SetMaxSendMessageSize(max_grpc_message_size);
   auto channel = grpc::CreateCustomChannel(uri, credentials, channel_args);
 
   auto deadline = std::chrono::system_clock::now() + std::chrono::milliseconds(timeout_ms);
@@ -78,11 +212,73 @@ CreateChannelBlocking(
   return channel;
 }
 
+/// @param compression Default compression of the messages sent on the channel, see
+/// ParseCompressionAlgorithm
+inline std::shared_ptr<grpc::Channel>
+CreateChannelBlocking(
+    const std::string& uri, const std::shared_ptr<grpc::ChannelCredentials> credentials,
+    uint64_t timeout_ms = 10000, uint64_t max_grpc_message_size = MAX_GRPC_MESSAGE_SIZE,
+    grpc_compression_algorithm compression = GRPC_COMPRESS_NONE)
+{
+  grpc::ChannelArguments channel_args;
+  channel_args.SetMaxReceiveMessageSize(max_grpc_message_size);
+  channel_args.SetMaxSendMessageSize(max_grpc_message_size);
+  channel_args.SetCompressionAlgorithm(compression);
+  return CreateChannelBlocking(uri, credentials, timeout_ms, channel_args);
+}
+
+/// Utility function to convert a compression name (none, gzip or deflate) to the GRPC algorithm.
+/// Throws an error if the name is not recognized
+///
+/// The algorithm only applies to the messages sent by the client. Responses are compressed if
+/// the server is configured to do so; the client always advertises that it accepts all
+/// algorithms
+inline grpc_compression_algorithm
+ParseCompressionAlgorithm(const std::string& name)
+{
+  if (name.empty() || name == "none") {
+    return GRPC_COMPRESS_NONE;
+  } else if (name == "gzip") {
+    return GRPC_COMPRESS_GZIP;
+  } else if (name == "deflate") {
+    return GRPC_COMPRESS_DEFLATE;
+  }
+  throw std::runtime_error("Unknown compression " + name + " (expected none, gzip or deflate)");
+}
+
+/// Utility function to override the channel default compression for one call. Requests smaller
+/// than `min_bytes` are sent uncompressed: compressing them costs more client and server CPU
+/// than it saves on the wire
+inline void
+SetCallCompression(
+    grpc::ClientContext& context, grpc_compression_algorithm compression, size_t request_bytes,
+    size_t min_bytes = 0)
+{
+  context.set_compression_algorithm(request_bytes < min_bytes ? GRPC_COMPRESS_NONE : compression);
+}
+
+/// Utility function to split a comma separated list of server URIs
+inline std::vector<std::string>
+SplitUris(const std::string& uris)
+{
+  std::vector<std::string> result;
+  std::string uri;
+  std::istringstream uri_stream(uris);
+  while (std::getline(uri_stream, uri, ',')) {
+    if (!uri.empty()) {
+      result.push_back(uri);
+    }
+  }
+  return result;
+}
+
 /// Utility function to create GRPC credentials
 /// Returns shared ptr to GrpcChannelCredentials
 /// @param use_ssl Boolean flag that controls if ssl encryption should be used
 /// @param ssl_cert Path to the certificate file
-std::shared_ptr<grpc::ChannelCredentials>
+/// @param metadata Comma separated keys and values sent with every call, or @ followed by the
+/// path of a file holding them, reloaded when it changes (see FileMetadataAuthenticator)
+inline std::shared_ptr<grpc::ChannelCredentials>
 CreateChannelCredentials(
     bool use_ssl, const std::string& ssl_root_cert, const std::string& ssl_client_key,
     const std::string& ssl_client_cert, const std::string& metadata)
@@ -110,13 +306,228 @@ CreateChannelCredentials(
   }
 
   if (!metadata.empty()) {
-    auto call_creds =
-        grpc::MetadataCredentialsFromPlugin(std::unique_ptr<grpc::MetadataCredentialsPlugin>(
-            new riva::clients::CustomAuthenticator(metadata)));
+    std::unique_ptr<grpc::MetadataCredentialsPlugin> plugin;
+    if (metadata[0] == '@') {
+      plugin = std::make_unique<riva::clients::FileMetadataAuthenticator>(metadata.substr(1));
+    } else {
+      plugin = std::make_unique<riva::clients::CustomAuthenticator>(metadata);
+    }
+    auto call_creds = grpc::MetadataCredentialsFromPlugin(std::move(plugin));
     creds = grpc::CompositeChannelCredentials(creds, call_creds);
   }
 
   return creds;
 }
 
+/// Pool of distinct connections to one server
+///
+/// All the RPCs of a channel share one HTTP/2 connection, and the streams above the server's
+/// max concurrent streams setting wait inside the client, which looks like server latency. The
+/// pool opens `num_connections` channels with a local subchannel pool each, hence one connection
+/// each, and gives every new RPC the connection with the fewest RPCs in flight. When
+/// `max_streams_per_connection` is set, Acquire waits for a free stream slot instead of
+/// overcommitting a connection, and the time spent waiting is measured and reported.
+class ChannelPool {
+ public:
+  /// A stream slot on one connection, held for the duration of an RPC
+  class Lease {
+   public:
+    Lease() = default;
+    Lease(ChannelPool* pool, size_t connection, double wait_ms)
+        : pool_(pool), connection_(connection), wait_ms_(wait_ms)
+    {
+    }
+    Lease(Lease&& other) { *this = std::move(other); }
+    Lease& operator=(Lease&& other)
+    {
+      Reset();
+      std::swap(pool_, other.pool_);
+      connection_ = other.connection_;
+      wait_ms_ = other.wait_ms_;
+      return *this;
+    }
+    ~Lease() { Reset(); }
+
+    std::shared_ptr<grpc::Channel> Channel() const { return pool_->Channel(connection_); }
+    size_t Connection() const { return connection_; }
+    /// Time spent in Acquire waiting for a free stream slot
+    double WaitMs() const { return wait_ms_; }
+
+    /// Gives the slot back, also done on destruction
+    void Reset()
+    {
+      if (pool_) {
+        pool_->Release(connection_);
+        pool_ = nullptr;
+      }
+    }
+
+   private:
+    ChannelPool* pool_ = nullptr;
+    size_t connection_ = 0;
+    double wait_ms_ = 0.;
+  };
+
+  /// Creates the channels, without waiting for them to connect
+  ///
+  /// @param max_streams_per_connection Maximum number of RPCs in flight per connection, 0 for no
+  /// limit. Set it to the server's max concurrent streams to make client-side queuing visible
+  /// @param compression Default compression of the messages sent on the connections
+  ChannelPool(
+      const std::string& uri, const std::shared_ptr<grpc::ChannelCredentials> credentials,
+      int32_t num_connections, int32_t max_streams_per_connection = 0,
+      uint64_t max_grpc_message_size = MAX_GRPC_MESSAGE_SIZE,
+      grpc_compression_algorithm compression = GRPC_COMPRESS_NONE)
+      : uri_(uri), max_streams_per_connection_(max_streams_per_connection)
+  {
+    for (int32_t i = 0; i < std::max(num_connections, 1); ++i) {
+      grpc::ChannelArguments channel_args;
+      channel_args.SetMaxReceiveMessageSize(max_grpc_message_size);
+      channel_args.SetMaxSendMessageSize(max_grpc_message_size);
+      channel_args.SetCompressionAlgorithm(compression);
+      // Without it, channels to the same server with the same arguments share one connection
+      channel_args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+      connections_.emplace_back();
+      connections_.back().channel = grpc::CreateCustomChannel(uri, credentials, channel_args);
+    }
+  }
+
+  ChannelPool(const ChannelPool&) = delete;
+  ChannelPool& operator=(const ChannelPool&) = delete;
+
+  const std::string& Uri() const { return uri_; }
+
+  size_t NumConnections() const { return connections_.size(); }
+
+  int32_t MaxStreamsPerConnection() const { return max_streams_per_connection_; }
+
+  /// Waits for every connection to be established. Returns false if they are not all connected
+  /// after `timeout_ms`
+  bool WaitForConnected(uint64_t timeout_ms)
+  {
+    auto deadline = std::chrono::system_clock::now() + std::chrono::milliseconds(timeout_ms);
+    for (auto& connection : connections_) {
+      if (!connection.channel->WaitForConnected(deadline)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::shared_ptr<grpc::Channel> Channel(size_t connection) const
+  {
+    return connections_[connection].channel;
+  }
+
+  /// Reserves a stream slot on the least loaded connection, waiting for one to be released if
+  /// every connection is at `max_streams_per_connection`. With `wait` false the limit is
+  /// exceeded instead, for callers that must not block such as completion queue threads.
+  Lease Acquire(bool wait = true)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto start = std::chrono::steady_clock::now();
+    auto least_loaded = [this]() {
+      return std::min_element(
+                 connections_.begin(), connections_.end(),
+                 [](const Connection& a, const Connection& b) { return a.active < b.active; }) -
+             connections_.begin();
+    };
+    size_t connection = least_loaded();
+    if (wait && max_streams_per_connection_ > 0) {
+      slot_released_.wait(lock, [&]() {
+        connection = least_loaded();
+        return connections_[connection].active < (uint32_t)max_streams_per_connection_;
+      });
+    }
+    double wait_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+            .count();
+
+    auto& c = connections_[connection];
+    c.active++;
+    c.peak = std::max(c.peak, c.active);
+    c.rpcs++;
+    wait_ms_.Record(wait_ms);
+    return Lease(this, connection, wait_ms);
+  }
+
+  /// Prints the RPCs and peak concurrent streams of every connection and the time RPCs waited
+  /// for a stream slot
+  void PrintStats() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::cout << "Connections to " << uri_ << ":\n";
+    std::cout << "\tConnection\tRPCs\t\tPeak streams\n";
+    for (size_t i = 0; i < connections_.size(); ++i) {
+      std::cout << "\t" << i << "\t\t" << connections_[i].rpcs << "\t\t" << connections_[i].peak
+                << "\n";
+    }
+    std::cout << "\tWait for a stream slot (ms): median " << wait_ms_.Percentile(50.) << ", 99th "
+              << wait_ms_.Percentile(99.) << ", max " << wait_ms_.max << ", total "
+              << wait_ms_.sum << std::endl;
+  }
+
+ private:
+  struct Connection {
+    std::shared_ptr<grpc::Channel> channel;
+    uint32_t active = 0;
+    uint32_t peak = 0;
+    uint64_t rpcs = 0;
+  };
+
+  void Release(size_t connection)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      connections_[connection].active--;
+    }
+    slot_released_.notify_one();
+  }
+
+  std::string uri_;
+  int32_t max_streams_per_connection_;
+  std::vector<Connection> connections_;
+  riva::utils::stats::LatencyHistogram wait_ms_{};
+  mutable std::mutex mutex_;
+  std::condition_variable slot_released_;
+};
+
+/// Utility function to create one ChannelPool per server of a comma separated list of URIs
+/// This will only return when the connections to the servers have been established. A server
+/// that cannot be reached within the timeout gets a pool anyway, so that a client balancing over
+/// several replicas can start while some of them are down. Throws exception if no server can be
+/// reached
+///
+/// @param uris Comma separated URIs of the servers
+/// @param credentials GRPC credentials
+/// @param num_connections Number of connections to each server
+/// @param max_streams_per_connection Maximum number of RPCs in flight per connection, 0 for no
+/// limit
+/// @param timeout_ms The maximum time (in milliseconds) to wait for the connections to a server
+/// @param compression Default compression of the messages sent to the servers
+inline std::vector<std::shared_ptr<ChannelPool>>
+CreateChannelPools(
+    const std::string& uris, const std::shared_ptr<grpc::ChannelCredentials> credentials,
+    int32_t num_connections = 1, int32_t max_streams_per_connection = 0,
+    uint64_t timeout_ms = 10000, uint64_t max_grpc_message_size = MAX_GRPC_MESSAGE_SIZE,
+    grpc_compression_algorithm compression = GRPC_COMPRESS_NONE)
+{
+  std::vector<std::shared_ptr<ChannelPool>> pools;
+  size_t num_connected = 0;
+  for (auto& uri : SplitUris(uris)) {
+    pools.push_back(std::make_shared<ChannelPool>(
+        uri, credentials, num_connections, max_streams_per_connection, max_grpc_message_size,
+        compression));
+    if (pools.back()->WaitForConnected(timeout_ms)) {
+      num_connected++;
+    } else {
+      LOG(WARNING) << "Server " << uri << " is not reachable yet";
+    }
+  }
+  if (num_connected == 0) {
+    throw std::runtime_error("Unable to establish connection to any server of " + uris);
+  }
+  return pools;
+}
+
 }  // namespace riva::clients
@@ -5,7 +5,12 @@
 
 #include "grpc.h"
 
+#include <grpcpp/generic/async_generic_service.h>
+
+#include <cstdio>
+#include <fstream>
 #include <string>
+#include <thread>
 
 #include "gtest/gtest.h"
 
@@ -25,3 +30,134 @@ TEST(ClientUtils, CreateChannel)
         std::string(e.what()).find("Unable to establish connection") != std::string::npos, true);
   }
 }
+
+TEST(ClientUtils, SplitUris)
+{
+  auto uris = riva::clients::SplitUris("host1:50051,host2:50051,,host3:50052");
+  ASSERT_EQ(uris.size(), 3U);
+  EXPECT_EQ(uris[0], "host1:50051");
+  EXPECT_EQ(uris[2], "host3:50052");
+  EXPECT_EQ(riva::clients::SplitUris("localhost:50051").size(), 1U);
+}
+
+TEST(ClientUtils, ParseMetadata)
+{
+  auto pairs = riva::clients::ParseMetadata("authorization,Bearer abc,x-id,42");
+  ASSERT_EQ(pairs.size(), 2U);
+  EXPECT_EQ(pairs[0], std::make_pair(std::string("authorization"), std::string("Bearer abc")));
+  EXPECT_EQ(pairs[1], std::make_pair(std::string("x-id"), std::string("42")));
+  EXPECT_TRUE(riva::clients::ParseMetadata("").empty());
+  EXPECT_THROW(riva::clients::CustomAuthenticator("authorization"), std::runtime_error);
+}
+
+TEST(ClientUtils, FileMetadataAuthenticator)
+{
+  std::string path = ::testing::TempDir() + "metadata_test.txt";
+  auto write = [&path](const std::string& content) {
+    // Rotated the way a token refresher would, with a rename over the old file
+    std::ofstream(path + ".tmp") << content;
+    ASSERT_EQ(std::rename((path + ".tmp").c_str(), path.c_str()), 0);
+  };
+
+  write("authorization,Bearer first\n");
+  // Without a watcher thread, reloaded by hand
+  riva::clients::FileMetadataAuthenticator authenticator(path, std::chrono::milliseconds(0));
+  EXPECT_EQ(authenticator.Metadata()->at(0).second, "Bearer first");
+  EXPECT_EQ(authenticator.NumReloads(), 1U);
+
+  write("authorization,Bearer second\n");
+  EXPECT_EQ(authenticator.Metadata()->at(0).second, "Bearer first");
+  EXPECT_TRUE(authenticator.Reload());
+  EXPECT_EQ(authenticator.Metadata()->at(0).second, "Bearer second");
+  EXPECT_EQ(authenticator.NumReloads(), 2U);
+  // Unchanged file, not parsed again
+  EXPECT_TRUE(authenticator.Reload());
+  EXPECT_EQ(authenticator.NumReloads(), 2U);
+
+  // A malformed update keeps the previous metadata
+  write("authorization");
+  EXPECT_FALSE(authenticator.Reload());
+  EXPECT_EQ(authenticator.Metadata()->at(0).second, "Bearer second");
+
+  std::remove(path.c_str());
+  EXPECT_FALSE(authenticator.Reload());
+  EXPECT_EQ(authenticator.Metadata()->at(0).second, "Bearer second");
+  EXPECT_THROW(riva::clients::FileMetadataAuthenticator missing(path), std::runtime_error);
+}
+
+TEST(ClientUtils, FileMetadataAuthenticatorWatcher)
+{
+  std::string path = ::testing::TempDir() + "metadata_watcher_test.txt";
+  std::ofstream(path) << "authorization,Bearer first";
+  riva::clients::FileMetadataAuthenticator authenticator(path, std::chrono::milliseconds(1));
+  std::ofstream(path + ".tmp") << "authorization,Bearer second";
+  ASSERT_EQ(std::rename((path + ".tmp").c_str(), path.c_str()), 0);
+  for (int i = 0; i < 5000 && authenticator.NumReloads() < 2; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(authenticator.Metadata()->at(0).second, "Bearer second");
+  std::remove(path.c_str());
+}
+
+TEST(ClientUtils, ParseCompressionAlgorithm)
+{
+  EXPECT_EQ(riva::clients::ParseCompressionAlgorithm("none"), GRPC_COMPRESS_NONE);
+  EXPECT_EQ(riva::clients::ParseCompressionAlgorithm(""), GRPC_COMPRESS_NONE);
+  EXPECT_EQ(riva::clients::ParseCompressionAlgorithm("gzip"), GRPC_COMPRESS_GZIP);
+  EXPECT_EQ(riva::clients::ParseCompressionAlgorithm("deflate"), GRPC_COMPRESS_DEFLATE);
+  EXPECT_THROW(riva::clients::ParseCompressionAlgorithm("brotli"), std::runtime_error);
+}
+
+TEST(ClientUtils, CreateChannelPoolsNoServer)
+{
+  try {
+    auto pools = riva::clients::CreateChannelPools(
+        "localhost:1,localhost:2", grpc::InsecureChannelCredentials(), 1, 0, 100);
+    FAIL() << "Channel creation should throw an error when no server is reachable";
+  }
+  catch (const std::exception& e) {
+    EXPECT_NE(std::string(e.what()).find("any server"), std::string::npos);
+  }
+}
+
+TEST(ClientUtils, ChannelPool)
+{
+  // A server needs at least one service to accept connections, no RPC is ever sent to it
+  grpc::AsyncGenericService service;
+  int port = 0;
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port);
+  builder.RegisterAsyncGenericService(&service);
+  auto cq = builder.AddCompletionQueue();
+  auto server = builder.BuildAndStart();
+  ASSERT_NE(port, 0);
+
+  riva::clients::ChannelPool pool(
+      "localhost:" + std::to_string(port), grpc::InsecureChannelCredentials(), 2, 1);
+  ASSERT_TRUE(pool.WaitForConnected(5000));
+  ASSERT_EQ(pool.NumConnections(), 2U);
+  EXPECT_NE(pool.Channel(0), pool.Channel(1));
+
+  // One stream slot per connection: the first two RPCs go to different connections and the
+  // third one waits until a slot is released
+  auto first = pool.Acquire();
+  auto second = pool.Acquire();
+  EXPECT_NE(first.Connection(), second.Connection());
+  EXPECT_LT(second.WaitMs(), 50.);
+
+  std::thread release([&first]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    first.Reset();
+  });
+  auto third = pool.Acquire();
+  release.join();
+  EXPECT_GE(third.WaitMs(), 50.);
+  EXPECT_NE(third.Connection(), second.Connection());
+
+  server->Shutdown();
+  cq->Shutdown();
+  void* tag;
+  bool ok;
+  while (cq->Next(&tag, &ok)) {
+  }
+}
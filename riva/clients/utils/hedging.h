@@ -0,0 +1,382 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <grpcpp/alarm.h>
+#include <grpcpp/grpcpp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "riva/utils/stats/latency_histogram.h"
+
+namespace riva::clients {
+
+/// Counters of a HedgingPolicy, see HedgingPolicy::PrintStats
+struct HedgingStats {
+  uint64_t requests = 0;
+  // Extra attempts sent because the previous ones were slow, and how many of them answered first
+  uint64_t hedges = 0;
+  uint64_t hedge_wins = 0;
+  // Extra attempts sent because the previous one failed, and how many of them succeeded
+  uint64_t retries = 0;
+  uint64_t retry_successes = 0;
+  // Extra attempts not sent because the budget was spent
+  uint64_t budget_exhausted = 0;
+  // Attempts whose answer was not used, and the time they kept the server busy
+  uint64_t wasted_attempts = 0;
+  double wasted_ms = 0.;
+  // End-to-end latency of the successful requests served by their only attempt, and of those that
+  // needed more than one
+  riva::utils::stats::LatencyHistogram first_attempt_latencies{};
+  riva::utils::stats::LatencyHistogram hedged_latencies{};
+};
+
+/// Retry and hedging policy shared by all the calls of a client
+///
+/// A request gets up to `max_attempts` attempts. When `hedge_delay_ms` is set, another attempt is
+/// sent each time that delay elapses without an answer, the first successful answer is used and
+/// the other attempts are cancelled. With `hedge_percentile`, the delay follows that percentile
+/// of the observed attempt latencies instead, `hedge_delay_ms` being used until enough attempts
+/// completed. An attempt failing with a retryable code is retried right away if no other attempt
+/// of the request is in flight. Extra attempts, hedges and retries alike, are limited to
+/// `retry_budget` times the number of requests plus `min_extra_attempts`, so that an overloaded
+/// server does not get more load from the clients. All methods are thread safe.
+class HedgingPolicy {
+ public:
+  struct Options {
+    int32_t max_attempts = 1;
+    double hedge_delay_ms = 0.;
+    double hedge_percentile = 0.;
+    double retry_budget = 0.1;
+    int32_t min_extra_attempts = 10;
+    std::vector<grpc::StatusCode> retryable_codes = {
+        grpc::StatusCode::UNAVAILABLE, grpc::StatusCode::RESOURCE_EXHAUSTED};
+  };
+
+  // Attempts completed before the adaptive delay is used
+  static constexpr uint64_t kMinAdaptiveSamples = 20;
+
+  explicit HedgingPolicy(const Options& options) : options_(options) {}
+
+  int32_t MaxAttempts() const { return std::max(options_.max_attempts, 1); }
+
+  bool Hedging() const
+  {
+    return MaxAttempts() > 1 && (options_.hedge_delay_ms > 0. || options_.hedge_percentile > 0.);
+  }
+
+  std::chrono::microseconds HedgeDelay() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double delay_ms = options_.hedge_delay_ms;
+    if (options_.hedge_percentile > 0. && attempt_latencies_.count >= kMinAdaptiveSamples) {
+      delay_ms = attempt_latencies_.Percentile(options_.hedge_percentile);
+    }
+    return std::chrono::microseconds(static_cast<int64_t>(delay_ms * 1000.));
+  }
+
+  bool IsRetryable(grpc::StatusCode code) const
+  {
+    return std::find(options_.retryable_codes.begin(), options_.retryable_codes.end(), code) !=
+           options_.retryable_codes.end();
+  }
+
+  void OnRequest()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.requests++;
+  }
+
+  /// Takes one extra attempt from the budget, returns false if it is spent
+  bool TryExtraAttempt(bool hedge)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t extra_attempts = stats_.hedges + stats_.retries;
+    if (extra_attempts >= options_.retry_budget * stats_.requests + options_.min_extra_attempts) {
+      stats_.budget_exhausted++;
+      return false;
+    }
+    (hedge ? stats_.hedges : stats_.retries)++;
+    return true;
+  }
+
+  /// Records an attempt that completed, i.e. was not cancelled
+  void OnAttemptCompleted(double latency_ms)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    attempt_latencies_.Record(latency_ms);
+  }
+
+  void OnAttemptWasted(double busy_ms)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.wasted_attempts++;
+    stats_.wasted_ms += busy_ms;
+  }
+
+  /// Records the outcome of a request
+  ///
+  /// @param winner Index of the attempt whose answer was used
+  /// @param winner_is_hedge Whether that attempt was a hedge rather than a retry
+  void OnRequestDone(
+      const grpc::Status& status, int32_t num_attempts, int32_t winner, bool winner_is_hedge,
+      double latency_ms)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!status.ok()) {
+      return;
+    }
+    if (num_attempts == 1) {
+      stats_.first_attempt_latencies.Record(latency_ms);
+      return;
+    }
+    stats_.hedged_latencies.Record(latency_ms);
+    if (winner > 0) {
+      (winner_is_hedge ? stats_.hedge_wins : stats_.retry_successes)++;
+    }
+  }
+
+  HedgingStats Stats() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+  void PrintStats() const
+  {
+    auto stats = Stats();
+    std::cout << "Hedging and retries (max attempts " << MaxAttempts() << ", current hedge delay "
+              << (Hedging() ? HedgeDelay().count() / 1000. : 0.) << " ms):" << std::endl;
+    std::cout << "\tRequests: " << stats.requests << ", hedges: " << stats.hedges << " ("
+              << stats.hedge_wins << " answered first), retries: " << stats.retries << " ("
+              << stats.retry_successes << " succeeded), over budget: " << stats.budget_exhausted
+              << std::endl;
+    std::cout << "\tWasted attempts: " << stats.wasted_attempts << ", server time "
+              << stats.wasted_ms << " ms" << std::endl;
+    riva::utils::stats::PrintLatencyTable(
+        stats.first_attempt_latencies, "Single attempt latencies");
+    riva::utils::stats::PrintLatencyTable(stats.hedged_latencies, "Hedged latencies");
+  }
+
+ private:
+  const Options options_;
+  mutable std::mutex mutex_;
+  HedgingStats stats_;
+  riva::utils::stats::LatencyHistogram attempt_latencies_{};
+};
+
+class HedgedCallBase;
+
+/// Completion queue tag of the operations of a HedgedCall. Clients driving their own completion
+/// queue cast the tags they get to this type and pass them to `tag->call->Proceed`.
+struct HedgedCallTag {
+  HedgedCallBase* call = nullptr;
+  // Index of the attempt, -1 for the hedging alarm
+  int32_t attempt = -1;
+};
+
+class HedgedCallBase {
+ public:
+  virtual ~HedgedCallBase() = default;
+
+  /// Handles one event of the call. Returns true once the call is done and none of its operations
+  /// is pending on the completion queue anymore, after which the call can be deleted.
+  virtual bool Proceed(HedgedCallTag* tag, bool ok) = 0;
+};
+
+/// Unary call made of one or more attempts, following a HedgingPolicy
+///
+/// The attempts are started by `prepare`, which gets a fresh ClientContext for each of them, and
+/// run on the given completion queue. `attempt_done`, if set, is called for each attempt as it
+/// ends, with `used` telling whether its answer is the one of the call, so that per-attempt
+/// resources such as balancer slots can be released. Once Proceed returned true, `status` and
+/// `response` hold the outcome of the call.
+template <typename Response>
+class HedgedCall : public HedgedCallBase {
+ public:
+  using PrepareFunc = std::function<std::unique_ptr<grpc::ClientAsyncResponseReader<Response>>(
+      grpc::ClientContext* context, grpc::CompletionQueue* cq, int32_t attempt)>;
+  using AttemptDoneFunc = std::function<void(
+      int32_t attempt, const grpc::Status& status, double latency_ms, bool used)>;
+
+  void Start(
+      HedgingPolicy* policy, grpc::CompletionQueue* cq, PrepareFunc prepare,
+      AttemptDoneFunc attempt_done = nullptr)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    policy_ = policy;
+    cq_ = cq;
+    prepare_ = std::move(prepare);
+    attempt_done_ = std::move(attempt_done);
+    policy_->OnRequest();
+    StartAttempt(false);
+    // Time spent by `prepare` waiting for resources is not part of the latency
+    start_time_ = attempts_[0]->start;
+    ArmHedge();
+  }
+
+  bool Proceed(HedgedCallTag* tag, bool ok) override
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    if (tag->attempt < 0) {
+      alarm_pending_ = false;
+      if (ok && !done_ && static_cast<int32_t>(attempts_.size()) < policy_->MaxAttempts() &&
+          policy_->TryExtraAttempt(true)) {
+        StartAttempt(true);
+        ArmHedge();
+      }
+      return Finished();
+    }
+
+    auto& attempt = *attempts_[tag->attempt];
+    attempt.in_flight = false;
+    num_in_flight_--;
+    double attempt_ms = std::chrono::duration<double, std::milli>(now - attempt.start).count();
+    bool cancelled = attempt.status.error_code() == grpc::StatusCode::CANCELLED && done_;
+    if (!cancelled) {
+      policy_->OnAttemptCompleted(attempt_ms);
+    }
+
+    bool used = false;
+    if (!done_) {
+      bool retryable = !attempt.status.ok() && policy_->IsRetryable(attempt.status.error_code());
+      if (!retryable) {
+        used = true;
+      } else if (num_in_flight_ == 0) {
+        // Nothing else can answer, retry if allowed or give up with this error
+        if (static_cast<int32_t>(attempts_.size()) < policy_->MaxAttempts() &&
+            policy_->TryExtraAttempt(false)) {
+          StartAttempt(false);
+          if (!alarm_pending_) {
+            ArmHedge();
+          }
+        } else {
+          used = true;
+        }
+      }
+      if (used) {
+        Decide(tag->attempt, now);
+      }
+    }
+    if (!used) {
+      policy_->OnAttemptWasted(attempt_ms);
+    }
+    if (attempt_done_) {
+      attempt_done_(tag->attempt, attempt.status, attempt_ms, used);
+    }
+    return Finished();
+  }
+
+  int32_t NumAttempts() const { return attempts_.size(); }
+
+  grpc::Status status;
+  Response response;
+  // Latency of the call, from Start to the answer used
+  double latency_ms = 0.;
+
+ private:
+  struct Attempt {
+    HedgedCallTag tag;
+    grpc::ClientContext context;
+    std::unique_ptr<grpc::ClientAsyncResponseReader<Response>> reader;
+    Response response;
+    grpc::Status status;
+    std::chrono::steady_clock::time_point start;
+    bool hedge = false;
+    bool in_flight = true;
+  };
+
+  void StartAttempt(bool hedge)
+  {
+    attempts_.push_back(std::make_unique<Attempt>());
+    auto& attempt = *attempts_.back();
+    attempt.tag.call = this;
+    attempt.tag.attempt = attempts_.size() - 1;
+    attempt.hedge = hedge;
+    attempt.reader = prepare_(&attempt.context, cq_, attempt.tag.attempt);
+    attempt.start = std::chrono::steady_clock::now();
+    attempt.reader->StartCall();
+    attempt.reader->Finish(&attempt.response, &attempt.status, &attempt.tag);
+    num_in_flight_++;
+  }
+
+  void ArmHedge()
+  {
+    if (policy_->Hedging() && static_cast<int32_t>(attempts_.size()) < policy_->MaxAttempts()) {
+      alarm_tag_.call = this;
+      alarm_ = std::make_unique<grpc::Alarm>();
+      alarm_->Set(cq_, std::chrono::system_clock::now() + policy_->HedgeDelay(), &alarm_tag_);
+      alarm_pending_ = true;
+    }
+  }
+
+  void Decide(int32_t winner, std::chrono::steady_clock::time_point now)
+  {
+    done_ = true;
+    auto& attempt = *attempts_[winner];
+    status = attempt.status;
+    response = std::move(attempt.response);
+    latency_ms = std::chrono::duration<double, std::milli>(now - start_time_).count();
+    policy_->OnRequestDone(status, attempts_.size(), winner, attempt.hedge, latency_ms);
+    for (auto& other : attempts_) {
+      if (other->in_flight) {
+        other->context.TryCancel();
+      }
+    }
+    if (alarm_pending_) {
+      alarm_->Cancel();
+    }
+  }
+
+  bool Finished() const { return done_ && num_in_flight_ == 0 && !alarm_pending_; }
+
+  std::mutex mutex_;
+  HedgingPolicy* policy_ = nullptr;
+  grpc::CompletionQueue* cq_ = nullptr;
+  PrepareFunc prepare_;
+  AttemptDoneFunc attempt_done_;
+  std::chrono::steady_clock::time_point start_time_;
+  std::vector<std::unique_ptr<Attempt>> attempts_;
+  int32_t num_in_flight_ = 0;
+  std::unique_ptr<grpc::Alarm> alarm_;
+  HedgedCallTag alarm_tag_;
+  bool alarm_pending_ = false;
+  bool done_ = false;
+};
+
+/// Blocking version of HedgedCall, running the attempts on a completion queue of its own
+template <typename Response>
+grpc::Status
+HedgedUnaryCall(
+    HedgingPolicy& policy, typename HedgedCall<Response>::PrepareFunc prepare, Response* response)
+{
+  grpc::CompletionQueue cq;
+  HedgedCall<Response> call;
+  call.Start(&policy, &cq, std::move(prepare));
+  void* got_tag;
+  bool ok = false;
+  while (cq.Next(&got_tag, &ok)) {
+    auto* tag = static_cast<HedgedCallTag*>(got_tag);
+    if (tag->call->Proceed(tag, ok)) {
+      break;
+    }
+  }
+  cq.Shutdown();
+  while (cq.Next(&got_tag, &ok)) {
+  }
+  *response = std::move(call.response);
+  return call.status;
+}
+
+}  // namespace riva::clients
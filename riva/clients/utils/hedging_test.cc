@@ -0,0 +1,152 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "hedging.h"
+
+#include <grpcpp/generic/generic_stub.h>
+
+#include "gtest/gtest.h"
+#include "test_server.h"
+
+namespace riva::clients {
+
+namespace {
+
+grpc::Status
+Call(grpc::GenericStub& stub, HedgingPolicy& policy, double* latency_ms = nullptr)
+{
+  grpc::ByteBuffer response;
+  auto start = std::chrono::steady_clock::now();
+  auto status = HedgedUnaryCall<grpc::ByteBuffer>(
+      policy,
+      [&stub](grpc::ClientContext* context, grpc::CompletionQueue* cq, int32_t attempt) {
+        return stub.PrepareUnaryCall(context, "/test.Test/Call", TestPayload(), cq);
+      },
+      &response);
+  if (latency_ms) {
+    *latency_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+            .count();
+  }
+  return status;
+}
+
+}  // namespace
+
+TEST(Hedging, SingleAttempt)
+{
+  TestServer server([](int) { return std::make_pair(0, grpc::StatusCode::UNAVAILABLE); });
+  grpc::GenericStub stub(server.Channel());
+  HedgingPolicy policy(HedgingPolicy::Options{});
+
+  EXPECT_EQ(Call(stub, policy).error_code(), grpc::StatusCode::UNAVAILABLE);
+  EXPECT_EQ(server.NumCalls(), 1);
+  EXPECT_EQ(policy.Stats().retries, 0U);
+}
+
+TEST(Hedging, RetryUnavailable)
+{
+  TestServer server([](int index) {
+    return std::make_pair(
+        0, index == 0 ? grpc::StatusCode::UNAVAILABLE : grpc::StatusCode::OK);
+  });
+  grpc::GenericStub stub(server.Channel());
+  HedgingPolicy::Options options;
+  options.max_attempts = 3;
+  HedgingPolicy policy(options);
+
+  EXPECT_TRUE(Call(stub, policy).ok());
+  EXPECT_EQ(server.NumCalls(), 2);
+  auto stats = policy.Stats();
+  EXPECT_EQ(stats.retries, 1U);
+  EXPECT_EQ(stats.retry_successes, 1U);
+  EXPECT_EQ(stats.wasted_attempts, 1U);
+  EXPECT_EQ(stats.hedged_latencies.count, 1U);
+}
+
+TEST(Hedging, NonRetryableError)
+{
+  TestServer server([](int) { return std::make_pair(0, grpc::StatusCode::INVALID_ARGUMENT); });
+  grpc::GenericStub stub(server.Channel());
+  HedgingPolicy::Options options;
+  options.max_attempts = 3;
+  HedgingPolicy policy(options);
+
+  EXPECT_EQ(Call(stub, policy).error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+  EXPECT_EQ(server.NumCalls(), 1);
+}
+
+TEST(Hedging, HedgeWinsOverSlowAttempt)
+{
+  TestServer server([](int index) {
+    return std::make_pair(index == 0 ? 2000 : 0, grpc::StatusCode::OK);
+  });
+  grpc::GenericStub stub(server.Channel());
+  HedgingPolicy::Options options;
+  options.max_attempts = 2;
+  options.hedge_delay_ms = 50.;
+  HedgingPolicy policy(options);
+
+  double latency_ms;
+  EXPECT_TRUE(Call(stub, policy, &latency_ms).ok());
+  EXPECT_LT(latency_ms, 1000.);
+  EXPECT_GE(latency_ms, 50.);
+  auto stats = policy.Stats();
+  EXPECT_EQ(stats.hedges, 1U);
+  EXPECT_EQ(stats.hedge_wins, 1U);
+  // The slow attempt was cancelled
+  EXPECT_EQ(stats.wasted_attempts, 1U);
+}
+
+TEST(Hedging, NoHedgeForFastAnswer)
+{
+  TestServer server([](int) { return std::make_pair(0, grpc::StatusCode::OK); });
+  grpc::GenericStub stub(server.Channel());
+  HedgingPolicy::Options options;
+  options.max_attempts = 2;
+  options.hedge_delay_ms = 1000.;
+  HedgingPolicy policy(options);
+
+  double latency_ms;
+  EXPECT_TRUE(Call(stub, policy, &latency_ms).ok());
+  // The pending alarm is cancelled, not waited for
+  EXPECT_LT(latency_ms, 500.);
+  EXPECT_EQ(server.NumCalls(), 1);
+  EXPECT_EQ(policy.Stats().first_attempt_latencies.count, 1U);
+}
+
+TEST(Hedging, Budget)
+{
+  TestServer server([](int) { return std::make_pair(0, grpc::StatusCode::UNAVAILABLE); });
+  grpc::GenericStub stub(server.Channel());
+  HedgingPolicy::Options options;
+  options.max_attempts = 5;
+  options.retry_budget = 0.;
+  options.min_extra_attempts = 2;
+  HedgingPolicy policy(options);
+
+  EXPECT_FALSE(Call(stub, policy).ok());
+  EXPECT_FALSE(Call(stub, policy).ok());
+  // 2 requests and 2 retries in total
+  EXPECT_EQ(server.NumCalls(), 4);
+  EXPECT_EQ(policy.Stats().retries, 2U);
+  EXPECT_EQ(policy.Stats().budget_exhausted, 2U);
+}
+
+TEST(Hedging, AdaptiveDelay)
+{
+  HedgingPolicy::Options options;
+  options.max_attempts = 2;
+  options.hedge_delay_ms = 100.;
+  options.hedge_percentile = 95.;
+  HedgingPolicy policy(options);
+  EXPECT_EQ(policy.HedgeDelay().count(), 100000);
+  for (int i = 0; i < 100; ++i) {
+    policy.OnAttemptCompleted(i < 97 ? 10. : 500.);
+  }
+  EXPECT_NEAR(policy.HedgeDelay().count() / 1000., 10., 1.);
+}
+
+}  // namespace riva::clients
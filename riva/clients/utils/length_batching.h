@@ -0,0 +1,108 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace riva::clients {
+
+/// How the inputs of a batched service are grouped into requests
+enum class BatchingMode {
+  // In input order
+  kInputOrder,
+  // Sorted by length, so that inputs of similar lengths share a request and the server, which
+  // pads every input of a batch to the longest one, computes less padding
+  kLengthSorted,
+};
+
+inline BatchingMode
+ParseBatchingMode(const std::string& mode)
+{
+  if (mode == "input_order") {
+    return BatchingMode::kInputOrder;
+  } else if (mode == "length_sorted") {
+    return BatchingMode::kLengthSorted;
+  }
+  throw std::invalid_argument("Unknown batching mode " + mode + ", expected input_order or "
+                              "length_sorted");
+}
+
+/// Groups inputs of the given lengths, in tokens, into batches of at most `batch_size` inputs
+///
+/// Returns the indices of the inputs of each batch. With `max_batch_tokens` > 0, a batch is also
+/// closed before its padded size, i.e. its number of inputs times its longest length, would exceed
+/// it; an input longer than that gets a batch of its own.
+inline std::vector<std::vector<size_t>>
+MakeLengthBatches(
+    const std::vector<int32_t>& lengths, BatchingMode mode, int32_t batch_size,
+    int64_t max_batch_tokens = 0)
+{
+  std::vector<size_t> order(lengths.size());
+  std::iota(order.begin(), order.end(), 0);
+  if (mode == BatchingMode::kLengthSorted) {
+    std::stable_sort(order.begin(), order.end(), [&lengths](size_t a, size_t b) {
+      return lengths[a] < lengths[b];
+    });
+  }
+
+  std::vector<std::vector<size_t>> batches;
+  std::vector<size_t> batch;
+  int32_t longest = 0;
+  for (size_t index : order) {
+    int32_t padded_length = std::max(longest, lengths[index]);
+    // Padded tokens of the batch if the text joined it
+    int64_t padded_tokens =
+        static_cast<int64_t>(padded_length) * static_cast<int64_t>(batch.size() + 1);
+    bool full = static_cast<int32_t>(batch.size()) == batch_size ||
+                (max_batch_tokens > 0 && padded_tokens > max_batch_tokens);
+    if (!batch.empty() && full) {
+      batches.push_back(std::move(batch));
+      batch.clear();
+      padded_length = lengths[index];
+    }
+    batch.push_back(index);
+    longest = padded_length;
+  }
+  if (!batch.empty()) {
+    batches.push_back(std::move(batch));
+  }
+  return batches;
+}
+
+/// Tokens of a set of batches and tokens computed once padded to the longest input of each batch
+struct PaddingStats {
+  int64_t tokens = 0;
+  int64_t padded_tokens = 0;
+
+  /// Share of the computed tokens that are not padding
+  double Efficiency() const
+  {
+    return padded_tokens > 0 ? static_cast<double>(tokens) / padded_tokens : 1.;
+  }
+};
+
+inline PaddingStats
+ComputePadding(const std::vector<int32_t>& lengths, const std::vector<std::vector<size_t>>& batches)
+{
+  PaddingStats stats;
+  for (auto& batch : batches) {
+    int32_t longest = 0;
+    for (size_t index : batch) {
+      stats.tokens += lengths[index];
+      longest = std::max(longest, lengths[index]);
+    }
+    stats.padded_tokens += static_cast<int64_t>(longest) * batch.size();
+  }
+  return stats;
+}
+
+}  // namespace riva::clients
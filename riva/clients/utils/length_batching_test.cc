@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "length_batching.h"
+
+#include "gtest/gtest.h"
+
+namespace riva::clients {
+
+using Batches = std::vector<std::vector<size_t>>;
+
+TEST(LengthBatching, InputOrder)
+{
+  std::vector<int32_t> lengths = {3, 200, 4, 180, 5};
+  auto batches = MakeLengthBatches(lengths, BatchingMode::kInputOrder, 2);
+  EXPECT_EQ(batches, (Batches{{0, 1}, {2, 3}, {4}}));
+  auto padding = ComputePadding(lengths, batches);
+  EXPECT_EQ(padding.tokens, 392);
+  EXPECT_EQ(padding.padded_tokens, 400 + 360 + 5);
+}
+
+TEST(LengthBatching, LengthSortedPadsLess)
+{
+  std::vector<int32_t> lengths = {3, 200, 4, 180, 5};
+  auto batches = MakeLengthBatches(lengths, BatchingMode::kLengthSorted, 2);
+  EXPECT_EQ(batches, (Batches{{0, 2}, {4, 3}, {1}}));
+  auto sorted = ComputePadding(lengths, batches);
+  auto input_order =
+      ComputePadding(lengths, MakeLengthBatches(lengths, BatchingMode::kInputOrder, 2));
+  EXPECT_EQ(sorted.tokens, input_order.tokens);
+  EXPECT_GT(sorted.Efficiency(), input_order.Efficiency());
+}
+
+TEST(LengthBatching, MaxBatchTokens)
+{
+  std::vector<int32_t> lengths = {10, 10, 10, 30, 100};
+  auto batches = MakeLengthBatches(lengths, BatchingMode::kInputOrder, 8, 40);
+  // 3 x 10, then 30 padded with the batch would be 4 x 30 > 40, and 100 alone exceeds the cap
+  EXPECT_EQ(batches, (Batches{{0, 1, 2}, {3}, {4}}));
+  for (auto& batch : batches) {
+    EXPECT_FALSE(batch.empty());
+  }
+}
+
+TEST(LengthBatching, ParseMode)
+{
+  EXPECT_EQ(ParseBatchingMode("input_order"), BatchingMode::kInputOrder);
+  EXPECT_EQ(ParseBatchingMode("length_sorted"), BatchingMode::kLengthSorted);
+  EXPECT_THROW(ParseBatchingMode("random"), std::invalid_argument);
+}
+
+}  // namespace riva::clients
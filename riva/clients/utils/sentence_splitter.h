@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace riva::clients {
+
+/// A sentence of a text and the whitespace following it. The text is the concatenation of its
+/// sentences and their separators, so that the translations of the sentences and the separators
+/// make up the translation of the text.
+struct Sentence {
+  std::string_view text;
+  std::string_view separator;
+};
+
+namespace internal {
+
+// Length of the sentence terminator at `pos`, 0 if there is none: '.', '!' and '?', and their
+// CJK full-width forms, which need no whitespace after them
+inline size_t
+TerminatorLength(std::string_view text, size_t pos)
+{
+  char c = text[pos];
+  if (c == '.' || c == '!' || c == '?') {
+    return 1;
+  }
+  for (std::string_view terminator : {"\xE3\x80\x82", "\xEF\xBC\x81", "\xEF\xBC\x9F"}) {
+    if (text.substr(pos, terminator.size()) == terminator) {
+      return terminator.size();
+    }
+  }
+  return 0;
+}
+
+// Length of the punctuation closing a sentence at `pos`, e.g. quotes and brackets after its
+// terminator, 0 if there is none
+inline size_t
+ClosingLength(std::string_view text, size_t pos)
+{
+  char c = text[pos];
+  if (c == '.' || c == '!' || c == '?' || c == '"' || c == '\'' || c == ')' || c == ']') {
+    return 1;
+  }
+  // Right double and single quotation marks
+  for (std::string_view closing : {"\xE2\x80\x9D", "\xE2\x80\x99"}) {
+    if (text.substr(pos, closing.size()) == closing) {
+      return closing.size();
+    }
+  }
+  return 0;
+}
+
+// Whether the word before a period is an abbreviation or an initial rather than the end of a
+// sentence, e.g. "Dr.", "e.g." or "J."
+inline bool
+IsAbbreviation(std::string_view word)
+{
+  static constexpr std::array<std::string_view, 24> kAbbreviations = {
+      "Mr", "Mrs", "Ms",  "Dr",  "Prof", "Sr",  "Jr",  "St",  "vs",  "etc", "No",  "Inc",
+      "Ltd", "Co", "Mt",  "Fig", "Gen",  "Gov", "Sen", "Rep", "Jan", "Feb", "Aug", "approx"};
+  if (word.size() == 1 || word.find('.') != std::string_view::npos) {
+    return true;
+  }
+  return std::find(kAbbreviations.begin(), kAbbreviations.end(), word) != kAbbreviations.end();
+}
+
+// Whether `c` can start a sentence: not a lowercase letter
+inline bool
+StartsSentence(char c)
+{
+  return !std::islower(static_cast<unsigned char>(c));
+}
+
+}  // namespace internal
+
+/// Splits `text` into sentences
+///
+/// A sentence ends at '.', '!' or '?', and the quotes and brackets closing it, followed by
+/// whitespace and a character other than a lowercase letter, unless the period ends an
+/// abbreviation or an initial. It also ends at the CJK full stop, exclamation and question
+/// marks. Returns no sentence for an empty text.
+inline std::vector<Sentence>
+SplitSentences(std::string_view text)
+{
+  std::vector<Sentence> sentences;
+  size_t start = 0;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t terminator = internal::TerminatorLength(text, pos);
+    if (terminator == 0) {
+      pos++;
+      continue;
+    }
+    size_t end = pos + terminator;
+    for (size_t closing; end < text.size() && (closing = internal::ClosingLength(text, end));) {
+      end += closing;
+    }
+    size_t next = end;
+    while (next < text.size() && std::isspace(static_cast<unsigned char>(text[next]))) {
+      next++;
+    }
+
+    bool split = false;
+    if (next < text.size()) {
+      if (terminator > 1) {
+        split = true;
+      } else if (next > end && internal::StartsSentence(text[next])) {
+        size_t word_start = text.find_last_of(" \t", pos);
+        word_start = word_start == std::string_view::npos || word_start < start ? start
+                                                                                 : word_start + 1;
+        split = text[pos] != '.' ||
+                !internal::IsAbbreviation(text.substr(word_start, pos - word_start));
+      }
+    }
+    if (split) {
+      sentences.push_back({text.substr(start, end - start), text.substr(end, next - end)});
+      start = next;
+    }
+    pos = next > end ? next : end;
+  }
+  if (start < text.size()) {
+    sentences.push_back({text.substr(start), std::string_view()});
+  }
+  return sentences;
+}
+
+}  // namespace riva::clients
@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "sentence_splitter.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace riva::clients {
+
+namespace {
+
+std::vector<std::string>
+Texts(const std::vector<Sentence>& sentences)
+{
+  std::vector<std::string> texts;
+  for (auto& sentence : sentences) {
+    texts.emplace_back(sentence.text);
+  }
+  return texts;
+}
+
+std::string
+Join(const std::vector<Sentence>& sentences)
+{
+  std::string text;
+  for (auto& sentence : sentences) {
+    text += std::string(sentence.text) + std::string(sentence.separator);
+  }
+  return text;
+}
+
+}  // namespace
+
+TEST(SentenceSplitter, Split)
+{
+  std::string text = "Hello world. How are you?  I'm fine!\tThanks";
+  auto sentences = SplitSentences(text);
+  EXPECT_EQ(
+      Texts(sentences),
+      (std::vector<std::string>{"Hello world.", "How are you?", "I'm fine!", "Thanks"}));
+  EXPECT_EQ(sentences[1].separator, "  ");
+  EXPECT_EQ(sentences[2].separator, "\t");
+  EXPECT_EQ(Join(sentences), text);
+}
+
+TEST(SentenceSplitter, NoSplit)
+{
+  EXPECT_TRUE(SplitSentences("").empty());
+  EXPECT_EQ(Texts(SplitSentences("One sentence.")), (std::vector<std::string>{"One sentence."}));
+  EXPECT_EQ(
+      Texts(SplitSentences("Dr. Smith met Mr. J. Doe, e.g. at 3.30 p.m. today.")),
+      (std::vector<std::string>{"Dr. Smith met Mr. J. Doe, e.g. at 3.30 p.m. today."}));
+  EXPECT_EQ(
+      Texts(SplitSentences("It costs approx. five dollars. done")),
+      (std::vector<std::string>{"It costs approx. five dollars. done"}));
+}
+
+TEST(SentenceSplitter, Closing)
+{
+  std::string text = "He said \"Stop!\" Then he left... (Really.) Yes?! 2 more.";
+  auto sentences = SplitSentences(text);
+  EXPECT_EQ(
+      Texts(sentences),
+      (std::vector<std::string>{
+          "He said \"Stop!\"", "Then he left...", "(Really.)", "Yes?!", "2 more."}));
+  EXPECT_EQ(Join(sentences), text);
+}
+
+TEST(SentenceSplitter, Cjk)
+{
+  std::string text = "\xE4\xBD\xA0\xE5\xA5\xBD\xE3\x80\x82\xE8\xB0\xA2\xE8\xB0\xA2\xEF\xBC\x81";
+  auto sentences = SplitSentences(text);
+  EXPECT_EQ(
+      Texts(sentences), (std::vector<std::string>{
+                            "\xE4\xBD\xA0\xE5\xA5\xBD\xE3\x80\x82",
+                            "\xE8\xB0\xA2\xE8\xB0\xA2\xEF\xBC\x81"}));
+  EXPECT_EQ(Join(sentences), text);
+}
+
+}  // namespace riva::clients
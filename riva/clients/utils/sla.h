@@ -0,0 +1,133 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+namespace riva::clients {
+
+/// Outcome of the requests of a run with a latency SLA. Trivially copyable, so that worker
+/// processes can hand it to their parent through shared memory.
+struct SlaCounts {
+  uint64_t requests = 0;
+  // Requests answered successfully within the SLA
+  uint64_t met = 0;
+  // Requests cancelled at their deadline or answered after it
+  uint64_t late = 0;
+  // Amount of work (audio seconds, sentences...) of all the successful requests and of those
+  // within the SLA
+  double work = 0.;
+  double met_work = 0.;
+
+  void Merge(const SlaCounts& other)
+  {
+    requests += other.requests;
+    met += other.met;
+    late += other.late;
+    work += other.work;
+    met_work += other.met_work;
+  }
+};
+
+static_assert(std::is_trivially_copyable_v<SlaCounts>);
+
+/// Prints the share of requests meeting the SLA and the goodput, i.e. the requests and work
+/// within the SLA per second, next to the raw throughput
+///
+/// @param work_unit Name of the unit of the work, e.g. "audio sec"
+inline void
+PrintSlaReport(
+    const SlaCounts& counts, double sla_ms, double run_time_sec, const std::string& work_unit)
+{
+  double per_sec = run_time_sec > 0. ? 1. / run_time_sec : 0.;
+  std::cout << "SLA " << sla_ms << " ms: " << counts.met << " of " << counts.requests
+            << " requests met it, " << counts.late << " late" << std::endl;
+  std::cout << "\tGoodput: " << counts.met * per_sec << " requests/sec, "
+            << counts.met_work * per_sec << " " << work_unit << "/sec" << std::endl;
+  std::cout << "\tThroughput: " << (counts.requests - counts.late) * per_sec << " requests/sec, "
+            << counts.work * per_sec << " " << work_unit << "/sec" << std::endl;
+}
+
+/// Per-call deadlines and goodput accounting for `--sla_ms`. Disabled, i.e. no deadline is set
+/// and nothing is late, when the SLA is 0. Thread safe.
+class SlaTracker {
+ public:
+  explicit SlaTracker(double sla_ms) : sla_ms_(sla_ms) {}
+
+  bool Enabled() const { return sla_ms_ > 0.; }
+
+  double SlaMs() const { return sla_ms_; }
+
+  /// Deadline of a request started at `start`
+  std::chrono::system_clock::time_point Deadline(
+      std::chrono::system_clock::time_point start = std::chrono::system_clock::now()) const
+  {
+    return start + std::chrono::microseconds(static_cast<int64_t>(sla_ms_ * 1000.));
+  }
+
+  /// Sets the deadline of a call started now, if enabled
+  void SetDeadline(grpc::ClientContext& context) const
+  {
+    if (Enabled()) {
+      context.set_deadline(Deadline());
+    }
+  }
+
+  /// Records the outcome of a request. A request is late when it failed with DEADLINE_EXCEEDED,
+  /// was cancelled by the client at its deadline (`cancelled_late`), or succeeded after the SLA.
+  ///
+  /// @param work Amount of work done by the request, used when it succeeded
+  void Record(
+      const grpc::Status& status, double latency_ms, double work = 0., bool cancelled_late = false)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counts_.requests++;
+    if (status.ok()) {
+      counts_.work += work;
+    }
+    if (!Enabled()) {
+      return;
+    }
+    if (cancelled_late || status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED ||
+        (status.ok() && latency_ms > sla_ms_)) {
+      counts_.late++;
+    } else if (status.ok()) {
+      counts_.met++;
+      counts_.met_work += work;
+    }
+  }
+
+  /// Whether a failed request is only late, and so should not be reported as an error
+  bool IsLate(const grpc::Status& status) const
+  {
+    return Enabled() && status.error_code() == grpc::StatusCode::DEADLINE_EXCEEDED;
+  }
+
+  SlaCounts Counts() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return counts_;
+  }
+
+  void Print(double run_time_sec, const std::string& work_unit) const
+  {
+    PrintSlaReport(Counts(), sla_ms_, run_time_sec, work_unit);
+  }
+
+ private:
+  const double sla_ms_;
+  mutable std::mutex mutex_;
+  SlaCounts counts_;
+};
+
+}  // namespace riva::clients
@@ -0,0 +1,65 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "sla.h"
+
+#include "gtest/gtest.h"
+
+namespace riva::clients {
+
+TEST(Sla, Disabled)
+{
+  SlaTracker sla(0.);
+  EXPECT_FALSE(sla.Enabled());
+  grpc::ClientContext context;
+  sla.SetDeadline(context);
+  EXPECT_EQ(context.deadline(), std::chrono::system_clock::time_point::max());
+
+  sla.Record(grpc::Status::OK, 10000., 2.);
+  auto counts = sla.Counts();
+  EXPECT_EQ(counts.requests, 1U);
+  EXPECT_EQ(counts.late, 0U);
+  EXPECT_EQ(counts.work, 2.);
+}
+
+TEST(Sla, Deadline)
+{
+  SlaTracker sla(250.);
+  auto start = std::chrono::system_clock::now();
+  EXPECT_EQ(sla.Deadline(start) - start, std::chrono::milliseconds(250));
+
+  grpc::ClientContext context;
+  sla.SetDeadline(context);
+  auto remaining = context.deadline() - std::chrono::system_clock::now();
+  EXPECT_GT(remaining, std::chrono::milliseconds(200));
+  EXPECT_LE(remaining, std::chrono::milliseconds(250));
+}
+
+TEST(Sla, Counts)
+{
+  SlaTracker sla(100.);
+  sla.Record(grpc::Status::OK, 50., 1.);
+  sla.Record(grpc::Status::OK, 150., 2.);
+  sla.Record(grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED, ""), 100.);
+  sla.Record(grpc::Status(grpc::StatusCode::CANCELLED, ""), 100., 0., true);
+  sla.Record(grpc::Status(grpc::StatusCode::INTERNAL, ""), 10.);
+  EXPECT_TRUE(sla.IsLate(grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED, "")));
+  EXPECT_FALSE(sla.IsLate(grpc::Status(grpc::StatusCode::INTERNAL, "")));
+
+  auto counts = sla.Counts();
+  EXPECT_EQ(counts.requests, 5U);
+  EXPECT_EQ(counts.met, 1U);
+  EXPECT_EQ(counts.late, 3U);
+  EXPECT_EQ(counts.work, 3.);
+  EXPECT_EQ(counts.met_work, 1.);
+
+  SlaCounts total;
+  total.Merge(counts);
+  total.Merge(counts);
+  EXPECT_EQ(total.requests, 10U);
+  EXPECT_EQ(total.met_work, 2.);
+}
+
+}  // namespace riva::clients
@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace riva::clients {
+
+/// A flag of a parameter sweep and the values it takes
+struct SweepAxis {
+  std::string flag;
+  std::vector<std::string> values;
+};
+
+/// Values of every swept flag at one point of the grid
+using SweepPoint = std::vector<std::pair<std::string, std::string>>;
+
+/// Utility function to parse a sweep grid
+///
+/// The grid is a semicolon separated list of flags, each followed by `=` and its comma separated
+/// values, e.g. "chunk_duration_ms=80,160;stop_history=500,800". Throws std::invalid_argument if
+/// an axis has no value or a flag is given twice.
+inline std::vector<SweepAxis>
+ParseSweepGrid(const std::string& grid)
+{
+  std::vector<SweepAxis> axes;
+  std::istringstream grid_stream(grid);
+  std::string axis_spec;
+  while (std::getline(grid_stream, axis_spec, ';')) {
+    if (axis_spec.empty()) {
+      continue;
+    }
+    auto separator = axis_spec.find('=');
+    if (separator == std::string::npos || separator == 0) {
+      throw std::invalid_argument("Invalid sweep axis " + axis_spec + ", expected flag=v1,v2,...");
+    }
+    SweepAxis axis;
+    axis.flag = axis_spec.substr(0, separator);
+    for (auto& other : axes) {
+      if (other.flag == axis.flag) {
+        throw std::invalid_argument("Flag " + axis.flag + " swept twice");
+      }
+    }
+    std::istringstream values(axis_spec.substr(separator + 1));
+    std::string value;
+    while (std::getline(values, value, ',')) {
+      if (!value.empty()) {
+        axis.values.push_back(value);
+      }
+    }
+    if (axis.values.empty()) {
+      throw std::invalid_argument("No value to sweep for flag " + axis.flag);
+    }
+    axes.push_back(std::move(axis));
+  }
+  return axes;
+}
+
+/// Utility function to list the points of a sweep grid, i.e. every combination of the values of
+/// its axes. The last axis varies fastest. An empty grid has a single point, setting no flag.
+inline std::vector<SweepPoint>
+SweepPoints(const std::vector<SweepAxis>& axes)
+{
+  std::vector<SweepPoint> points(1);
+  for (auto& axis : axes) {
+    std::vector<SweepPoint> extended;
+    extended.reserve(points.size() * axis.values.size());
+    for (auto& point : points) {
+      for (auto& value : axis.values) {
+        extended.push_back(point);
+        extended.back().emplace_back(axis.flag, value);
+      }
+    }
+    points = std::move(extended);
+  }
+  return points;
+}
+
+}  // namespace riva::clients
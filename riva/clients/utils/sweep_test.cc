@@ -0,0 +1,41 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "sweep.h"
+
+#include "gtest/gtest.h"
+
+namespace riva::clients {
+
+TEST(Sweep, ParseGrid)
+{
+  auto axes = ParseSweepGrid("chunk_duration_ms=80,160,320;stop_threshold_eou=-1,0.5;");
+  ASSERT_EQ(axes.size(), 2U);
+  EXPECT_EQ(axes[0].flag, "chunk_duration_ms");
+  EXPECT_EQ(axes[0].values, (std::vector<std::string>{"80", "160", "320"}));
+  EXPECT_EQ(axes[1].flag, "stop_threshold_eou");
+  EXPECT_EQ(axes[1].values, (std::vector<std::string>{"-1", "0.5"}));
+
+  EXPECT_TRUE(ParseSweepGrid("").empty());
+  EXPECT_THROW(ParseSweepGrid("chunk_duration_ms"), std::invalid_argument);
+  EXPECT_THROW(ParseSweepGrid("=80"), std::invalid_argument);
+  EXPECT_THROW(ParseSweepGrid("chunk_duration_ms="), std::invalid_argument);
+  EXPECT_THROW(ParseSweepGrid("stop_history=1;stop_history=2"), std::invalid_argument);
+}
+
+TEST(Sweep, Points)
+{
+  auto points = SweepPoints(ParseSweepGrid("a=1,2;b=x,y,z"));
+  ASSERT_EQ(points.size(), 6U);
+  EXPECT_EQ(points[0], (SweepPoint{{"a", "1"}, {"b", "x"}}));
+  EXPECT_EQ(points[1], (SweepPoint{{"a", "1"}, {"b", "y"}}));
+  EXPECT_EQ(points[5], (SweepPoint{{"a", "2"}, {"b", "z"}}));
+
+  points = SweepPoints({});
+  ASSERT_EQ(points.size(), 1U);
+  EXPECT_TRUE(points[0].empty());
+}
+
+}  // namespace riva::clients
@@ -0,0 +1,184 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <grpcpp/alarm.h>
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/grpcpp.h>
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace riva::clients {
+
+/// Small message answered by default. Default constructed byte buffers are invalid and fail to be
+/// sent.
+inline grpc::ByteBuffer
+TestPayload()
+{
+  grpc::Slice slice("payload");
+  return grpc::ByteBuffer(&slice, 1);
+}
+
+/// Serializes a protobuf message into the byte buffer a TestServer answers with
+template <class T>
+grpc::ByteBuffer
+SerializeMessage(const T& message)
+{
+  grpc::Slice slice(message.SerializeAsString());
+  return grpc::ByteBuffer(&slice, 1);
+}
+
+/// Parses the protobuf message a TestServer received
+template <class T>
+T
+ParseMessage(const grpc::ByteBuffer& buffer)
+{
+  std::vector<grpc::Slice> slices;
+  std::string serialized;
+  if (buffer.Dump(&slices).ok()) {
+    for (auto& slice : slices) {
+      serialized.append(reinterpret_cast<const char*>(slice.begin()), slice.size());
+    }
+  }
+  T message;
+  message.ParseFromString(serialized);
+  return message;
+}
+
+/// Asynchronous server for the tests of the clients, serving every method. It answers every call
+/// after the delay and with the status that `behavior` gives for the index of the call. The
+/// message of a successful call is the one `respond` makes of its request, TestPayload() if
+/// `respond` is not set.
+class TestServer {
+ public:
+  using Behavior = std::function<std::pair<int, grpc::StatusCode>(int call_index)>;
+  using Respond = std::function<grpc::ByteBuffer(const grpc::ByteBuffer& request)>;
+
+  explicit TestServer(Behavior behavior, Respond respond = nullptr)
+      : behavior_(behavior), respond_(respond)
+  {
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("localhost:0", grpc::InsecureServerCredentials(), &port_);
+    builder.RegisterAsyncGenericService(&service_);
+    cq_ = builder.AddCompletionQueue();
+    server_ = builder.BuildAndStart();
+    thread_ = std::thread([this]() { Serve(); });
+  }
+
+  ~TestServer()
+  {
+    // Let the serving thread cancel the delayed answers first, nothing may be queued on the
+    // completion queue once it is shut down
+    shutdown_alarm_.Set(cq_.get(), std::chrono::system_clock::now(), &shutdown_alarm_);
+    stopped_.get_future().wait();
+    server_->Shutdown(std::chrono::system_clock::now());
+    cq_->Shutdown();
+    thread_.join();
+  }
+
+  std::shared_ptr<grpc::Channel> Channel()
+  {
+    return grpc::CreateChannel(
+        "localhost:" + std::to_string(port_), grpc::InsecureChannelCredentials());
+  }
+
+  int NumCalls() const { return num_calls_.load(); }
+
+ private:
+  struct Call {
+    enum State { kNew, kRead, kDelayed, kFinished } state = kNew;
+    grpc::GenericServerContext context;
+    grpc::GenericServerAsyncReaderWriter stream{&context};
+    grpc::ByteBuffer request;
+    grpc::Alarm alarm;
+    grpc::StatusCode code = grpc::StatusCode::OK;
+  };
+
+  void RequestCall()
+  {
+    auto* call = new Call;
+    service_.RequestCall(&call->context, &call->stream, cq_.get(), cq_.get(), call);
+  }
+
+  void Serve()
+  {
+    RequestCall();
+    void* tag;
+    bool ok;
+    bool stopping = false;
+    while (cq_->Next(&tag, &ok)) {
+      if (tag == &shutdown_alarm_) {
+        stopping = true;
+        for (auto* call : delayed_) {
+          call->alarm.Cancel();
+        }
+        stopped_.set_value();
+        continue;
+      }
+      auto* call = static_cast<Call*>(tag);
+      if (call->state == Call::kDelayed) {
+        delayed_.erase(call);
+      }
+      if (!ok || stopping) {
+        delete call;
+        continue;
+      }
+      switch (call->state) {
+        case Call::kNew: {
+          RequestCall();
+          call->state = Call::kRead;
+          call->stream.Read(&call->request, call);
+          break;
+        }
+        case Call::kRead: {
+          auto [delay_ms, code] = behavior_(num_calls_++);
+          call->code = code;
+          call->state = Call::kDelayed;
+          delayed_.insert(call);
+          call->alarm.Set(
+              cq_.get(), std::chrono::system_clock::now() + std::chrono::milliseconds(delay_ms),
+              call);
+          break;
+        }
+        case Call::kDelayed:
+          call->state = Call::kFinished;
+          if (call->code == grpc::StatusCode::OK) {
+            call->stream.WriteAndFinish(
+                respond_ ? respond_(call->request) : TestPayload(), grpc::WriteOptions(),
+                grpc::Status::OK, call);
+          } else {
+            call->stream.Finish(grpc::Status(call->code, "test failure"), call);
+          }
+          break;
+        case Call::kFinished:
+          delete call;
+          break;
+      }
+    }
+  }
+
+  Behavior behavior_;
+  Respond respond_;
+  grpc::AsyncGenericService service_;
+  std::unique_ptr<grpc::ServerCompletionQueue> cq_;
+  std::unique_ptr<grpc::Server> server_;
+  std::thread thread_;
+  int port_ = 0;
+  std::atomic<int> num_calls_{0};
+  std::set<Call*> delayed_;
+  grpc::Alarm shutdown_alarm_;
+  std::promise<void> stopped_;
+};
+
+}  // namespace riva::clients
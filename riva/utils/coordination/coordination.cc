@@ -0,0 +1,317 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "coordination.h"
+
+#include <arpa/inet.h>
+#include <endian.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace riva::utils::coordination {
+
+namespace {
+
+// Bumped whenever the frame layout changes
+constexpr uint32_t kProtocolVersion = 1;
+// Frames larger than this are treated as a corrupted stream
+constexpr uint32_t kMaxFrameSize = 64 * 1024 * 1024;
+// Time a new connection has to say hello, so that a stray connection cannot block the controller
+constexpr int kHandshakeTimeoutSec = 10;
+
+enum FrameType : uint8_t {
+  kHello = 1,
+  kAssignment = 2,
+  kResult = 3,
+};
+
+[[noreturn]] void
+ThrowSystemError(const std::string& what)
+{
+  throw std::runtime_error(what + ": " + strerror(errno));
+}
+
+void
+WriteAll(int fd, const char* data, size_t size)
+{
+  while (size > 0) {
+    ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowSystemError("Failed to send to peer");
+    }
+    data += written;
+    size -= written;
+  }
+}
+
+void
+ReadAll(int fd, char* data, size_t size)
+{
+  while (size > 0) {
+    ssize_t received = recv(fd, data, size, 0);
+    if (received == 0) {
+      throw std::runtime_error("Connection closed by peer");
+    } else if (received < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowSystemError("Failed to receive from peer");
+    }
+    data += received;
+    size -= received;
+  }
+}
+
+// Frame: 4 bytes big endian payload size, 1 byte type, payload
+void
+SendFrame(int fd, FrameType type, const std::string& payload)
+{
+  std::string frame(5, '\0');
+  uint32_t size = htonl(static_cast<uint32_t>(payload.size()));
+  std::memcpy(&frame[0], &size, 4);
+  frame[4] = static_cast<char>(type);
+  frame += payload;
+  WriteAll(fd, frame.data(), frame.size());
+}
+
+std::string
+ReceiveFrame(int fd, FrameType expected_type)
+{
+  char header[5];
+  ReadAll(fd, header, sizeof(header));
+  uint32_t size;
+  std::memcpy(&size, header, 4);
+  size = ntohl(size);
+  if (static_cast<uint8_t>(header[4]) != expected_type || size > kMaxFrameSize) {
+    throw std::runtime_error("Unexpected message from peer");
+  }
+  std::string payload(size, '\0');
+  ReadAll(fd, payload.data(), size);
+  return payload;
+}
+
+void
+AppendInt(std::string& buffer, uint64_t value)
+{
+  value = htobe64(value);
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+uint64_t
+ReadInt(const std::string& buffer, size_t& offset)
+{
+  if (offset + sizeof(uint64_t) > buffer.size()) {
+    throw std::runtime_error("Truncated message from peer");
+  }
+  uint64_t value;
+  std::memcpy(&value, buffer.data() + offset, sizeof(value));
+  offset += sizeof(value);
+  return be64toh(value);
+}
+
+// Receives fail after `seconds` without data, 0 to wait forever
+void
+SetReceiveTimeout(int fd, int seconds)
+{
+  timeval timeout{};
+  timeout.tv_sec = seconds;
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+    ThrowSystemError("Failed to set the receive timeout");
+  }
+}
+
+}  // namespace
+
+Controller::Controller(uint16_t port)
+{
+  listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    ThrowSystemError("Failed to create controller socket");
+  }
+  int enable = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(listen_fd_, SOMAXCONN) < 0) {
+    close(listen_fd_);
+    ThrowSystemError("Failed to listen on port " + std::to_string(port));
+  }
+  socklen_t addr_len = sizeof(addr);
+  getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &addr_len);
+  port_ = ntohs(addr.sin_port);
+}
+
+Controller::~Controller()
+{
+  for (int fd : agent_fds_) {
+    close(fd);
+  }
+  close(listen_fd_);
+}
+
+void
+Controller::AcceptAgents(int32_t num_agents)
+{
+  while (static_cast<int32_t>(agent_fds_.size()) < num_agents) {
+    int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowSystemError("Failed to accept agent");
+    }
+    // A connection that is not an agent of this version is dropped, and the next one accepted
+    try {
+      SetReceiveTimeout(fd, kHandshakeTimeoutSec);
+      std::string hello = ReceiveFrame(fd, kHello);
+      size_t offset = 0;
+      if (ReadInt(hello, offset) != kProtocolVersion) {
+        throw std::runtime_error("Agent uses a different protocol version");
+      }
+      // Agents report their results only once their run is over
+      SetReceiveTimeout(fd, 0);
+      agent_fds_.push_back(fd);
+    }
+    catch (const std::exception& e) {
+      std::cerr << "Rejected connection: " << e.what() << std::endl;
+      close(fd);
+    }
+  }
+}
+
+void
+Controller::StartAgents(
+    const std::string& scenario, std::chrono::system_clock::time_point start_time)
+{
+  int64_t start_time_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(start_time.time_since_epoch())
+          .count();
+  for (size_t i = 0; i < agent_fds_.size(); ++i) {
+    std::string payload;
+    AppendInt(payload, i);
+    AppendInt(payload, agent_fds_.size());
+    AppendInt(payload, start_time_us);
+    payload += scenario;
+    SendFrame(agent_fds_[i], kAssignment, payload);
+  }
+}
+
+std::vector<AgentResult>
+Controller::GatherResults()
+{
+  std::vector<AgentResult> results;
+  results.reserve(agent_fds_.size());
+  for (size_t i = 0; i < agent_fds_.size(); ++i) {
+    AgentResult result;
+    try {
+      std::string message = ReceiveFrame(agent_fds_[i], kResult);
+      size_t offset = 0;
+      result.status = static_cast<int32_t>(ReadInt(message, offset));
+      result.payload = message.substr(offset);
+    }
+    catch (const std::exception& e) {
+      std::cerr << "No result from agent " << i << ": " << e.what() << std::endl;
+      result.status = kAgentLost;
+      result.payload.clear();
+    }
+    results.push_back(std::move(result));
+  }
+  return results;
+}
+
+Agent::Agent(const std::string& address, int64_t timeout_ms)
+{
+  size_t colon = address.rfind(':');
+  if (colon == std::string::npos) {
+    throw std::runtime_error("Controller address must be host:port, got " + address);
+  }
+  std::string host = address.substr(0, colon);
+  std::string port = address.substr(colon + 1);
+
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses = nullptr;
+  int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+  if (err != 0) {
+    throw std::runtime_error("Failed to resolve " + address + ": " + gai_strerror(err));
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  fd_ = -1;
+  while (fd_ < 0) {
+    for (addrinfo* ai = addresses; ai != nullptr && fd_ < 0; ai = ai->ai_next) {
+      int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd < 0) {
+        continue;
+      }
+      if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+        fd_ = fd;
+      } else {
+        close(fd);
+      }
+    }
+    if (fd_ < 0) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        freeaddrinfo(addresses);
+        throw std::runtime_error("Failed to connect to controller at " + address);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+  freeaddrinfo(addresses);
+
+  int enable = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  std::string hello;
+  AppendInt(hello, kProtocolVersion);
+  SendFrame(fd_, kHello, hello);
+}
+
+Agent::~Agent()
+{
+  close(fd_);
+}
+
+Assignment
+Agent::ReceiveAssignment()
+{
+  std::string message = ReceiveFrame(fd_, kAssignment);
+  size_t offset = 0;
+  Assignment assignment;
+  assignment.agent_index = static_cast<int32_t>(ReadInt(message, offset));
+  assignment.num_agents = static_cast<int32_t>(ReadInt(message, offset));
+  assignment.start_time = std::chrono::system_clock::time_point(
+      std::chrono::microseconds(static_cast<int64_t>(ReadInt(message, offset))));
+  assignment.scenario = message.substr(offset);
+  return assignment;
+}
+
+void
+Agent::SendResult(int32_t status, const std::string& payload)
+{
+  std::string message;
+  AppendInt(message, static_cast<uint32_t>(status));
+  message += payload;
+  SendFrame(fd_, kResult, message);
+}
+
+}  // namespace riva::utils::coordination
@@ -0,0 +1,115 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace riva::utils::coordination {
+
+/// Work handed by the controller to one agent
+struct Assignment {
+  int32_t agent_index;
+  int32_t num_agents;
+  /// Wall clock time at which every agent starts sending requests
+  std::chrono::system_clock::time_point start_time;
+  /// Opaque description of the test, the same for every agent
+  std::string scenario;
+};
+
+/// What an agent reports back once its run is over
+struct AgentResult {
+  int32_t status;
+  std::string payload;
+};
+
+/// Status of an agent that disconnected or sent a malformed result, with an empty payload
+constexpr int32_t kAgentLost = -1;
+
+/// Controller side of the coordination protocol
+///
+/// The controller listens on a TCP port, waits for the agents to connect, sends each of them an
+/// Assignment and gathers their results. Messages are length-prefixed frames; an agent and a
+/// controller built from different versions of the protocol refuse to talk to each other.
+/// Socket errors are reported by throwing std::runtime_error.
+class Controller {
+ public:
+  /// Listens on all interfaces. Port 0 picks a free port, see Port().
+  explicit Controller(uint16_t port);
+  ~Controller();
+
+  Controller(const Controller&) = delete;
+  Controller& operator=(const Controller&) = delete;
+
+  uint16_t Port() const { return port_; }
+
+  /// Blocks until `num_agents` agents have connected. Agents are numbered in connection order.
+  /// Connections that do not complete the handshake in time or with the same protocol version
+  /// are closed and not counted.
+  void AcceptAgents(int32_t num_agents);
+
+  /// Sends every connected agent its index, the common start time and the scenario
+  void StartAgents(
+      const std::string& scenario, std::chrono::system_clock::time_point start_time);
+
+  /// Blocks until every agent has reported, returns the results in agent order. The result of an
+  /// agent that failed to report has the kAgentLost status.
+  std::vector<AgentResult> GatherResults();
+
+ private:
+  int listen_fd_;
+  uint16_t port_;
+  std::vector<int> agent_fds_;
+};
+
+/// Agent side of the coordination protocol
+class Agent {
+ public:
+  /// Connects to the controller at `address` (host:port), retrying for up to `timeout_ms` so
+  /// agents can be started before the controller
+  explicit Agent(const std::string& address, int64_t timeout_ms = 60000);
+  ~Agent();
+
+  Agent(const Agent&) = delete;
+  Agent& operator=(const Agent&) = delete;
+
+  /// Blocks until the controller starts the test
+  Assignment ReceiveAssignment();
+
+  /// Reports the outcome of the run. `payload` is forwarded to the controller unchanged.
+  void SendResult(int32_t status, const std::string& payload);
+
+ private:
+  int fd_;
+};
+
+/// Utility functions to send a fixed-size stats struct as a result payload. Controller and agents
+/// must be built from the same sources for the same architecture.
+template <typename T>
+std::string
+ToPayload(const T& value)
+{
+  static_assert(std::is_trivially_copyable_v<T>);
+  return std::string(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool
+FromPayload(const std::string& payload, T& value)
+{
+  static_assert(std::is_trivially_copyable_v<T>);
+  if (payload.size() != sizeof(T)) {
+    return false;
+  }
+  std::memcpy(&value, payload.data(), sizeof(T));
+  return true;
+}
+
+}  // namespace riva::utils::coordination
@@ -0,0 +1,182 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "coordination.h"
+
+#include <arpa/inet.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <set>
+#include <thread>
+
+#include "riva/utils/stats/latency_histogram.h"
+
+using namespace ::testing;
+
+namespace riva::utils::coordination {
+
+using riva::utils::stats::LatencyHistogram;
+
+namespace {
+
+// Connects to the controller on `port` without the protocol, sends `data` and hangs up
+void
+StrayConnection(uint16_t port, const std::string& data)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+  if (!data.empty()) {
+    ASSERT_EQ(send(fd, data.data(), data.size(), MSG_NOSIGNAL), static_cast<ssize_t>(data.size()));
+  }
+  close(fd);
+}
+
+}  // namespace
+
+TEST(Coordination, AgentsOnLocalhost)
+{
+  constexpr int32_t kNumAgents = 4;
+  Controller controller(0);
+  std::string address = "localhost:" + std::to_string(controller.Port());
+  auto start_time = std::chrono::system_clock::now() + std::chrono::milliseconds(50);
+
+  std::vector<Assignment> assignments(kNumAgents);
+  std::vector<std::thread> agents;
+  for (int32_t i = 0; i < kNumAgents; ++i) {
+    agents.emplace_back([&address, &assignments, i]() {
+      Agent agent(address);
+      Assignment assignment = agent.ReceiveAssignment();
+      assignments[i] = assignment;
+      LatencyHistogram histogram{};
+      for (int32_t j = 0; j <= assignment.agent_index; ++j) {
+        histogram.Record(100. * (assignment.agent_index + 1));
+      }
+      agent.SendResult(assignment.agent_index == 2 ? 7 : 0, ToPayload(histogram));
+    });
+  }
+
+  controller.AcceptAgents(kNumAgents);
+  controller.StartAgents("num_parallel_requests=8\n", start_time);
+  auto results = controller.GatherResults();
+  for (auto& agent : agents) {
+    agent.join();
+  }
+
+  std::set<int32_t> indices;
+  for (auto& assignment : assignments) {
+    indices.insert(assignment.agent_index);
+    EXPECT_EQ(assignment.num_agents, kNumAgents);
+    EXPECT_EQ(assignment.scenario, "num_parallel_requests=8\n");
+    EXPECT_EQ(
+        std::chrono::duration_cast<std::chrono::microseconds>(assignment.start_time - start_time)
+            .count(),
+        0);
+  }
+  EXPECT_EQ(indices.size(), static_cast<size_t>(kNumAgents));
+
+  ASSERT_EQ(results.size(), static_cast<size_t>(kNumAgents));
+  LatencyHistogram merged{};
+  for (int32_t i = 0; i < kNumAgents; ++i) {
+    EXPECT_EQ(results[i].status, i == 2 ? 7 : 0);
+    LatencyHistogram histogram;
+    ASSERT_TRUE(FromPayload(results[i].payload, histogram));
+    EXPECT_EQ(histogram.count, static_cast<uint64_t>(i + 1));
+    merged.Merge(histogram);
+  }
+  EXPECT_EQ(merged.count, 10U);
+  EXPECT_DOUBLE_EQ(merged.max, 400.);
+}
+
+TEST(Coordination, StrayConnectionsRejected)
+{
+  Controller controller(0);
+  // A connection closed right away and one sending something else than a hello
+  StrayConnection(controller.Port(), "");
+  StrayConnection(controller.Port(), std::string("\0\0\0\x01\x07x", 6));
+  std::thread agent_thread([&controller]() {
+    Agent agent("localhost:" + std::to_string(controller.Port()));
+    auto assignment = agent.ReceiveAssignment();
+    agent.SendResult(0, assignment.scenario);
+  });
+
+  controller.AcceptAgents(1);
+  controller.StartAgents("scenario", std::chrono::system_clock::now());
+  auto results = controller.GatherResults();
+  agent_thread.join();
+  ASSERT_EQ(results.size(), 1U);
+  EXPECT_EQ(results[0].status, 0);
+  EXPECT_EQ(results[0].payload, "scenario");
+}
+
+TEST(Coordination, LostAgentKeepsOtherResults)
+{
+  constexpr int32_t kNumAgents = 3;
+  Controller controller(0);
+  std::string address = "localhost:" + std::to_string(controller.Port());
+  std::vector<std::thread> agents;
+  for (int32_t i = 0; i < kNumAgents; ++i) {
+    agents.emplace_back([&address]() {
+      Agent agent(address);
+      auto assignment = agent.ReceiveAssignment();
+      // Agent 1 crashes before reporting
+      if (assignment.agent_index != 1) {
+        agent.SendResult(0, ToPayload(assignment.agent_index));
+      }
+    });
+  }
+
+  controller.AcceptAgents(kNumAgents);
+  controller.StartAgents("", std::chrono::system_clock::now());
+  auto results = controller.GatherResults();
+  for (auto& agent : agents) {
+    agent.join();
+  }
+
+  ASSERT_EQ(results.size(), static_cast<size_t>(kNumAgents));
+  for (int32_t i = 0; i < kNumAgents; ++i) {
+    if (i == 1) {
+      EXPECT_EQ(results[i].status, kAgentLost);
+      EXPECT_TRUE(results[i].payload.empty());
+      continue;
+    }
+    int32_t index;
+    EXPECT_EQ(results[i].status, 0);
+    ASSERT_TRUE(FromPayload(results[i].payload, index));
+    EXPECT_EQ(index, i);
+  }
+}
+
+TEST(Coordination, PayloadSizeChecked)
+{
+  LatencyHistogram histogram;
+  EXPECT_FALSE(FromPayload(std::string("short"), histogram));
+}
+
+TEST(Coordination, AgentConnectTimeout)
+{
+  uint16_t port;
+  {
+    Controller controller(0);
+    port = controller.Port();
+  }
+  try {
+    Agent agent("localhost:" + std::to_string(port), 200);
+    FAIL() << "Expected runtime error when no controller listens";
+  }
+  catch (std::runtime_error& e) {
+    EXPECT_THAT(e.what(), HasSubstr("Failed to connect"));
+  }
+}
+
+}  // namespace riva::utils::coordination
@@ -0,0 +1,219 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "phrase_matcher.h"
+
+#include <algorithm>
+#include <iostream>
+#include <queue>
+#include <utility>
+
+namespace riva::utils::phrases {
+
+namespace {
+
+unsigned char
+Lower(char ch)
+{
+  unsigned char c = ch;
+  return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+std::vector<std::string>
+Keys(const std::vector<Entry>& entries)
+{
+  std::vector<std::string> keys;
+  keys.reserve(entries.size());
+  for (auto& entry : entries) {
+    keys.push_back(entry.key);
+  }
+  return keys;
+}
+
+}  // namespace
+
+PhraseMatcher::PhraseMatcher(const std::vector<std::string>& phrases)
+{
+  // Trie, with the edges of each state in insertion order
+  std::vector<std::vector<std::pair<unsigned char, int32_t>>> edges(1);
+  first_phrase_.assign(1, -1);
+  next_phrase_.assign(phrases.size(), -1);
+  for (size_t i = 0; i < phrases.size(); i++) {
+    if (phrases[i].empty()) {
+      continue;
+    }
+    int32_t state = 0;
+    for (char ch : phrases[i]) {
+      unsigned char c = Lower(ch);
+      auto it = std::find_if(edges[state].begin(), edges[state].end(), [c](const auto& edge) {
+        return edge.first == c;
+      });
+      if (it != edges[state].end()) {
+        state = it->second;
+        continue;
+      }
+      int32_t next = edges.size();
+      edges[state].emplace_back(c, next);
+      edges.emplace_back();
+      first_phrase_.push_back(-1);
+      state = next;
+    }
+    next_phrase_[i] = first_phrase_[state];
+    first_phrase_[state] = i;
+  }
+
+  size_t num_states = edges.size();
+  root_edges_.fill(-1);
+  for (auto& edge : edges[0]) {
+    root_edges_[edge.first] = edge.second;
+  }
+  edge_begin_.reserve(num_states + 1);
+  for (auto& state_edges : edges) {
+    std::sort(state_edges.begin(), state_edges.end());
+    edge_begin_.push_back(edge_labels_.size());
+    for (auto& edge : state_edges) {
+      edge_labels_.push_back(edge.first);
+      edge_targets_.push_back(edge.second);
+    }
+  }
+  edge_begin_.push_back(edge_labels_.size());
+  edges.clear();
+
+  // Failure and dictionary links, breadth first so that those of the shorter prefixes are known
+  fail_.assign(num_states, 0);
+  dictionary_link_.assign(num_states, 0);
+  std::queue<int32_t> queue;
+  for (int32_t child : root_edges_) {
+    if (child > 0) {
+      queue.push(child);
+    }
+  }
+  while (!queue.empty()) {
+    int32_t state = queue.front();
+    queue.pop();
+    for (uint32_t e = edge_begin_[state]; e < edge_begin_[state + 1]; e++) {
+      int32_t child = edge_targets_[e];
+      int32_t fail = fail_[state];
+      int32_t next;
+      while ((next = Goto(fail, edge_labels_[e])) < 0 && fail != 0) {
+        fail = fail_[fail];
+      }
+      fail_[child] = next >= 0 ? next : 0;
+      dictionary_link_[child] =
+          first_phrase_[fail_[child]] >= 0 ? fail_[child] : dictionary_link_[fail_[child]];
+      queue.push(child);
+    }
+  }
+}
+
+int32_t
+PhraseMatcher::Goto(int32_t state, unsigned char c) const
+{
+  if (state == 0) {
+    return root_edges_[c];
+  }
+  auto begin = edge_labels_.begin() + edge_begin_[state];
+  auto end = edge_labels_.begin() + edge_begin_[state + 1];
+  auto it = std::lower_bound(begin, end, c);
+  return it != end && *it == c ? edge_targets_[it - edge_labels_.begin()] : -1;
+}
+
+void
+PhraseMatcher::Scan(std::string_view text, std::unordered_set<int32_t>& matched) const
+{
+  int32_t state = 0;
+  for (char ch : text) {
+    unsigned char c = Lower(ch);
+    int32_t next;
+    while ((next = Goto(state, c)) < 0 && state != 0) {
+      state = fail_[state];
+    }
+    state = next >= 0 ? next : 0;
+    // The phrases ending at a state matched before, and at its dictionary links, are known
+    for (int32_t s = first_phrase_[state] >= 0 ? state : dictionary_link_[state];
+         s != 0 && matched.insert(s).second; s = dictionary_link_[s]) {
+    }
+  }
+}
+
+std::vector<size_t>
+PhraseMatcher::Phrases(const std::unordered_set<int32_t>& matched) const
+{
+  std::vector<size_t> phrases;
+  for (int32_t state : matched) {
+    for (int32_t phrase = first_phrase_[state]; phrase >= 0; phrase = next_phrase_[phrase]) {
+      phrases.push_back(phrase);
+    }
+  }
+  std::sort(phrases.begin(), phrases.end());
+  return phrases;
+}
+
+std::vector<size_t>
+PhraseMatcher::Match(std::string_view text) const
+{
+  std::unordered_set<int32_t> matched;
+  Scan(text, matched);
+  return Phrases(matched);
+}
+
+std::vector<size_t>
+PhraseMatcher::Match(const std::vector<std::string>& texts) const
+{
+  std::unordered_set<int32_t> matched;
+  for (auto& text : texts) {
+    Scan(text, matched);
+  }
+  return Phrases(matched);
+}
+
+DictionaryPruner::DictionaryPruner(const std::vector<Entry>& entries, const std::string& separator)
+    : matcher_(Keys(entries))
+{
+  for (auto& entry : entries) {
+    serialized_.push_back(entry.key + separator + entry.value);
+    total_size_ += serialized_.back().size();
+  }
+  // Commas
+  total_size_ += entries.empty() ? 0 : entries.size() - 1;
+}
+
+std::string
+DictionaryPruner::Serialize(const std::vector<size_t>& indices)
+{
+  std::string serialized;
+  for (size_t index : indices) {
+    if (!serialized.empty()) {
+      serialized += ",";
+    }
+    serialized += serialized_[index];
+  }
+  num_requests_++;
+  num_bytes_ += serialized.size();
+  return serialized;
+}
+
+std::string
+DictionaryPruner::Prune(const std::vector<std::string>& texts)
+{
+  return Serialize(matcher_.Match(texts));
+}
+
+std::string
+DictionaryPruner::Prune(std::string_view text)
+{
+  return Serialize(matcher_.Match(text));
+}
+
+void
+DictionaryPruner::PrintStats() const
+{
+  uint64_t num_requests = num_requests_;
+  std::cout << "Dictionary pruning: "
+            << (num_requests ? static_cast<double>(num_bytes_) / num_requests : 0.)
+            << " bytes per request on average instead of " << total_size_ << std::endl;
+}
+
+}  // namespace riva::utils::phrases
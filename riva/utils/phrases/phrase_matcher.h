@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "phrases.h"
+
+namespace riva::utils::phrases {
+
+/// Finds which of a set of phrases occur in a text, in one pass over the text whatever the
+/// number of phrases (Aho-Corasick automaton)
+///
+/// Matching ignores ASCII case and word boundaries, so that it finds at least every phrase a
+/// service matching whole words, in any case, would. Empty phrases never match. Immutable once
+/// built, and so thread safe.
+class PhraseMatcher {
+ public:
+  explicit PhraseMatcher(const std::vector<std::string>& phrases);
+
+  /// Returns the indices, in increasing order, of the phrases occurring in `text`
+  std::vector<size_t> Match(std::string_view text) const;
+
+  /// Returns the indices, in increasing order, of the phrases occurring in any of `texts`
+  std::vector<size_t> Match(const std::vector<std::string>& texts) const;
+
+  size_t NumStates() const { return fail_.size(); }
+
+ private:
+  // Next state from `state` on `c`, -1 if the trie has no such edge
+  int32_t Goto(int32_t state, unsigned char c) const;
+
+  // Adds the states where phrases occurring in `text` end to `matched`
+  void Scan(std::string_view text, std::unordered_set<int32_t>& matched) const;
+
+  std::vector<size_t> Phrases(const std::unordered_set<int32_t>& matched) const;
+
+  // Edges of the root, all of them being looked at for most characters of the text
+  std::array<int32_t, 256> root_edges_;
+  // Edges of the other states, sorted by label: those of state s are in
+  // [edge_begin_[s], edge_begin_[s + 1])
+  std::vector<uint32_t> edge_begin_;
+  std::vector<unsigned char> edge_labels_;
+  std::vector<int32_t> edge_targets_;
+  std::vector<int32_t> fail_;
+  // Closest state on the failure path with a phrase ending there, 0 if none
+  std::vector<int32_t> dictionary_link_;
+  // First phrase ending at each state, -1 if none, and next phrase equal to each phrase
+  std::vector<int32_t> first_phrase_;
+  std::vector<int32_t> next_phrase_;
+};
+
+/// Dictionary entries sent with the requests of a service, serialized as `key<separator>value`
+/// and joined with commas, pruned down to the entries whose key occurs in the text of the request
+///
+/// Thread safe.
+class DictionaryPruner {
+ public:
+  DictionaryPruner(const std::vector<Entry>& entries, const std::string& separator);
+
+  /// Entries whose key occurs in any of `texts`
+  std::string Prune(const std::vector<std::string>& texts);
+
+  /// Entries whose key occurs in `text`
+  std::string Prune(std::string_view text);
+
+  /// Prints the average size of the pruned entries sent with a request next to the size of all
+  /// the entries
+  void PrintStats() const;
+
+ private:
+  std::string Serialize(const std::vector<size_t>& indices);
+
+  std::vector<std::string> serialized_;
+  size_t total_size_ = 0;
+  PhraseMatcher matcher_;
+  std::atomic<uint64_t> num_requests_{0};
+  std::atomic<uint64_t> num_bytes_{0};
+};
+
+}  // namespace riva::utils::phrases
@@ -0,0 +1,81 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "phrase_matcher.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cctype>
+#include <random>
+
+namespace riva::utils::phrases {
+
+namespace {
+
+std::string
+ToLower(std::string text)
+{
+  std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+    return std::tolower(c);
+  });
+  return text;
+}
+
+}  // namespace
+
+TEST(PhraseMatcher, Match)
+{
+  PhraseMatcher matcher({"he", "she", "his", "hers", "", "she"});
+  EXPECT_EQ(matcher.Match("ushers"), (std::vector<size_t>{0, 1, 3, 5}));
+  EXPECT_EQ(matcher.Match("HIS"), (std::vector<size_t>{2}));
+  EXPECT_EQ(matcher.Match("nothing"), (std::vector<size_t>{}));
+  EXPECT_EQ(matcher.Match(""), (std::vector<size_t>{}));
+  EXPECT_EQ(
+      matcher.Match(std::vector<std::string>{"a hi", "this", "he"}),
+      (std::vector<size_t>{0, 2}));
+}
+
+TEST(PhraseMatcher, MatchesLikeSubstringSearch)
+{
+  std::mt19937 rng(1);
+  auto random_text = [&rng](size_t max_length) {
+    std::string text(rng() % (max_length + 1), ' ');
+    for (auto& c : text) {
+      c = "abAB c"[rng() % 6];
+    }
+    return text;
+  };
+
+  std::vector<std::string> phrases;
+  for (int i = 0; i < 200; i++) {
+    phrases.push_back(random_text(5));
+  }
+  PhraseMatcher matcher(phrases);
+  for (int i = 0; i < 100; i++) {
+    std::string text = random_text(40);
+    std::vector<size_t> expected;
+    for (size_t p = 0; p < phrases.size(); p++) {
+      if (!phrases[p].empty() && ToLower(text).find(ToLower(phrases[p])) != std::string::npos) {
+        expected.push_back(p);
+      }
+    }
+    EXPECT_EQ(matcher.Match(text), expected) << text;
+  }
+}
+
+TEST(DictionaryPruner, Prune)
+{
+  DictionaryPruner pruner(
+      {{"NVIDIA", "EH1 N V IH1 D IY0 AH0"}, {"Riva", "R IY1 V AH0"}, {"GPU", "JH IY1 P IY1"}},
+      "  ");
+  EXPECT_EQ(pruner.Prune("riva runs on a gpu"), "Riva  R IY1 V AH0,GPU  JH IY1 P IY1");
+  EXPECT_EQ(pruner.Prune("Hello"), "");
+  EXPECT_EQ(
+      pruner.Prune(std::vector<std::string>{"NVIDIA", "Riva"}),
+      "NVIDIA  EH1 N V IH1 D IY0 AH0,Riva  R IY1 V AH0");
+}
+
+}  // namespace riva::utils::phrases
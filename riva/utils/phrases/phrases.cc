@@ -0,0 +1,221 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "phrases.h"
+
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace riva::utils::phrases {
+
+namespace {
+
+// Cache layout, in host byte order: the header, then the entries and the malformed lines, each
+// string prefixed with its length
+struct CacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format;
+  uint32_t reserved;
+  // Modification time and size of the parsed file
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  int64_t file_size;
+  uint64_t num_entries;
+  uint64_t num_malformed_lines;
+};
+
+constexpr uint32_t kCacheMagic = 0x48505652;  // "RVPH"
+// Bumped whenever the layout or the parsing changes
+constexpr uint32_t kCacheVersion = 1;
+
+CacheHeader
+MakeHeader(const struct stat& st, Format format)
+{
+  CacheHeader header{};
+  header.magic = kCacheMagic;
+  header.version = kCacheVersion;
+  header.format = static_cast<uint32_t>(format);
+  header.mtime_sec = st.st_mtim.tv_sec;
+  header.mtime_nsec = st.st_mtim.tv_nsec;
+  header.file_size = st.st_size;
+  return header;
+}
+
+bool
+ReadString(std::istream& in, std::string* value)
+{
+  uint32_t size;
+  if (!in.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+    return false;
+  }
+  value->resize(size);
+  return static_cast<bool>(in.read(value->data(), size));
+}
+
+void
+WriteString(std::ostream& out, const std::string& value)
+{
+  uint32_t size = value.size();
+  out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  out.write(value.data(), size);
+}
+
+// Returns the cached entries of a file, or null if the cache is missing, stale or invalid
+std::shared_ptr<PhraseFile>
+ReadCache(const std::string& cache_path, const CacheHeader& expected)
+{
+  std::ifstream in(cache_path, std::ios::binary);
+  CacheHeader header;
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      header.magic != expected.magic || header.version != expected.version ||
+      header.format != expected.format || header.mtime_sec != expected.mtime_sec ||
+      header.mtime_nsec != expected.mtime_nsec || header.file_size != expected.file_size) {
+    return nullptr;
+  }
+  auto file = std::make_shared<PhraseFile>();
+  // Each entry takes at least 8 bytes, which bounds the counts of a corrupted file
+  if (header.num_entries > static_cast<uint64_t>(header.file_size) ||
+      header.num_malformed_lines > static_cast<uint64_t>(header.file_size)) {
+    return nullptr;
+  }
+  file->entries.resize(header.num_entries);
+  for (auto& entry : file->entries) {
+    if (!ReadString(in, &entry.key) || !ReadString(in, &entry.value)) {
+      return nullptr;
+    }
+  }
+  file->malformed_lines.resize(header.num_malformed_lines);
+  for (auto& line : file->malformed_lines) {
+    if (!ReadString(in, &line)) {
+      return nullptr;
+    }
+  }
+  return file;
+}
+
+// Best effort: the cache is written to a temporary file renamed once complete
+void
+WriteCache(const std::string& cache_path, CacheHeader header, const PhraseFile& file)
+{
+  header.num_entries = file.entries.size();
+  header.num_malformed_lines = file.malformed_lines.size();
+  std::string tmp_path = cache_path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (auto& entry : file.entries) {
+      WriteString(out, entry.key);
+      WriteString(out, entry.value);
+    }
+    for (auto& line : file.malformed_lines) {
+      WriteString(out, line);
+    }
+    out.flush();
+    if (!out) {
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+  }
+}
+
+}  // namespace
+
+PhraseFile
+Parse(std::string_view content, Format format)
+{
+  PhraseFile file;
+  while (!content.empty()) {
+    size_t end = content.find('\n');
+    std::string_view line = Trim(content.substr(0, end));
+    content = end == std::string_view::npos ? std::string_view() : content.substr(end + 1);
+    if (line.empty()) {
+      continue;
+    }
+
+    switch (format) {
+      case Format::kPhrases:
+        file.entries.push_back({std::string(line), ""});
+        break;
+      case Format::kDntPhrases: {
+        size_t pos = line.find("##");
+        if (pos == std::string_view::npos) {
+          file.entries.push_back({std::string(line), ""});
+        } else {
+          file.entries.push_back(
+              {std::string(TrimRight(line.substr(0, pos))),
+               std::string(TrimLeft(line.substr(pos + 2)))});
+        }
+        break;
+      }
+      case Format::kUserDictionary: {
+        size_t pos = line.find("  ");
+        if (pos == std::string_view::npos) {
+          file.malformed_lines.emplace_back(line);
+        } else {
+          file.entries.push_back(
+              {std::string(line.substr(0, pos)), std::string(TrimLeft(line.substr(pos + 2)))});
+        }
+        break;
+      }
+    }
+  }
+  return file;
+}
+
+std::shared_ptr<PhraseFile>
+LoadUncached(const std::string& path, Format format, bool use_cache)
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    throw std::runtime_error("Could not open file " + path + ": " + strerror(errno));
+  }
+  CacheHeader header = MakeHeader(st, format);
+  if (use_cache) {
+    if (auto file = ReadCache(CachePath(path), header)) {
+      return file;
+    }
+  }
+
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) {
+    throw std::runtime_error("Could not open file " + path);
+  }
+  std::stringstream content;
+  content << in.rdbuf();
+  auto file = std::make_shared<PhraseFile>(Parse(content.str(), format));
+  if (use_cache) {
+    WriteCache(CachePath(path), header, *file);
+  }
+  return file;
+}
+
+std::shared_ptr<const PhraseFile>
+Load(const std::string& path, Format format, bool use_cache)
+{
+  static std::mutex mutex;
+  static std::map<std::pair<std::string, Format>, std::shared_ptr<const PhraseFile>> loaded;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = loaded.find({path, format});
+  if (it == loaded.end()) {
+    it = loaded.emplace(std::make_pair(path, format), LoadUncached(path, format, use_cache)).first;
+  }
+  return it->second;
+}
+
+}  // namespace riva::utils::phrases
@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace riva::utils::phrases {
+
+/// Removes the leading spaces of `text`. Only spaces are removed, not tabs or other whitespace.
+inline std::string_view
+TrimLeft(std::string_view text)
+{
+  size_t start = text.find_first_not_of(' ');
+  return start == std::string_view::npos ? std::string_view() : text.substr(start);
+}
+
+/// Removes the trailing spaces of `text`
+inline std::string_view
+TrimRight(std::string_view text)
+{
+  size_t end = text.find_last_not_of(' ');
+  return end == std::string_view::npos ? std::string_view() : text.substr(0, end + 1);
+}
+
+/// Removes the leading and trailing spaces of `text`
+inline std::string_view
+Trim(std::string_view text)
+{
+  return TrimRight(TrimLeft(text));
+}
+
+/// Layout of the lines of a phrase or dictionary file
+enum class Format {
+  /// One phrase per line, e.g. boosted words
+  kPhrases,
+  /// `key##value`, or only `key`, e.g. do-not-translate phrases and their custom translations
+  kDntPhrases,
+  /// `key  value`, separated by at least two spaces, e.g. a TTS user dictionary
+  kUserDictionary,
+};
+
+struct Entry {
+  std::string key;
+  /// Empty for Format::kPhrases
+  std::string value;
+};
+
+/// Entries of a file, in file order, without empty lines
+struct PhraseFile {
+  std::vector<Entry> entries;
+  /// Non-empty lines that do not match the format, trimmed
+  std::vector<std::string> malformed_lines;
+};
+
+/// Parses the content of a phrase or dictionary file. Keys and values are trimmed.
+PhraseFile Parse(std::string_view content, Format format);
+
+/// Loads and parses a phrase or dictionary file, once per process: later calls for the same
+/// path and format return the same entries. Throws std::runtime_error if the file cannot be read.
+///
+/// With `use_cache`, the parsed entries are also kept in a binary file next to it,
+/// `<path>.cache`, which is used instead of parsing as long as the modification time and the
+/// size of the file are unchanged. Failing to write the cache is not an error.
+std::shared_ptr<const PhraseFile> Load(
+    const std::string& path, Format format, bool use_cache = false);
+
+/// Same as Load, but reads the file, or its cache, on every call
+std::shared_ptr<PhraseFile> LoadUncached(const std::string& path, Format format, bool use_cache);
+
+/// Path of the binary cache of `path`
+inline std::string
+CachePath(const std::string& path)
+{
+  return path + ".cache";
+}
+
+}  // namespace riva::utils::phrases
@@ -0,0 +1,119 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "phrases.h"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <stdexcept>
+
+namespace riva::utils::phrases {
+
+namespace {
+
+std::string
+WriteTempFile(const std::string& name, const std::string& content)
+{
+  std::string path = ::testing::TempDir() + "/" + name + "_" + std::to_string(getpid());
+  std::ofstream(path, std::ios::trunc) << content;
+  return path;
+}
+
+}  // namespace
+
+TEST(Phrases, Trim)
+{
+  EXPECT_EQ(Trim("  a b  "), "a b");
+  EXPECT_EQ(Trim("    "), "");
+  EXPECT_EQ(Trim(""), "");
+  EXPECT_EQ(TrimLeft("  a  "), "a  ");
+  EXPECT_EQ(TrimRight("  a  "), "  a");
+  // Only spaces are trimmed
+  EXPECT_EQ(Trim("\ta\t"), "\ta\t");
+}
+
+TEST(Phrases, ParsePhrases)
+{
+  auto file = Parse("  hello world \n\n   \nriva", Format::kPhrases);
+  ASSERT_EQ(file.entries.size(), 2U);
+  EXPECT_EQ(file.entries[0].key, "hello world");
+  EXPECT_EQ(file.entries[1].key, "riva");
+  EXPECT_TRUE(file.malformed_lines.empty());
+}
+
+TEST(Phrases, ParseDntPhrases)
+{
+  auto file = Parse(" NVIDIA \nRiva ## Riva NMT\nGPU##\n", Format::kDntPhrases);
+  ASSERT_EQ(file.entries.size(), 3U);
+  EXPECT_EQ(file.entries[0].key, "NVIDIA");
+  EXPECT_EQ(file.entries[0].value, "");
+  EXPECT_EQ(file.entries[1].key, "Riva");
+  EXPECT_EQ(file.entries[1].value, "Riva NMT");
+  EXPECT_EQ(file.entries[2].key, "GPU");
+  EXPECT_EQ(file.entries[2].value, "");
+}
+
+TEST(Phrases, ParseUserDictionary)
+{
+  auto file = Parse(" nvidia   EH1 N V IH1 D IY0 AH0 \nmalformed line\n", Format::kUserDictionary);
+  ASSERT_EQ(file.entries.size(), 1U);
+  EXPECT_EQ(file.entries[0].key, "nvidia");
+  EXPECT_EQ(file.entries[0].value, "EH1 N V IH1 D IY0 AH0");
+  ASSERT_EQ(file.malformed_lines.size(), 1U);
+  EXPECT_EQ(file.malformed_lines[0], "malformed line");
+}
+
+TEST(Phrases, LoadOncePerProcess)
+{
+  std::string path = WriteTempFile("phrases_once", "one\ntwo\n");
+  auto file = Load(path, Format::kPhrases);
+  ASSERT_EQ(file->entries.size(), 2U);
+  EXPECT_EQ(Load(path, Format::kPhrases), file);
+  // Another format is parsed again
+  EXPECT_NE(Load(path, Format::kDntPhrases), file);
+  unlink(path.c_str());
+
+  EXPECT_THROW(Load(path + "_missing", Format::kPhrases), std::runtime_error);
+}
+
+TEST(Phrases, BinaryCache)
+{
+  std::string path = WriteTempFile("phrases_cache", "a  b\nbad\n");
+  auto file = LoadUncached(path, Format::kUserDictionary, true);
+  ASSERT_EQ(file->entries.size(), 1U);
+  ASSERT_EQ(access(CachePath(path).c_str(), F_OK), 0);
+
+  // Same size and modification time: the cached entries are used
+  struct stat st;
+  ASSERT_EQ(stat(path.c_str(), &st), 0);
+  std::ofstream(path, std::ios::trunc) << "x  y\nbad\n";
+  struct timespec times[2] = {st.st_atim, st.st_mtim};
+  ASSERT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+  auto cached = LoadUncached(path, Format::kUserDictionary, true);
+  ASSERT_EQ(cached->entries.size(), 1U);
+  EXPECT_EQ(cached->entries[0].key, "a");
+  EXPECT_EQ(cached->entries[0].value, "b");
+  ASSERT_EQ(cached->malformed_lines.size(), 1U);
+  EXPECT_EQ(cached->malformed_lines[0], "bad");
+
+  // Modified file: parsed again
+  times[1].tv_sec -= 10;
+  ASSERT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+  auto parsed = LoadUncached(path, Format::kUserDictionary, true);
+  ASSERT_EQ(parsed->entries.size(), 1U);
+  EXPECT_EQ(parsed->entries[0].key, "x");
+
+  // Another format does not use the cache of the first one
+  EXPECT_EQ(LoadUncached(path, Format::kPhrases, true)->entries.size(), 2U);
+
+  unlink(CachePath(path).c_str());
+  unlink(path.c_str());
+}
+
+}  // namespace riva::utils::phrases
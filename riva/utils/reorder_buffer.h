@@ -0,0 +1,96 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace riva::utils {
+
+/// Releases results completed in any order in the order of their sequence numbers, 0, 1, 2...
+///
+/// At most `window` sequence numbers past the next one to release may be outstanding: the
+/// producer calls WaitForSlot before submitting work, and so only blocks when the oldest result
+/// still missing holds back a full window of later ones. Thread safe.
+template <class T>
+class ReorderBuffer {
+ public:
+  /// Called, under the lock of the buffer, for every result in sequence order
+  using ReleaseFunc = std::function<void(uint64_t sequence, T& value)>;
+
+  ReorderBuffer(size_t window, ReleaseFunc release_func)
+      : window_(window > 0 ? window : 1), release_func_(std::move(release_func))
+  {
+  }
+
+  /// Blocks until `sequence` is within the window of the next result to release
+  void WaitForSlot(uint64_t sequence)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this, sequence]() { return sequence < next_ + window_; });
+  }
+
+  /// Stores the result of `sequence` and releases the results it no longer holds back
+  void Push(uint64_t sequence, T value) { Complete(sequence, std::move(value)); }
+
+  /// Marks `sequence` as done without a result, e.g. when its request failed, so that it does
+  /// not hold the later ones back
+  void Skip(uint64_t sequence) { Complete(sequence, std::nullopt); }
+
+  /// Next sequence number to release, i.e. number of results released or skipped so far
+  uint64_t Next()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return next_;
+  }
+
+  /// Number of results completed but held back by a missing earlier one
+  size_t Pending()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+  }
+
+ private:
+  void Complete(uint64_t sequence, std::optional<T> value)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (sequence < next_) {
+        return;
+      }
+      pending_.emplace(sequence, std::move(value));
+      bool released = false;
+      for (auto it = pending_.begin(); it != pending_.end() && it->first == next_;
+           it = pending_.erase(it)) {
+        if (it->second) {
+          release_func_(it->first, *it->second);
+        }
+        next_++;
+        released = true;
+      }
+      if (!released) {
+        return;
+      }
+    }
+    cv_.notify_all();
+  }
+
+  const uint64_t window_;
+  ReleaseFunc release_func_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::map<uint64_t, std::optional<T>> pending_;
+  uint64_t next_ = 0;
+};
+
+}  // namespace riva::utils
@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "reorder_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace riva::utils {
+
+TEST(ReorderBuffer, ReleasesInOrder)
+{
+  std::vector<std::string> released;
+  ReorderBuffer<std::string> buffer(
+      4, [&](uint64_t sequence, std::string& value) { released.push_back(value); });
+  buffer.Push(2, "c");
+  buffer.Push(1, "b");
+  EXPECT_TRUE(released.empty());
+  EXPECT_EQ(buffer.Pending(), 2U);
+  buffer.Push(0, "a");
+  EXPECT_EQ(released, (std::vector<std::string>{"a", "b", "c"}));
+  EXPECT_EQ(buffer.Next(), 3U);
+  EXPECT_EQ(buffer.Pending(), 0U);
+}
+
+TEST(ReorderBuffer, SkipDoesNotHoldBack)
+{
+  std::vector<uint64_t> released;
+  ReorderBuffer<int> buffer(
+      4, [&](uint64_t sequence, int& value) { released.push_back(sequence); });
+  buffer.Push(1, 1);
+  buffer.Skip(0);
+  buffer.Push(3, 3);
+  buffer.Skip(2);
+  EXPECT_EQ(released, (std::vector<uint64_t>{1, 3}));
+  EXPECT_EQ(buffer.Next(), 4U);
+}
+
+TEST(ReorderBuffer, WaitForSlotBlocksOnFullWindow)
+{
+  ReorderBuffer<int> buffer(2, [](uint64_t, int&) {});
+  buffer.WaitForSlot(0);
+  buffer.WaitForSlot(1);
+  buffer.Push(1, 1);
+  std::atomic<bool> admitted(false);
+  std::thread producer([&]() {
+    buffer.WaitForSlot(2);
+    admitted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(admitted);
+  buffer.Push(0, 0);
+  producer.join();
+  EXPECT_TRUE(admitted);
+}
+
+TEST(ReorderBuffer, ConcurrentCompletions)
+{
+  constexpr uint64_t kCount = 1000;
+  std::vector<uint64_t> released;
+  ReorderBuffer<uint64_t> buffer(
+      16, [&](uint64_t sequence, uint64_t& value) { released.push_back(value); });
+
+  std::vector<uint64_t> order(kCount);
+  for (uint64_t i = 0; i < kCount; ++i) {
+    order[i] = i;
+  }
+  // Shuffle within blocks of the window size, as completions of requests in flight would
+  std::mt19937 rng(7);
+  for (uint64_t i = 0; i < kCount; i += 16) {
+    std::shuffle(order.begin() + i, order.begin() + std::min(i + 16, kCount), rng);
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t]() {
+      for (uint64_t i = t; i < kCount; i += 4) {
+        buffer.Push(order[i], order[i]);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(released.size(), kCount);
+  for (uint64_t i = 0; i < kCount; ++i) {
+    EXPECT_EQ(released[i], i);
+  }
+}
+
+}  // namespace riva::utils
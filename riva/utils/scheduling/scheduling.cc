@@ -0,0 +1,255 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "scheduling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+namespace riva::utils::scheduling {
+
+namespace {
+
+// Upper bound on the number of moves/swaps tried when refining a bin packing
+constexpr size_t kMaxRefinementRounds = 10000;
+
+std::vector<size_t>
+RepeatItems(size_t num_items, int32_t num_iterations)
+{
+  std::vector<size_t> items;
+  items.reserve(num_items * std::max(num_iterations, 0));
+  for (size_t i = 0; i < num_items; ++i) {
+    for (int32_t iter = 0; iter < num_iterations; ++iter) {
+      items.push_back(i);
+    }
+  }
+  return items;
+}
+
+struct Bin {
+  std::vector<size_t> items;
+  double load = 0.;
+};
+
+// Longest-processing-time assignment: items are taken by decreasing weight and each one goes to
+// the least loaded bin.
+std::vector<Bin>
+PackLongestFirst(
+    const std::vector<size_t>& sorted_items, const std::vector<double>& weights, size_t num_bins)
+{
+  std::vector<Bin> bins(num_bins);
+  using Entry = std::pair<double, size_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> least_loaded;
+  for (size_t b = 0; b < num_bins; ++b) {
+    least_loaded.emplace(0., b);
+  }
+  for (auto item : sorted_items) {
+    auto [load, b] = least_loaded.top();
+    least_loaded.pop();
+    bins[b].items.push_back(item);
+    bins[b].load = load + weights[item];
+    least_loaded.emplace(bins[b].load, b);
+  }
+  return bins;
+}
+
+// Repeatedly moves or swaps items between the most and the least loaded bins while doing so
+// reduces the gap between them. Every accepted step strictly lowers the sum of squared loads, so
+// the loop terminates; the round limit only bounds the running time on very large corpora.
+void
+RefinePacking(std::vector<Bin>& bins, const std::vector<double>& weights)
+{
+  for (size_t round = 0; round < kMaxRefinementRounds; ++round) {
+    auto [min_it, max_it] = std::minmax_element(
+        bins.begin(), bins.end(), [](const Bin& a, const Bin& b) { return a.load < b.load; });
+    double gap = max_it->load - min_it->load;
+    if (gap <= 0.) {
+      return;
+    }
+
+    // Candidates taken from the least loaded bin, sorted by weight. A weight of zero stands for
+    // moving an item without taking one back.
+    std::vector<std::pair<double, size_t>> lighter;
+    lighter.reserve(min_it->items.size() + 1);
+    lighter.emplace_back(0., min_it->items.size());
+    for (size_t i = 0; i < min_it->items.size(); ++i) {
+      lighter.emplace_back(weights[min_it->items[i]], i);
+    }
+    std::sort(lighter.begin(), lighter.end());
+
+    // Moving a net weight d from the heavier to the lighter bin helps if 0 < d < gap, and is
+    // best when d is closest to gap / 2.
+    double best_score = gap / 2.;
+    size_t best_heavy = 0, best_light = 0;
+    bool found = false;
+    for (size_t h = 0; h < max_it->items.size(); ++h) {
+      double w_heavy = weights[max_it->items[h]];
+      double target = w_heavy - gap / 2.;
+      auto it =
+          std::lower_bound(lighter.begin(), lighter.end(), std::make_pair(target, size_t(0)));
+      for (auto cand : {it, it == lighter.begin() ? it : std::prev(it)}) {
+        if (cand == lighter.end()) {
+          continue;
+        }
+        double d = w_heavy - cand->first;
+        if (d <= 0. || d >= gap) {
+          continue;
+        }
+        double score = std::abs(d - gap / 2.);
+        if (score < best_score) {
+          best_score = score;
+          best_heavy = h;
+          best_light = cand->second;
+          found = true;
+        }
+      }
+    }
+    if (!found) {
+      return;
+    }
+
+    size_t heavy_item = max_it->items[best_heavy];
+    max_it->items.erase(max_it->items.begin() + best_heavy);
+    max_it->load -= weights[heavy_item];
+    if (best_light < min_it->items.size()) {
+      size_t light_item = min_it->items[best_light];
+      min_it->items.erase(min_it->items.begin() + best_light);
+      min_it->load -= weights[light_item];
+      max_it->items.push_back(light_item);
+      max_it->load += weights[light_item];
+    }
+    min_it->items.push_back(heavy_item);
+    min_it->load += weights[heavy_item];
+  }
+}
+
+// Turns a per-slot plan into a single dispatch order by simulating the run: whichever slot is
+// expected to free up first receives the next item of its own queue.
+std::vector<size_t>
+DispatchOrder(std::vector<Bin>& bins, const std::vector<double>& weights)
+{
+  std::vector<size_t> order;
+  using Entry = std::pair<double, size_t>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> next_free;
+  std::vector<size_t> cursor(bins.size(), 0);
+  for (size_t b = 0; b < bins.size(); ++b) {
+    auto& items = bins[b].items;
+    std::stable_sort(items.begin(), items.end(), [&weights](size_t x, size_t y) {
+      return weights[x] > weights[y];
+    });
+    next_free.emplace(0., b);
+  }
+  while (!next_free.empty()) {
+    auto [t, b] = next_free.top();
+    next_free.pop();
+    if (cursor[b] == bins[b].items.size()) {
+      continue;
+    }
+    size_t item = bins[b].items[cursor[b]++];
+    order.push_back(item);
+    next_free.emplace(t + weights[item], b);
+  }
+  return order;
+}
+
+}  // namespace
+
+Policy
+ParsePolicy(const std::string& name)
+{
+  if (name == "file_order") {
+    return Policy::kFileOrder;
+  } else if (name == "longest_first") {
+    return Policy::kLongestFirst;
+  } else if (name == "shortest_first") {
+    return Policy::kShortestFirst;
+  } else if (name == "round_robin") {
+    return Policy::kRoundRobin;
+  } else if (name == "bin_pack") {
+    return Policy::kBinPack;
+  }
+  throw std::runtime_error(
+      "Unknown scheduling policy " + name +
+      " (expected file_order, longest_first, shortest_first, round_robin or bin_pack)");
+}
+
+std::string
+PolicyName(Policy policy)
+{
+  switch (policy) {
+    case Policy::kFileOrder:
+      return "file_order";
+    case Policy::kLongestFirst:
+      return "longest_first";
+    case Policy::kShortestFirst:
+      return "shortest_first";
+    case Policy::kRoundRobin:
+      return "round_robin";
+    case Policy::kBinPack:
+      return "bin_pack";
+  }
+  return "";
+}
+
+std::vector<size_t>
+ScheduleWork(
+    const std::vector<double>& weights, int32_t num_iterations, int32_t num_slots, Policy policy)
+{
+  std::vector<size_t> items = RepeatItems(weights.size(), num_iterations);
+  auto heavier = [&weights](size_t x, size_t y) { return weights[x] > weights[y]; };
+
+  switch (policy) {
+    case Policy::kFileOrder:
+      break;
+    case Policy::kLongestFirst:
+      std::stable_sort(items.begin(), items.end(), heavier);
+      break;
+    case Policy::kShortestFirst:
+      std::stable_sort(items.begin(), items.end(), [&weights](size_t x, size_t y) {
+        return weights[x] < weights[y];
+      });
+      break;
+    case Policy::kRoundRobin:
+      items.clear();
+      for (int32_t iter = 0; iter < num_iterations; ++iter) {
+        for (size_t i = 0; i < weights.size(); ++i) {
+          items.push_back(i);
+        }
+      }
+      break;
+    case Policy::kBinPack: {
+      std::stable_sort(items.begin(), items.end(), heavier);
+      auto bins = PackLongestFirst(items, weights, std::max<int32_t>(num_slots, 1));
+      RefinePacking(bins, weights);
+      items = DispatchOrder(bins, weights);
+      break;
+    }
+  }
+  return items;
+}
+
+double
+TailIdleTime(std::vector<double> completion_times, int32_t num_slots)
+{
+  if (completion_times.empty() || num_slots <= 0) {
+    return 0.;
+  }
+  std::sort(completion_times.begin(), completion_times.end());
+  double end = completion_times.back();
+  size_t num_tail = std::min(completion_times.size(), static_cast<size_t>(num_slots));
+
+  double idle = (num_slots - num_tail) * end;
+  for (size_t i = completion_times.size() - num_tail; i < completion_times.size(); ++i) {
+    idle += end - completion_times[i];
+  }
+  return idle;
+}
+
+}  // namespace riva::utils::scheduling
@@ -0,0 +1,58 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace riva::utils::scheduling {
+
+/// Order in which a corpus is dispatched onto the parallel request slots of a client
+enum class Policy {
+  kFileOrder,      // each file repeated num_iterations times back to back, in load order
+  kLongestFirst,   // all work items sorted by decreasing weight
+  kShortestFirst,  // all work items sorted by increasing weight
+  kRoundRobin,     // one full pass over the corpus per iteration
+  kBinPack,        // items packed onto slots to minimize the makespan
+};
+
+/// Utility function to convert a policy name to a Policy
+///
+/// Accepted names are file_order, longest_first, shortest_first, round_robin and bin_pack.
+/// Throws an error if the name is not recognized
+///
+/// @param[in]: name The policy name
+Policy ParsePolicy(const std::string& name);
+
+/// Returns the command line name of a policy
+std::string PolicyName(Policy policy);
+
+/// Utility function to compute the dispatch order of a corpus
+///
+/// Returns the indices into `weights` in the order they should be dispatched. Every index appears
+/// exactly `num_iterations` times. Weights are only compared with each other, so any quantity
+/// proportional to the processing time (audio duration, file size) can be used.
+///
+/// @param[in]: weights Relative processing cost of each item of the corpus
+/// @param[in]: num_iterations Number of times each item is dispatched
+/// @param[in]: num_slots Number of requests kept in flight by the client
+/// @param[in]: policy The scheduling policy
+std::vector<size_t> ScheduleWork(
+    const std::vector<double>& weights, int32_t num_iterations, int32_t num_slots, Policy policy);
+
+/// Utility function to compute the slot time left idle at the end of a run
+///
+/// Once the last item has been dispatched, every slot that completes its request stays idle until
+/// the whole run ends. Returns the sum of that idle time over all slots, in the unit of
+/// `completion_times`. Slots that never received work count as idle for the whole run.
+///
+/// @param[in]: completion_times Completion time of every request, relative to the run start
+/// @param[in]: num_slots Number of requests kept in flight by the client
+double TailIdleTime(std::vector<double> completion_times, int32_t num_slots);
+
+}  // namespace riva::utils::scheduling
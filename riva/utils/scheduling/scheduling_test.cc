@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "scheduling.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+
+using namespace ::testing;
+
+namespace riva::utils::scheduling {
+
+// Makespan of a dispatch order when every item goes to the first slot to free up
+static double
+SimulateMakespan(const std::vector<size_t>& order, const std::vector<double>& weights, int slots)
+{
+  std::vector<double> free_at(slots, 0.);
+  for (auto item : order) {
+    auto slot = std::min_element(free_at.begin(), free_at.end());
+    *slot += weights[item];
+  }
+  return *std::max_element(free_at.begin(), free_at.end());
+}
+
+TEST(SchedulingUtils, ParsePolicy)
+{
+  for (auto policy : {Policy::kFileOrder, Policy::kLongestFirst, Policy::kShortestFirst,
+                      Policy::kRoundRobin, Policy::kBinPack}) {
+    EXPECT_EQ(ParsePolicy(PolicyName(policy)), policy);
+  }
+  try {
+    ParsePolicy("random");
+    FAIL() << "Expected runtime error for unknown policy";
+  }
+  catch (std::runtime_error& e) {
+    EXPECT_THAT(e.what(), HasSubstr("Unknown scheduling policy"));
+  }
+}
+
+TEST(SchedulingUtils, FileOrderAndRoundRobin)
+{
+  std::vector<double> weights = {3., 1., 2.};
+  EXPECT_THAT(ScheduleWork(weights, 2, 4, Policy::kFileOrder), ElementsAre(0, 0, 1, 1, 2, 2));
+  EXPECT_THAT(ScheduleWork(weights, 2, 4, Policy::kRoundRobin), ElementsAre(0, 1, 2, 0, 1, 2));
+}
+
+TEST(SchedulingUtils, SortedPolicies)
+{
+  std::vector<double> weights = {3., 1., 2.};
+  EXPECT_THAT(ScheduleWork(weights, 1, 4, Policy::kLongestFirst), ElementsAre(0, 2, 1));
+  EXPECT_THAT(ScheduleWork(weights, 1, 4, Policy::kShortestFirst), ElementsAre(1, 2, 0));
+}
+
+TEST(SchedulingUtils, BinPackDispatchesEveryItem)
+{
+  std::vector<double> weights = {7., 5., 4., 4., 3., 3., 2., 1., 9., 6.};
+  auto order = ScheduleWork(weights, 3, 4, Policy::kBinPack);
+  ASSERT_EQ(order.size(), weights.size() * 3);
+  std::map<size_t, int> counts;
+  for (auto item : order) {
+    counts[item]++;
+  }
+  for (size_t i = 0; i < weights.size(); ++i) {
+    EXPECT_EQ(counts[i], 3);
+  }
+}
+
+TEST(SchedulingUtils, BinPackBeatsFileOrder)
+{
+  // Classic case where greedy longest-first packing is not optimal: {3,3,2,2,2} on 2 slots
+  std::vector<double> weights = {3., 3., 2., 2., 2.};
+  auto packed = ScheduleWork(weights, 1, 2, Policy::kBinPack);
+  auto file_order = ScheduleWork(weights, 1, 2, Policy::kFileOrder);
+  EXPECT_DOUBLE_EQ(SimulateMakespan(packed, weights, 2), 6.);
+  EXPECT_GT(SimulateMakespan(file_order, weights, 2), 6.);
+}
+
+TEST(SchedulingUtils, TailIdleTime)
+{
+  EXPECT_DOUBLE_EQ(TailIdleTime({}, 4), 0.);
+  // Last two completions define the tail: slot idle for 10 - 6 = 4
+  EXPECT_DOUBLE_EQ(TailIdleTime({1., 10., 2., 6.}, 2), 4.);
+  // One slot never received work and stays idle for the whole run
+  EXPECT_DOUBLE_EQ(TailIdleTime({5., 10.}, 3), 15.);
+}
+
+}  // namespace riva::utils::scheduling
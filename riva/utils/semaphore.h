@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace riva::utils {
+
+/// Counting semaphore, until the clients move to C++20 and std::counting_semaphore
+///
+/// Used to bound the number of requests in flight: the dispatcher sleeps in Acquire while every
+/// permit is taken instead of polling, and completions hand their permit back with Release.
+class Semaphore {
+ public:
+  explicit Semaphore(size_t count) : count_(count) {}
+
+  /// Takes a permit, blocking until one is available
+  void Acquire()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return count_ > 0; });
+    count_--;
+  }
+
+  /// Takes a permit if one is available, without blocking
+  bool TryAcquire()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count_ == 0) {
+      return false;
+    }
+    count_--;
+    return true;
+  }
+
+  void Release(size_t count = 1)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      count_ += count;
+    }
+    if (count == 1) {
+      cv_.notify_one();
+    } else {
+      cv_.notify_all();
+    }
+  }
+
+  size_t Available()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  size_t count_;
+};
+
+}  // namespace riva::utils
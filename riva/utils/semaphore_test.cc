@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "semaphore.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace riva::utils {
+
+TEST(Semaphore, TryAcquire)
+{
+  Semaphore semaphore(2);
+  EXPECT_TRUE(semaphore.TryAcquire());
+  EXPECT_TRUE(semaphore.TryAcquire());
+  EXPECT_FALSE(semaphore.TryAcquire());
+  semaphore.Release(2);
+  EXPECT_EQ(semaphore.Available(), 2U);
+}
+
+TEST(Semaphore, AcquireBlocksUntilRelease)
+{
+  Semaphore semaphore(1);
+  semaphore.Acquire();
+  std::atomic<bool> acquired(false);
+  std::thread waiter([&]() {
+    semaphore.Acquire();
+    acquired = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(acquired);
+  semaphore.Release();
+  waiter.join();
+  EXPECT_TRUE(acquired);
+}
+
+TEST(Semaphore, BoundsConcurrency)
+{
+  constexpr int kPermits = 3;
+  Semaphore semaphore(kPermits);
+  std::atomic<int> active(0);
+  std::atomic<int> max_active(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 100; ++i) {
+        semaphore.Acquire();
+        int now = ++active;
+        int seen = max_active;
+        while (now > seen && !max_active.compare_exchange_weak(seen, now)) {
+        }
+        active--;
+        semaphore.Release();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_LE(max_active, kPermits);
+  EXPECT_EQ(semaphore.Available(), static_cast<size_t>(kPermits));
+}
+
+}  // namespace riva::utils
@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+
+namespace riva::utils::stats {
+
+namespace {
+
+// Bucket 0 holds values below kMinValue, the last bucket values above the covered range
+int
+BucketIndex(double value)
+{
+  if (!(value >= LatencyHistogram::kMinValue)) {
+    return 0;
+  }
+  double position =
+      std::log10(value / LatencyHistogram::kMinValue) * LatencyHistogram::kBucketsPerDecade;
+  return std::min(static_cast<int>(position) + 1, LatencyHistogram::kNumBuckets - 1);
+}
+
+// Upper bound of the values of a bucket
+double
+BucketUpperBound(int index)
+{
+  return LatencyHistogram::kMinValue *
+         std::pow(10., static_cast<double>(index) / LatencyHistogram::kBucketsPerDecade);
+}
+
+}  // namespace
+
+void
+LatencyHistogram::Reset()
+{
+  std::memset(buckets, 0, sizeof(buckets));
+  count = 0;
+  sum = 0.;
+  min = 0.;
+  max = 0.;
+}
+
+void
+LatencyHistogram::Record(double value)
+{
+  buckets[BucketIndex(value)]++;
+  min = count ? std::min(min, value) : value;
+  max = count ? std::max(max, value) : value;
+  count++;
+  sum += value;
+}
+
+void
+LatencyHistogram::Merge(const LatencyHistogram& other)
+{
+  if (other.count == 0) {
+    return;
+  }
+  for (int i = 0; i < kNumBuckets; ++i) {
+    buckets[i] += other.buckets[i];
+  }
+  min = count ? std::min(min, other.min) : other.min;
+  max = count ? std::max(max, other.max) : other.max;
+  count += other.count;
+  sum += other.sum;
+}
+
+double
+LatencyHistogram::Percentile(double percentile) const
+{
+  if (count == 0) {
+    return 0.;
+  }
+  // Same element as latencies[floor(percentile * n / 100)] of a sorted vector
+  uint64_t rank = static_cast<uint64_t>(std::floor(percentile * count / 100.)) + 1;
+  rank = std::min(rank, count);
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // The out of range buckets have no upper bound of their own
+      if (i == 0) {
+        return min;
+      } else if (i == kNumBuckets - 1) {
+        return max;
+      }
+      return std::clamp(BucketUpperBound(i), min, max);
+    }
+  }
+  return max;
+}
+
+void
+PrintLatencyTable(const LatencyHistogram& histogram, const std::string& name)
+{
+  if (histogram.count == 0) {
+    return;
+  }
+  std::cout << std::setprecision(5);
+  std::cout << name << " (ms):\n";
+  std::cout << "\t\tMedian\t\t90th\t\t95th\t\t99th\t\tAvg\n";
+  std::cout << "\t\t" << histogram.Percentile(50.) << "\t\t" << histogram.Percentile(90.)
+            << "\t\t" << histogram.Percentile(95.) << "\t\t" << histogram.Percentile(99.)
+            << "\t\t" << histogram.Mean() << std::endl;
+}
+
+}  // namespace riva::utils::stats
@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+namespace riva::utils::stats {
+
+/// Latency histogram with logarithmically spaced buckets
+///
+/// The histogram has a fixed size and is trivially copyable, so it can live in memory shared
+/// between processes or be sent over a socket as is. Histograms recorded independently are
+/// combined with Merge, which is exact: merging never loses more precision than a single
+/// histogram has. Values are in milliseconds; percentiles are accurate to the bucket width, about
+/// 3.7% of the value, between 1 microsecond and 1000 seconds.
+struct LatencyHistogram {
+  static constexpr double kMinValue = 1e-3;
+  static constexpr int kBucketsPerDecade = 64;
+  static constexpr int kNumDecades = 9;
+  static constexpr int kNumBuckets = kBucketsPerDecade * kNumDecades + 2;
+
+  uint64_t buckets[kNumBuckets];
+  uint64_t count;
+  double sum;
+  double min;
+  double max;
+
+  /// Empties the histogram. A value-initialized histogram (`LatencyHistogram h{}`) is empty too.
+  void Reset();
+
+  /// Adds one latency, in milliseconds
+  void Record(double value);
+
+  /// Adds all the latencies recorded by `other`
+  void Merge(const LatencyHistogram& other);
+
+  /// Returns the latency below which `percentile` percent of the recorded values fall, using the
+  /// same rank as the sorted-vector statistics of the clients. Returns 0 when empty.
+  double Percentile(double percentile) const;
+
+  double Mean() const { return count ? sum / count : 0.; }
+};
+
+static_assert(std::is_trivially_copyable_v<LatencyHistogram>);
+
+/// Prints the median, 90th, 95th and 99th percentiles and the average in the table format used by
+/// the clients
+void PrintLatencyTable(const LatencyHistogram& histogram, const std::string& name);
+
+}  // namespace riva::utils::stats
@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "latency_histogram.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "worker_processes.h"
+
+using namespace ::testing;
+
+namespace riva::utils::stats {
+
+// Relative precision of a bucket: 10^(1/64)
+static constexpr double kBucketRatio = 1.0366;
+
+static double
+SortedPercentile(std::vector<double> values, double percentile)
+{
+  std::sort(values.begin(), values.end());
+  return values[static_cast<size_t>(std::floor(percentile * values.size() / 100.))];
+}
+
+TEST(LatencyHistogram, Empty)
+{
+  LatencyHistogram histogram{};
+  EXPECT_EQ(histogram.count, 0U);
+  EXPECT_EQ(histogram.Percentile(50.), 0.);
+  EXPECT_EQ(histogram.Mean(), 0.);
+}
+
+TEST(LatencyHistogram, PercentilesWithinBucketPrecision)
+{
+  LatencyHistogram histogram{};
+  std::vector<double> values;
+  for (int i = 1; i <= 1000; ++i) {
+    double value = 0.5 * i * std::sqrt(i);
+    values.push_back(value);
+    histogram.Record(value);
+  }
+  EXPECT_EQ(histogram.count, values.size());
+  EXPECT_DOUBLE_EQ(histogram.min, values.front());
+  EXPECT_DOUBLE_EQ(histogram.max, values.back());
+  for (double percentile : {0., 50., 90., 95., 99.}) {
+    double expected = SortedPercentile(values, percentile);
+    double actual = histogram.Percentile(percentile);
+    EXPECT_GE(actual, expected) << percentile;
+    EXPECT_LE(actual, expected * kBucketRatio) << percentile;
+  }
+}
+
+TEST(LatencyHistogram, MergeMatchesSingleHistogram)
+{
+  LatencyHistogram all{}, even{}, odd{};
+  for (int i = 0; i < 500; ++i) {
+    double value = 0.01 * (i * 37 % 500 + 1);
+    all.Record(value);
+    (i % 2 ? odd : even).Record(value);
+  }
+  LatencyHistogram merged{};
+  merged.Merge(even);
+  merged.Merge(odd);
+  EXPECT_EQ(merged.count, all.count);
+  EXPECT_DOUBLE_EQ(merged.min, all.min);
+  EXPECT_DOUBLE_EQ(merged.max, all.max);
+  EXPECT_NEAR(merged.sum, all.sum, 1e-9);
+  for (int i = 0; i < LatencyHistogram::kNumBuckets; ++i) {
+    EXPECT_EQ(merged.buckets[i], all.buckets[i]);
+  }
+}
+
+TEST(LatencyHistogram, OutOfRangeValues)
+{
+  LatencyHistogram histogram{};
+  histogram.Record(0.);
+  histogram.Record(1e8);
+  EXPECT_EQ(histogram.Percentile(0.), 0.);
+  EXPECT_EQ(histogram.Percentile(100.), 1e8);
+}
+
+TEST(WorkerProcesses, StatsReturnedThroughSharedMemory)
+{
+  std::vector<LatencyHistogram> stats;
+  int result = RunWorkerProcesses<LatencyHistogram>(
+      4,
+      [](int32_t worker, LatencyHistogram& histogram) {
+        for (int i = 0; i <= worker; ++i) {
+          histogram.Record(10. * (worker + 1));
+        }
+        return 0;
+      },
+      stats);
+  EXPECT_EQ(result, 0);
+  ASSERT_EQ(stats.size(), 4U);
+  LatencyHistogram merged{};
+  for (int32_t worker = 0; worker < 4; ++worker) {
+    EXPECT_EQ(stats[worker].count, static_cast<uint64_t>(worker + 1));
+    merged.Merge(stats[worker]);
+  }
+  EXPECT_EQ(merged.count, 10U);
+  EXPECT_DOUBLE_EQ(merged.max, 40.);
+}
+
+TEST(WorkerProcesses, FailedWorkerReported)
+{
+  std::vector<LatencyHistogram> stats;
+  int result = RunWorkerProcesses<LatencyHistogram>(
+      2, [](int32_t worker, LatencyHistogram&) { return worker == 1 ? 3 : 0; }, stats);
+  EXPECT_EQ(result, 1);
+  EXPECT_EQ(stats.size(), 2U);
+}
+
+}  // namespace riva::utils::stats
@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace riva::utils::stats {
+
+/// Runs `worker` in `num_processes` forked processes and collects the stats they report
+///
+/// Every worker receives its index and a value-initialized `Stats` placed in an anonymous shared
+/// mapping; whatever it writes there is visible to the parent once the worker exits. The return
+/// value of `worker` becomes the exit status of its process. gRPC state must not be carried
+/// across fork(), so channels and stubs have to be created inside `worker`.
+///
+/// Returns 0 if every worker exited with status 0, 1 otherwise. `stats` holds one entry per
+/// worker in index order, failed workers included.
+///
+/// @param[in]: num_processes Number of worker processes to fork
+/// @param[in]: worker Function run in each worker process
+/// @param[out]: stats Stats reported by the workers
+template <typename Stats>
+int
+RunWorkerProcesses(
+    int32_t num_processes, const std::function<int(int32_t, Stats&)>& worker,
+    std::vector<Stats>& stats)
+{
+  static_assert(
+      std::is_trivially_copyable_v<Stats>, "Stats are shared between processes as raw memory");
+  if (num_processes < 1) {
+    throw std::runtime_error("Number of worker processes must be at least 1");
+  }
+
+  size_t shared_size = sizeof(Stats) * num_processes;
+  void* shared =
+      mmap(nullptr, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (shared == MAP_FAILED) {
+    throw std::runtime_error(std::string("Failed to map shared stats: ") + strerror(errno));
+  }
+  Stats* slots = static_cast<Stats*>(shared);
+  for (int32_t i = 0; i < num_processes; ++i) {
+    new (slots + i) Stats{};
+  }
+
+  // Anything buffered before the fork would otherwise be printed once per worker
+  std::cout << std::flush;
+  std::cerr << std::flush;
+
+  std::vector<pid_t> pids;
+  for (int32_t i = 0; i < num_processes; ++i) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "Failed to fork worker " << i << ": " << strerror(errno) << std::endl;
+      break;
+    }
+    if (pid == 0) {
+      int status = 1;
+      try {
+        status = worker(i, slots[i]);
+      }
+      catch (const std::exception& e) {
+        std::cerr << "Worker " << i << " failed: " << e.what() << std::endl;
+      }
+      std::cout << std::flush;
+      std::cerr << std::flush;
+      _exit(status);
+    }
+    pids.push_back(pid);
+  }
+
+  int result = static_cast<int32_t>(pids.size()) == num_processes ? 0 : 1;
+  for (size_t i = 0; i < pids.size(); ++i) {
+    int status = 0;
+    if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::cerr << "Worker " << i << " did not complete successfully" << std::endl;
+      result = 1;
+    }
+  }
+
+  stats.assign(slots, slots + num_processes);
+  munmap(shared, shared_size);
+  return result;
+}
+
+}  // namespace riva::utils::stats
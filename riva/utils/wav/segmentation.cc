@@ -0,0 +1,114 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "segmentation.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace riva::utils::wav {
+
+namespace {
+
+template <typename T>
+void
+AppendLittleEndian(std::vector<char>& out, T value)
+{
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+  }
+}
+
+void
+AppendTag(std::vector<char>& out, const char* tag)
+{
+  out.insert(out.end(), tag, tag + 4);
+}
+
+}  // namespace
+
+std::vector<Segment>
+SplitAtSilence(
+    const int16_t* samples, size_t num_frames, int channels, int sample_rate,
+    double max_segment_sec, double window_ms)
+{
+  if (max_segment_sec <= 0. || window_ms <= 0. || channels < 1 || sample_rate < 1) {
+    throw std::invalid_argument(
+        "Invalid segmentation parameters: max_segment_sec " + std::to_string(max_segment_sec) +
+        ", window_ms " + std::to_string(window_ms));
+  }
+  size_t max_frames = std::max<size_t>(1, static_cast<size_t>(max_segment_sec * sample_rate));
+  if (num_frames <= max_frames) {
+    return {{0, num_frames}};
+  }
+
+  // Energy of every complete window
+  size_t window = std::max<size_t>(1, static_cast<size_t>(window_ms * sample_rate / 1000.));
+  window = std::min(window, std::max<size_t>(1, max_frames / 2));
+  std::vector<double> energies(num_frames / window);
+  for (size_t w = 0; w < energies.size(); ++w) {
+    const int16_t* begin = samples + w * window * channels;
+    double energy = 0.;
+    for (const int16_t* s = begin; s < begin + window * channels; ++s) {
+      energy += static_cast<double>(*s) * *s;
+    }
+    energies[w] = energy;
+  }
+
+  std::vector<Segment> segments;
+  size_t begin = 0;
+  while (num_frames - begin > max_frames) {
+    // Candidate windows have their middle in the second half of the segment
+    size_t first = (begin + max_frames / 2 + window / 2) / window;
+    size_t last = (begin + max_frames - window / 2) / window;
+    size_t cut = begin + max_frames;
+    double lowest = 0.;
+    for (size_t w = first; w <= last && w < energies.size(); ++w) {
+      size_t middle = w * window + window / 2;
+      if (middle <= begin || middle > begin + max_frames) {
+        continue;
+      }
+      // Ties go to the latest window, for the longest segments
+      if (cut == begin + max_frames || energies[w] <= lowest) {
+        lowest = energies[w];
+        cut = middle;
+      }
+    }
+    segments.push_back({begin, cut});
+    begin = cut;
+  }
+  segments.push_back({begin, num_frames});
+  return segments;
+}
+
+std::vector<char>
+MakeWavFile(const int16_t* samples, size_t num_frames, int channels, int sample_rate)
+{
+  constexpr uint16_t kBitsPerSample = 16;
+  uint32_t data_size = static_cast<uint32_t>(num_frames * channels * sizeof(int16_t));
+  std::vector<char> out;
+  out.reserve(44 + data_size);
+  AppendTag(out, "RIFF");
+  AppendLittleEndian<uint32_t>(out, 36 + data_size);
+  AppendTag(out, "WAVE");
+  AppendTag(out, "fmt ");
+  AppendLittleEndian<uint32_t>(out, 16);
+  AppendLittleEndian<uint16_t>(out, 1);  // PCM
+  AppendLittleEndian<uint16_t>(out, channels);
+  AppendLittleEndian<uint32_t>(out, sample_rate);
+  AppendLittleEndian<uint32_t>(out, sample_rate * channels * kBitsPerSample / 8);
+  AppendLittleEndian<uint16_t>(out, channels * kBitsPerSample / 8);
+  AppendLittleEndian<uint16_t>(out, kBitsPerSample);
+  AppendTag(out, "data");
+  AppendLittleEndian<uint32_t>(out, data_size);
+  size_t offset = out.size();
+  out.resize(offset + data_size);
+  std::memcpy(out.data() + offset, samples, data_size);
+  return out;
+}
+
+}  // namespace riva::utils::wav
@@ -0,0 +1,46 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace riva::utils::wav {
+
+/// Range of audio frames [begin, end), a frame holding one sample per channel
+struct Segment {
+  size_t begin;
+  size_t end;
+};
+
+/// Utility function to split long audio at its quietest points
+///
+/// Energies are measured over consecutive windows of `window_ms`. Every cut is made in the middle
+/// of the lowest-energy window found in the second half of the segment it ends, so that segments
+/// are never longer than `max_segment_sec` nor, but for the last one, shorter than half of it.
+/// Returns a single segment covering the audio when it is not longer than `max_segment_sec`.
+///
+/// @param[in]: samples Interleaved LINEAR_PCM samples
+/// @param[in]: num_frames Number of frames in `samples`
+/// @param[in]: channels Number of channels
+/// @param[in]: sample_rate Frames per second
+/// @param[in]: max_segment_sec Maximum duration of a segment, must be positive
+/// @param[in]: window_ms Duration of the windows energies are measured on
+std::vector<Segment> SplitAtSilence(
+    const int16_t* samples, size_t num_frames, int channels, int sample_rate,
+    double max_segment_sec, double window_ms = 20.);
+
+/// Utility function to wrap LINEAR_PCM samples into an in-memory WAV file
+///
+/// @param[in]: samples Interleaved LINEAR_PCM samples
+/// @param[in]: num_frames Number of frames in `samples`
+/// @param[in]: channels Number of channels
+/// @param[in]: sample_rate Frames per second
+std::vector<char> MakeWavFile(
+    const int16_t* samples, size_t num_frames, int channels, int sample_rate);
+
+}  // namespace riva::utils::wav
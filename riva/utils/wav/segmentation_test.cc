@@ -0,0 +1,82 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "segmentation.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace riva::utils::wav {
+
+// Loud audio with silent frames in [silence_begin, silence_end)
+static std::vector<int16_t>
+Tone(size_t num_frames, int channels, size_t silence_begin = 0, size_t silence_end = 0)
+{
+  std::vector<int16_t> samples(num_frames * channels);
+  for (size_t f = 0; f < num_frames; ++f) {
+    bool silent = f >= silence_begin && f < silence_end;
+    for (int c = 0; c < channels; ++c) {
+      samples[f * channels + c] = silent ? 0 : ((f % 2) ? 8000 : -8000);
+    }
+  }
+  return samples;
+}
+
+TEST(Segmentation, ShortAudioIsOneSegment)
+{
+  auto samples = Tone(1000, 1);
+  auto segments = SplitAtSilence(samples.data(), 1000, 1, 1000, 1.);
+  ASSERT_EQ(segments.size(), 1U);
+  EXPECT_EQ(segments[0].begin, 0U);
+  EXPECT_EQ(segments[0].end, 1000U);
+  EXPECT_THROW(SplitAtSilence(samples.data(), 1000, 1, 1000, 0.), std::invalid_argument);
+}
+
+TEST(Segmentation, CutsInSilence)
+{
+  // 10 s at 1 kHz, stereo, silent from 6.2 s to 6.4 s
+  auto samples = Tone(10000, 2, 6200, 6400);
+  auto segments = SplitAtSilence(samples.data(), 10000, 2, 1000, 8.);
+  ASSERT_EQ(segments.size(), 2U);
+  EXPECT_GE(segments[0].end, 6200U);
+  EXPECT_LT(segments[0].end, 6400U);
+  EXPECT_EQ(segments[1].begin, segments[0].end);
+  EXPECT_EQ(segments[1].end, 10000U);
+}
+
+TEST(Segmentation, SegmentsCoverAudioWithinBounds)
+{
+  auto samples = Tone(100003, 1);
+  auto segments = SplitAtSilence(samples.data(), 100003, 1, 1000, 7.);
+  ASSERT_GT(segments.size(), 1U);
+  size_t begin = 0;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    EXPECT_EQ(segments[i].begin, begin);
+    EXPECT_LE(segments[i].end - segments[i].begin, 7000U);
+    if (i + 1 < segments.size()) {
+      EXPECT_GE(segments[i].end - segments[i].begin, 3500U);
+    }
+    begin = segments[i].end;
+  }
+  EXPECT_EQ(begin, 100003U);
+}
+
+TEST(Segmentation, MakeWavFile)
+{
+  auto samples = Tone(100, 2);
+  auto wav = MakeWavFile(samples.data(), 100, 2, 16000);
+  ASSERT_EQ(wav.size(), 44U + 400U);
+  EXPECT_EQ(std::string(wav.data(), 4), "RIFF");
+  EXPECT_EQ(std::string(wav.data() + 8, 4), "WAVE");
+  EXPECT_EQ(std::string(wav.data() + 36, 4), "data");
+  uint32_t data_size;
+  std::memcpy(&data_size, wav.data() + 40, sizeof(data_size));
+  EXPECT_EQ(data_size, 400U);
+  EXPECT_EQ(std::memcmp(wav.data() + 44, samples.data(), 400), 0);
+}
+
+}  // namespace riva::utils::wav
@@ -40,6 +40,7 @@ struct WaveData {
   int channels;
   nr::AudioEncoding encoding;
   long data_offset;
+  double duration;  // seconds, from the manifest; 0 if unknown
 };
 
 
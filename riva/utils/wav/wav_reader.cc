@@ -10,6 +10,7 @@
 #include <glog/logging.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -96,12 +97,40 @@ SeekToData(std::istream& wavfile, WAVHeader& header)
   }
 }
 
+// Read-only stream over a file already loaded in memory, so that its header is parsed without
+// opening the file again
+class MemoryStreamBuf : public std::streambuf {
+ public:
+  MemoryStreamBuf(const std::vector<char>& data)
+  {
+    char* begin = const_cast<char*>(data.data());
+    setg(begin, begin, begin + data.size());
+  }
+
+ protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+  {
+    off_type base = dir == std::ios_base::beg   ? 0
+                    : dir == std::ios_base::cur ? gptr() - eback()
+                                                : egptr() - eback();
+    if (!(which & std::ios_base::in) || base + off < 0 || base + off > egptr() - eback()) {
+      return pos_type(off_type(-1));
+    }
+    setg(eback(), eback() + base + off, egptr());
+    return pos_type(base + off);
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+  {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
+
 bool
 ParseHeader(
-    std::string file, nr::AudioEncoding& encoding, int& samplerate, int& channels,
+    std::istream& file_stream, nr::AudioEncoding& encoding, int& samplerate, int& channels,
     long& data_offset)
 {
-  std::ifstream file_stream(file);
   WAVHeader header;
   SeekToData(file_stream, header);
   if (header.file_tag == "RIFF") {
@@ -154,8 +183,37 @@ IsDirectory(const char* path)
     return false;
 }
 
+struct ManifestEntry {
+  std::string filepath;
+  double duration;
+};
+
+// FNV-1a, stable across processes and hosts unlike std::hash
+uint64_t
+HashPath(const std::string& path)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : path) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
 bool
-ParseJson(const char* path, std::vector<std::string>& filelist)
+InShard(const std::string& filepath, size_t position, const ShardSpec& shard)
+{
+  if (shard.count <= 1) {
+    return true;
+  }
+  if (shard.mode == ShardMode::kHash) {
+    return HashPath(filepath) % shard.count == static_cast<uint64_t>(shard.index);
+  }
+  return position % shard.count == static_cast<size_t>(shard.index);
+}
+
+bool
+ParseJson(const char* path, std::vector<ManifestEntry>& filelist, const ShardSpec& shard)
 {
   std::ifstream manifest_file;
   manifest_file.open(path, std::ifstream::in);
@@ -166,15 +224,25 @@ ParseJson(const char* path, std::vector<std::string>& filelist)
   }
 
   std::string filepath_name("audio_filepath");
+  std::string duration_name("duration");
 
   std::string line;
+  size_t position = 0;
   while (std::getline(manifest_file, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    // Entries of other stride shards are skipped without parsing them
+    if (shard.mode == ShardMode::kStride && !InShard("", position++, shard)) {
+      continue;
+    }
     rapidjson::Document doc;
 
     doc.Parse(line.c_str());
 
     if (!doc.IsObject()) {
       std::cout << "Problem parsing line: " << line << std::endl;
+      continue;
     }
 
     if (!doc.HasMember(filepath_name.c_str())) {
@@ -182,7 +250,14 @@ ParseJson(const char* path, std::vector<std::string>& filelist)
       continue;
     }
     std::string filepath = doc[filepath_name.c_str()].GetString();
-    filelist.push_back(filepath);
+    if (shard.mode == ShardMode::kHash && !InShard(filepath, 0, shard)) {
+      continue;
+    }
+    double duration = 0.;
+    if (doc.HasMember(duration_name.c_str()) && doc[duration_name.c_str()].IsNumber()) {
+      duration = doc[duration_name.c_str()].GetDouble();
+    }
+    filelist.push_back({filepath, duration});
   }
 
   manifest_file.close();
@@ -252,58 +327,96 @@ AudioToString(nr::AudioEncoding& encoding)
 }
 
 
+ShardMode
+ParseShardMode(const std::string& name)
+{
+  if (name == "stride") {
+    return ShardMode::kStride;
+  } else if (name == "hash") {
+    return ShardMode::kHash;
+  }
+  throw std::runtime_error("Unknown shard mode " + name + " (expected stride or hash)");
+}
+
 void
-LoadWavData(std::vector<std::shared_ptr<WaveData>>& all_wav, std::string& path)
+LoadWavData(
+    std::vector<std::shared_ptr<WaveData>>& all_wav, std::string& path, const ShardSpec& shard)
 // pre-loading data
 // we don't want to measure I/O
 {
+  if (shard.count < 1 || shard.index < 0 || shard.index >= shard.count) {
+    throw std::runtime_error(
+        "Invalid shard " + std::to_string(shard.index) + " of " + std::to_string(shard.count));
+  }
   std::cout << "Loading eval dataset..." << std::flush << std::endl;
 
-  std::vector<std::string> filelist;
+  std::vector<ManifestEntry> filelist;
   std::string file_ext = GetFileExt(path);
   if (file_ext == "json" || file_ext == "JSON") {
-    ParseJson(path.c_str(), filelist);
+    ParseJson(path.c_str(), filelist, shard);
   } else {
-    ParsePath(path.c_str(), filelist);
+    std::vector<std::string> paths;
+    ParsePath(path.c_str(), paths);
+    // Directory listing order differs between hosts, shards are taken from the sorted list
+    if (shard.count > 1) {
+      std::sort(paths.begin(), paths.end());
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+      if (InShard(paths[i], i, shard)) {
+        filelist.push_back({paths[i], 0.});
+      }
+    }
+  }
+  if (shard.count > 1) {
+    std::cout << "Shard " << shard.index << " of " << shard.count << ": " << filelist.size()
+              << " files" << std::endl;
   }
 
-  std::vector<std::pair<uint64_t, std::string>> files_size_name;
-  files_size_name.reserve(filelist.size());
-  for (auto& filename : filelist) {
-    // Get the size
+  for (auto& entry : filelist) {
+    std::string& filename = entry.filepath;
     std::cout << "filename: " << filename << std::endl;
-    std::ifstream in(filename, std::ifstream::ate | std::ifstream::binary);
-    if (!in.good()) {
+
+    // Each file is opened once, its header is parsed from the loaded data
+    std::shared_ptr<WaveData> wav_data = std::make_shared<WaveData>();
+    std::ifstream file_stream(filename, std::ifstream::binary);
+    if (!file_stream.good()) {
       throw std::runtime_error(std::string("Failed to open file ") + filename);
     }
-    uint64_t file_size = in.tellg();
-    files_size_name.emplace_back(std::make_pair(file_size, filename));
-  }
-
-
-  for (auto& file_size_name : files_size_name) {
-    std::string filename = file_size_name.second;
+    wav_data->data.assign(
+        std::istreambuf_iterator<char>(file_stream.rdbuf()), std::istreambuf_iterator<char>());
 
     nr::AudioEncoding encoding;
     int samplerate;
     int channels;
     long data_offset;
-    if (!ParseHeader(filename, encoding, samplerate, channels, data_offset)) {
+    MemoryStreamBuf buffer(wav_data->data);
+    std::istream data_stream(&buffer);
+    if (!ParseHeader(data_stream, encoding, samplerate, channels, data_offset)) {
       throw std::runtime_error(std::string("Invalid file/format ") + filename);
     }
-    std::shared_ptr<WaveData> wav_data = std::make_shared<WaveData>();
 
     wav_data->sample_rate = samplerate;
     wav_data->filename = filename;
     wav_data->encoding = encoding;
     wav_data->channels = channels;
     wav_data->data_offset = data_offset;
-    wav_data->data.assign(
-        std::istreambuf_iterator<char>(std::ifstream(filename).rdbuf()),
-        std::istreambuf_iterator<char>());
+    wav_data->duration = entry.duration;
     all_wav.push_back(std::move(wav_data));
   }
-  std::cout << "Done loading " << files_size_name.size() << " files" << std::endl;
+  std::cout << "Done loading " << filelist.size() << " files" << std::endl;
+}
+
+std::vector<double>
+AudioWeights(const std::vector<std::shared_ptr<WaveData>>& all_wav)
+{
+  bool durations_known = std::all_of(
+      all_wav.begin(), all_wav.end(), [](const auto& wav) { return wav->duration > 0.; });
+  std::vector<double> weights;
+  weights.reserve(all_wav.size());
+  for (auto& wav : all_wav) {
+    weights.push_back(durations_known ? wav->duration : wav->data.size());
+  }
+  return weights;
 }
 
 int
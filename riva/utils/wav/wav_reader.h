@@ -14,6 +14,25 @@
 // Header length
 static inline constexpr std::size_t OPUS_HEADER_LENGTH = 8192U;
 
-void LoadWavData(std::vector<std::shared_ptr<WaveData>>& all_wav, std::string& path);
+// How the files of a corpus are split between cooperating client processes. kStride keeps
+// every num_shards-th entry in manifest (or sorted directory) order, kHash keeps the entries
+// whose path hashes to the shard, so it does not depend on the order of the corpus.
+enum class ShardMode { kStride, kHash };
+
+struct ShardSpec {
+  int32_t index = 0;
+  int32_t count = 1;
+  ShardMode mode = ShardMode::kStride;
+};
+
+ShardMode ParseShardMode(const std::string& name);
+
+// Loads the audio files of the given shard only. Durations found in a manifest are stored in
+// WaveData::duration and spare the size probe of the file.
+void LoadWavData(
+    std::vector<std::shared_ptr<WaveData>>& all_wav, std::string& path,
+    const ShardSpec& shard = ShardSpec());
+// Per file dispatch weights: durations when all of them are known, byte sizes otherwise
+std::vector<double> AudioWeights(const std::vector<std::shared_ptr<WaveData>>& all_wav);
 int ParseWavHeader(std::istream& wavfile, WAVHeader& header, bool read_header);
 std::string AudioToString(nr::AudioEncoding& encoding);